@@ -0,0 +1,24 @@
+#pragma once
+
+#include<cstddef>
+
+#include "lunar/math.hpp"
+
+#ifndef LUNAR_ANA_LEVEL
+#define LUNAR_ANA_LEVEL 2
+#endif
+
+struct AnalyticEphem{
+	static constexpr int LEVEL=LUNAR_ANA_LEVEL;
+
+	static std::size_t n_terms();
+
+	static void earth_ecl(double jd_tdb,Vec3&pos,Vec3&vel);
+
+	static void moon_ecl(double jd_tdb,Vec3&pos,Vec3&vel);
+
+	static bool body(int id,double jd_tdb,Vec3&pos,Vec3&vel);
+
+	static void state(int target,int observer,double jd_tdb,Vec3&pos,
+					  Vec3&vel);
+};
@@ -1,10 +1,20 @@
 #pragma once
 
+#include<cstddef>
+#include<memory>
+#include<string>
 #include<utility>
+#include<vector>
 
+#include "lunar/frame_cache.hpp"
 #include "lunar/frames.hpp"
 #include "lunar/spc_ephem.hpp"
 
+enum class LtMode{ITER,LINEAR,VEL};
+
+LtMode parse_lt(const std::string&name);
+std::string lt_name(LtMode mode);
+
 struct RetProp{
 	Vec3 X;
 	Vec3 V;
@@ -12,20 +22,42 @@ struct RetProp{
 };
 
 struct AberCorr{
+	static LtMode def_lt;
+
 	static double lightday(const Vec3&vec);
 
+	static RetProp geo_lt(EphRead&eph,int target,double jd_tdb,LtMode mode);
+
+	static void geo_lt_n(EphRead&eph,int target,const double*jd_tdb,
+						 std::size_t n,std::vector<RetProp>&out,LtMode mode);
+
 	static RetProp geo_prop(EphRead&eph,int target,double jd_tdb,
 							int max_iter=3);
 
+	static void geo_prop_n(EphRead&eph,int target,const double*jd_tdb,
+						   std::size_t n,std::vector<RetProp>&out,
+						   int max_iter=3);
+
+	static void geo_prop_sm(EphRead&eph,double jd_tdb,RetProp&sun,
+							RetProp&moon,int max_iter=3);
+
 	static Vec3 geo_app(EphRead&eph,int target,double jd_tdb,double*tr_out,
 						int max_iter=3);
 
 	static Vec3 geo_app(EphRead&eph,int target,double jd_tdb,int max_iter=3);
 };
 
+struct SunMoon{
+	std::pair<double,double> sun;
+	std::pair<double,double> moon;
+};
+
 struct AppLon{
 	EphRead&eph;
 	Mat3 frame_bias;
+	LtMode lt;
+	bool fc_on;
+	std::size_t n_rot=0;
 
 	bool prec_ok;
 	double prec_jd;
@@ -52,4 +84,25 @@ struct AppLon{
 	std::pair<double,double> sun_calc(double jd_tdb);
 
 	std::pair<double,double> moon_calc(double jd_tdb);
+
+	SunMoon sun_moon_calc(double jd_tdb);
+
+	void sun_calc_n(const double*jd_tdb,std::size_t n,double*lam,
+					double*lam_dot);
+
+	void moon_calc_n(const double*jd_tdb,std::size_t n,double*lam,
+					 double*lam_dot);
+
+	void sun_moon_n(const double*jd_tdb,std::size_t n,double*lam_s,
+					double*dot_s,double*lam_m,double*dot_m);
+
+	static std::pair<double,double> lon_rate(const Mat3&R,const RetProp&st);
+
+  private:
+	std::shared_ptr<const FrameCache> fc[2];
+
+	bool fc_eval(double jd_tdb,Mat3&r1n,Mat3&prec);
+
+	void lon_n(int target,const double*jd_tdb,std::size_t n,double*lam,
+			   double*lam_dot);
 };
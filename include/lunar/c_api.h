@@ -45,6 +45,8 @@ LUNAR_API int LUNAR_CALL lunar_cmd_info(int argc,const char*const*argv);
 LUNAR_API int LUNAR_CALL lunar_cmd_test(int argc,const char*const*argv);
 LUNAR_API int LUNAR_CALL lunar_cmd_cfg(int argc,const char*const*argv);
 LUNAR_API int LUNAR_CALL lunar_cmd_comp(int argc,const char*const*argv);
+LUNAR_API int LUNAR_CALL lunar_cmd_bench(int argc,const char*const*argv);
+LUNAR_API int LUNAR_CALL lunar_cmd_fit(int argc,const char*const*argv);
 
 LUNAR_API int LUNAR_CALL lunar_use_main(void);
 LUNAR_API int LUNAR_CALL lunar_use_month(void);
@@ -65,6 +67,8 @@ LUNAR_API int LUNAR_CALL lunar_use_info(void);
 LUNAR_API int LUNAR_CALL lunar_use_test(void);
 LUNAR_API int LUNAR_CALL lunar_use_cfg(void);
 LUNAR_API int LUNAR_CALL lunar_use_comp(void);
+LUNAR_API int LUNAR_CALL lunar_use_bench(void);
+LUNAR_API int LUNAR_CALL lunar_use_fit(void);
 
 #ifdef __cplusplus
 }
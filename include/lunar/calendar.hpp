@@ -1,6 +1,7 @@
 #pragma once
 
 #include<iosfwd>
+#include<limits>
 #include<map>
 #include<set>
 #include<string>
@@ -49,9 +50,24 @@ struct SolLunCal{
 
 	EphRead&eph;
 	AppLon app;
+	bool use_cache=EphemCache::def_on;
+	static RootMode def_mode;
+	RootMode mode=def_mode;
+	static RootPrec def_prec;
+	RootPrec prec=def_prec;
+	static int grid_tz;
+	double span_lo=std::numeric_limits<double>::quiet_NaN();
+	double span_hi=std::numeric_limits<double>::quiet_NaN();
+	RootStat rs{};
+	std::vector<RootStat> task_st;
+	std::map<std::pair<int,std::string>,double> st_memo;
+	std::map<std::pair<std::string,int>,double> lp_memo;
+	RootPrec memo_prec=RootPrec::AUTO;
 
 	explicit SolLunCal(EphRead&reader);
 
+	void cache_span(double jd_lo,double jd_hi);
+
 	static double norm_angle(double angle);
 
 	static LocalDT mk_local(int year,int month,int day,int hour=0,int minute=0,
@@ -71,19 +87,36 @@ struct SolLunCal{
 
 	static const std::map<std::string,double>&lp_offs();
 
+	static double st_seed(int year,const std::string&code);
+
 	static double st_guess(int year,const std::string&code);
 
+	static double lp_guess(double jd_near,double angle);
+
 	double f_sterm(double jd_tdb,double tgt_lam,double*lam_ptr=nullptr);
 
 	double f_lphase(double jd_tdb,double ph_angle,double*lam_s_ptr=nullptr,
 					double*lam_m_ptr=nullptr);
 
-	std::pair<double,double> val_der(const std::string&kind,double jd_tdb,
-									 double target);
+	template<RootKind K>
+	std::pair<double,double> val_der(double jd_tdb,double target);
+
+	template<RootKind K>
+	double newton(double jd_initial,double target,double eps_days=1e-8,
+				  int max_iter=20);
 
-	double newton(const std::string&kind,double jd_initial,double target,
+	double newton(RootKind kind,double jd_initial,double target,
 				  double eps_days=1e-8,int max_iter=20);
 
+	template<RootKind K>
+	double scan_root(double jd,double f,double target,double eps_days);
+
+	bool refine(const RootTask&task,double&root,RootStat&st);
+
+	std::size_t lockstep(const std::vector<RootTask>&tasks,
+						 std::vector<double>&results,
+						 std::vector<std::string>&errors);
+
 	std::pair<std::vector<double>,std::vector<std::string>>
 	run_roots(const std::vector<RootTask>&tasks);
 
@@ -93,6 +126,25 @@ struct SolLunCal{
 
 	YearResult compute_year(int year);
 	YearResult compute_year(int year,std::ostream*log);
+
+	std::vector<YearResult> compute_years(int y0,int y1,std::ostream*log);
+
+	std::map<int,YearResult> compute_years(const std::set<int>&years,
+										   std::ostream*log);
+
+	YearResult take_year(int year,std::ostream*log);
+};
+
+class PrecHint{
+  public:
+	explicit PrecHint(RootPrec p);
+	~PrecHint();
+
+	PrecHint(const PrecHint&)=delete;
+	PrecHint&operator=(const PrecHint&)=delete;
+
+  private:
+	RootPrec old_;
 };
 
 struct LunarMonth{
@@ -116,6 +168,8 @@ struct LunCal6{
 
 	LocalDT get_st(const std::string&code,int year);
 
+	void cache_year(int year);
+
 	static double to_utcjd(const LocalDT&t);
 
 	static LocalDT to_local(double jd);
@@ -147,3 +201,5 @@ std::vector<LunarMonth> enum_gyr(LunCal6&calc,int year);
 
 int run_rootw(const std::string&ephem,const std::string&input_path,
 			  const std::string&out_path);
+
+int run_rootp(const std::string&ephem);
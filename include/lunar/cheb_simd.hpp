@@ -0,0 +1,12 @@
+#pragma once
+
+enum class ChebIsa{SCALAR,AVX2};
+
+ChebIsa cheb_isa();
+
+bool cheb_use(ChebIsa isa);
+
+void cheb_rec(const double*rec,int type,int ncf,double et,double st[6]);
+
+void cheb_rec4(const double*const rec[4],int type,int ncf,const double et[4],
+			   double st[4][6]);
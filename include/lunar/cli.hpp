@@ -67,6 +67,9 @@ struct DlArgs{
 	std::string action;
 	std::string id;
 	std::string dir;
+	std::string bsp;
+	std::string years;
+	std::string out;
 	bool quiet=false;
 };
 
@@ -133,6 +136,8 @@ int cmd_info(const std::vector<std::string>&args);
 int cmd_test(const std::vector<std::string>&args);
 int cmd_cfg(const std::vector<std::string>&args);
 int cmd_comp(const std::vector<std::string>&args);
+int cmd_bench(const std::vector<std::string>&args);
+int cmd_fit(const std::vector<std::string>&args);
 
 std::string tool_ver();
 
@@ -155,3 +160,5 @@ void use_info();
 void use_test();
 void use_cfg();
 void use_comp();
+void use_bench();
+void use_fit();
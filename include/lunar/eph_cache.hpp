@@ -0,0 +1,48 @@
+#pragma once
+
+#include<cstddef>
+#include<vector>
+
+#include "lunar/math.hpp"
+
+struct EphRead;
+
+class EphemCache{
+  public:
+	static bool def_on;
+	static constexpr double DEF_STEP=0.25;
+	static constexpr double DEF_TOL_KM=1e-6;
+
+	EphemCache(EphRead&eph,double jd_lo,double jd_hi,double step=DEF_STEP);
+
+	double jd_lo() const{ return t0_+step_; }
+
+	double jd_hi() const{ return t0_+step_*static_cast<double>(n_itv_+1); }
+
+	double step() const{ return step_; }
+
+	double err_km() const{ return err_km_; }
+
+	std::size_t nodes() const{ return n_itv_+3; }
+
+	bool covers(double jd_lo,double jd_hi) const;
+
+	bool state(int target,int observer,double jd_tdb,Vec3&pos,
+			   Vec3&vel) const;
+
+  private:
+	static constexpr int kBody=3;
+	static constexpr int kCoef=8;
+
+	int ssb_=0;
+	int ids_[kBody]={};
+	double t0_=0.0;
+	double step_=DEF_STEP;
+	std::size_t n_itv_=0;
+	double err_km_=0.0;
+	std::vector<double> cf_;
+
+	int slot(int body) const;
+	void body_at(int slot,std::size_t itv,double s,Vec3&pos,Vec3&vel) const;
+	void measure(EphRead&eph);
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include<cstddef>
+#include<memory>
+#include<string>
+#include<vector>
+
+#include "lunar/spk_native.hpp"
+
+enum class EphBack{SPICE,NATIVE,ANALYTIC};
+
+std::vector<std::string> eph_paths(const std::string&spec);
+
+bool spk_cover(const std::string&path,const std::vector<int>&bodies,
+			   double&jd_lo,double&jd_hi);
+
+class EphReg{
+  public:
+	struct Kern{
+		std::string path;
+		std::shared_ptr<const SpkFile> spk;
+		std::shared_ptr<const void> pin;
+		double jd_lo=0.0;
+		double jd_hi=0.0;
+	};
+
+	struct Span{
+		double jd_lo=0.0;
+		double jd_hi=0.0;
+		std::size_t kern=0;
+	};
+
+	static std::shared_ptr<const EphReg> open(const std::string&spec,
+											  EphBack back);
+
+	const std::vector<Kern>&kerns() const{ return kerns_; }
+
+	const std::vector<Span>&spans() const{ return spans_; }
+
+	std::size_t find(double jd_tdb) const;
+
+	const SpkFile&spk_at(double jd_tdb) const{
+		return *kerns_[find(jd_tdb)].spk;
+	}
+
+  private:
+	std::vector<Kern> kerns_;
+	std::vector<Span> spans_;
+
+	EphReg(const std::vector<std::string>&paths,EphBack back);
+	void index();
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include<cstddef>
+#include<memory>
+#include<vector>
+
+#include "lunar/math.hpp"
+
+class FrameCache{
+  public:
+	static bool def_on;
+	static constexpr double DEF_STEP=1.0;
+	static constexpr int BLOCK=384;
+	static constexpr double JD0=2451545.0;
+
+	FrameCache(double jd_lo,double jd_hi,double step=DEF_STEP);
+
+	double jd_lo() const{ return JD0+step_*static_cast<double>(k0_+2); }
+
+	double jd_hi() const{ return JD0+step_*static_cast<double>(k1_-3); }
+
+	double step() const{ return step_; }
+
+	double err_rad() const{ return err_rad_; }
+
+	std::size_t nodes() const{ return static_cast<std::size_t>(k1_-k0_+1); }
+
+	bool covers(double jd_tdb) const{
+		return jd_tdb>=jd_lo()&&jd_tdb<=jd_hi();
+	}
+
+	bool nut_ang(double jd_tdb,double&dpsi,double&deps) const;
+
+	bool eval(double jd_tdb,Mat3&r1n,Mat3&prec) const;
+
+  private:
+	static constexpr int kVal=12;
+
+	double step_=DEF_STEP;
+	long long k0_=0;
+	long long k1_=0;
+	double err_rad_=0.0;
+	std::vector<double> val_;
+
+	bool interp(double jd_tdb,double out[kVal]) const;
+	void measure();
+};
+
+std::shared_ptr<const FrameCache> frame_cache(double jd_tdb);
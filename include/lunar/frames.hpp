@@ -24,5 +24,9 @@ struct PrecNut{
 
 	static std::pair<double,double> nut_ang(double jd_tdb);
 
+	static void nut_j2(double jd_tdb,double&dpsi,double&deps);
+
 	static Mat3 nut_mat(double jd_tdb);
+
+	static Mat3 ecl_mat(double jd_tdb);
 };
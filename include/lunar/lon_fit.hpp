@@ -0,0 +1,55 @@
+#pragma once
+
+#include<cstdint>
+#include<memory>
+#include<string>
+#include<utility>
+#include<vector>
+
+struct EphRead;
+
+struct LonSer{
+	double seg_len=0.0;
+	int ncf=0;
+	int nseg=0;
+	double max_err=0.0;
+	std::vector<double> coef;
+
+	std::pair<double,double> eval(double jd0,double jd_tdb) const;
+};
+
+struct FitOpts{
+	double sun_days=16.0;
+	int sun_ncf=14;
+	double moon_days=4.0;
+	int moon_ncf=16;
+};
+
+class LonFit{
+  public:
+	static constexpr std::uint32_t VERSION=1;
+
+	double jd_lo=0.0;
+	double jd_hi=0.0;
+	LonSer sun_ser;
+	LonSer moon_ser;
+
+	static LonFit build(EphRead&eph,double jd_lo,double jd_hi,
+						const FitOpts&opts=FitOpts());
+
+	static LonFit load(const std::string&path);
+
+	static bool is_fit(const std::string&path);
+
+	void save(const std::string&path) const;
+
+	bool covers(double jd_tdb) const{
+		return jd_tdb>=jd_lo&&jd_tdb<=jd_hi;
+	}
+
+	std::pair<double,double> sun(double jd_tdb) const;
+
+	std::pair<double,double> moon(double jd_tdb) const;
+};
+
+std::shared_ptr<const LonFit> lfit_open(const std::string&path);
@@ -114,3 +114,5 @@ struct LocalDT{
 };
 
 std::string fmt_local(const LocalDT&t);
+
+double ulp_dist(double a,double b);
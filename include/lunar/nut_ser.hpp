@@ -0,0 +1,14 @@
+#pragma once
+
+#include<cstddef>
+#include<utility>
+
+bool nut_full();
+
+std::size_t nut_terms();
+
+std::pair<double,double> nut_eval(double jd_tdb);
+
+void nut_eval_n(const double*jd_tdb,std::size_t n,double*dpsi,double*deps);
+
+bool nut_ref(double jd_tdb,double&dpsi,double&deps);
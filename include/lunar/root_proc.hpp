@@ -0,0 +1,48 @@
+#pragma once
+
+#include<cstddef>
+#include<string>
+#include<vector>
+
+#include "lunar/rt_solver.hpp"
+
+constexpr std::size_t kMaxWork=8;
+constexpr std::size_t kChunk=32;
+
+std::string quote_arg(const std::string&arg);
+std::string exe_path();
+
+std::vector<std::string> wk_args(const SolLunCal&self);
+
+bool rt_read(int fd,void*buf,std::size_t n);
+
+bool rt_write(int fd,const void*buf,std::size_t n);
+
+int rt_out_fd();
+
+class RootProc{
+  public:
+	RootProc(const std::string&exe,const std::vector<std::string>&args);
+	~RootProc();
+
+	RootProc(const RootProc&)=delete;
+	RootProc&operator=(const RootProc&)=delete;
+
+	bool call(const RtReq*req,RtRes*res,std::size_t n);
+
+  private:
+#ifdef _WIN32
+	void*proc_=nullptr;
+	void*h_in_=nullptr;
+	void*h_out_=nullptr;
+#else
+	int pid_=-1;
+	int fd_=-1;
+#endif
+};
+
+void run_pipe(SolLunCal&self,const std::vector<RootTask>&tasks,
+			  std::vector<double>&results,std::vector<std::string>&errors);
+
+void run_fork(SolLunCal&self,const std::vector<RootTask>&tasks,
+			  std::vector<double>&results,std::vector<std::string>&errors);
@@ -1,26 +1,157 @@
 #pragma once
 
-#include<atomic>
+#include<condition_variable>
 #include<cstddef>
+#include<cstdint>
+#include<functional>
+#include<iosfwd>
+#include<map>
+#include<memory>
+#include<mutex>
 #include<string>
 #include<vector>
 
 struct SolLunCal;
 
+enum class RootMode{ AUTO,SERIAL,LOCKSTEP,THREAD,PIPE,FORK,BATCH };
+
+RootMode parse_mode(const std::string&name);
+std::string mode_name(RootMode mode);
+
+enum class RootKind : std::int32_t{ SOLAR=0,LUNAR=1 };
+
+RootKind parse_kind(const std::string&name);
+std::string kind_name(RootKind kind);
+
+enum class RootPrec{ AUTO,MS,SEC,MIN };
+
+RootPrec parse_prec(const std::string&name);
+std::string prec_name(RootPrec prec);
+
+double prec_eps(RootPrec prec);
+double prec_grid(RootPrec prec);
+
+bool near_grid(double jd_tdb,double grid,double margin,double off=0.0);
+
 struct RootTask{
-	std::string kind;
+	RootKind kind;
 	double target;
 	double jd_initial;
 	double eps_days;
 	int max_iter;
+	RootPrec prec=RootPrec::MS;
+};
+
+struct RootStat{
+	std::uint32_t n_eval;
+	std::uint32_t n_iter;
+	std::uint32_t n_back;
+	std::uint32_t n_scan;
+	std::uint32_t n_eph;
+	std::uint32_t lost;
+	std::uint32_t esc;
 };
 
+struct RtSum{
+	std::size_t n_root=0;
+	std::size_t n_fail=0;
+	std::size_t n_eval=0;
+	std::size_t n_iter=0;
+	std::size_t n_back=0;
+	std::size_t n_scan=0;
+	std::size_t n_eph=0;
+	std::size_t n_lost=0;
+	std::size_t n_esc=0;
+	std::size_t max_iter=0;
+	std::size_t max_eval=0;
+	double ms=0.0;
+
+	void add(const RootStat&st,bool ok);
+	void add(const RtSum&o);
+};
+
+struct RtStats{
+	RtSum all;
+	std::size_t n_batch=0;
+	std::size_t n_single=0;
+	std::size_t n_fallback=0;
+	RootPrec prec=RootPrec::AUTO;
+	std::map<std::string,std::size_t> modes;
+	std::map<int,RtSum> years;
+	std::mutex mtx;
+};
+
+RtStats&rt_stats();
+void rt_reset();
+
+void put_stats(std::ostream&os,const std::string&format);
+
 struct RootCtx{
-	SolLunCal*self;
+	std::vector<SolLunCal*> slots;
 	const std::vector<RootTask>*tasks;
 	std::vector<double>*results;
 	std::vector<std::string>*errors;
-	std::atomic<std::size_t>*cursor;
+	std::vector<RootStat>*stats;
+};
+
+enum RtOp : std::int32_t{ RT_SOLAR=0,RT_LUNAR=1,RT_SPAN=2 };
+
+static_assert(RT_SOLAR==static_cast<std::int32_t>(RootKind::SOLAR)&&
+				  RT_LUNAR==static_cast<std::int32_t>(RootKind::LUNAR),
+			  "root op codes");
+
+struct RtReq{
+	std::uint32_t idx;
+	std::int32_t op;
+	std::int32_t max_iter;
+	std::int32_t pad;
+	double target;
+	double jd_initial;
+	double eps_days;
+};
+
+struct RtRes{
+	std::uint32_t idx;
+	std::int32_t ok;
+	double root;
+	RootStat st;
+	char err[84];
 };
 
-void run_wkr(RootCtx*ctx);
+static_assert(sizeof(RtReq)==40&&sizeof(RtRes)==128,"root record layout");
+
+void run_wkr(RootCtx*ctx,std::size_t slot,std::size_t idx);
+
+class RootPool{
+  public:
+	using Job=std::function<void(std::size_t slot,std::size_t idx)>;
+
+	static RootPool&get();
+
+	std::size_t slots() const{ return n_slot_; }
+
+	void run(std::size_t n,const Job&job);
+
+  private:
+	struct Range{
+		std::mutex mtx;
+		std::size_t lo=0;
+		std::size_t hi=0;
+	};
+
+	std::size_t n_slot_=1;
+	std::unique_ptr<Range[]> rng_;
+	std::mutex run_mtx_;
+	std::mutex mtx_;
+	std::condition_variable cv_go_;
+	std::condition_variable cv_done_;
+	const Job*job_=nullptr;
+	unsigned long long gen_=0;
+	std::size_t n_busy_=0;
+
+	explicit RootPool(std::size_t n_slot);
+
+	void loop(std::size_t slot);
+	void drain(std::size_t slot);
+	bool next(std::size_t slot,std::size_t&idx);
+};
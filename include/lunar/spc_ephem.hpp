@@ -1,15 +1,35 @@
 #pragma once
 
 #include<map>
-#include<set>
+#include<memory>
 #include<string>
 #include<utility>
+#include<vector>
 
+#include "lunar/eph_cache.hpp"
+#include "lunar/eph_reg.hpp"
+#include "lunar/lon_fit.hpp"
 #include "lunar/math.hpp"
 
 void cfg_spice();
 void chk_spice(const std::string&context);
 
+EphBack parse_back(const std::string&name);
+std::string back_name(EphBack back);
+
+struct StateBuf{
+	std::vector<double> x,y,z;
+	std::vector<double> vx,vy,vz;
+
+	void resize(std::size_t n);
+
+	std::size_t size() const{ return x.size(); }
+
+	Vec3 pos(std::size_t i) const{ return Vec3(x[i],y[i],z[i]); }
+
+	Vec3 vel(std::size_t i) const{ return Vec3(vx[i],vy[i],vz[i]); }
+};
+
 struct EphRead{
 	std::string filepath;
 	int SSB;
@@ -18,21 +38,41 @@ struct EphRead{
 	int EARTH;
 	int MOON;
 	std::map<int,std::string> id_name;
-	static std::set<std::string> load_paths;
-	static std::set<std::string> val_paths;
+	bool kern_ok=false;
+	EphBack back;
+	std::shared_ptr<const EphReg> reg;
+	std::shared_ptr<const EphemCache> cache;
+	std::shared_ptr<const LonFit> lfit;
+	std::size_t n_call=0;
+	static EphBack def_back;
 
-	explicit EphRead(const std::string&path);
+	explicit EphRead(const std::string&path,EphBack mode=def_back);
 
 	void load_kern();
 
+	bool ready() const{ return kern_ok; }
+
+	bool reentrant() const{ return back!=EphBack::SPICE||lfit!=nullptr; }
+
 	std::string to_name(int code) const;
 
 	void val_kern();
 
 	static double et_fromjd(double jd_tdb);
 
+	const EphemCache&cache_span(double jd_lo,double jd_hi,
+								double tol_km=EphemCache::DEF_TOL_KM);
+
+	void drop_cache(){ cache.reset(); }
+
 	std::pair<Vec3,Vec3> get_state(int target,int observer,double jd_tdb);
 
+	void get_states(int target,int observer,const double*jd_tdb,std::size_t n,
+					StateBuf&out);
+
+	void get_states(int target,int observer,const std::vector<double>&jd_tdb,
+					StateBuf&out);
+
 	Vec3 get_pos(int target,int observer,double jd_tdb);
 
 	Vec3 get_vel(int target,int observer,double jd_tdb);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include<cstdint>
+#include<memory>
+#include<string>
+#include<utility>
+#include<vector>
+
+struct BodyMeta{
+	int body=0;
+	int n_seg=0;
+	std::vector<std::pair<double,double>> win;
+
+	double jd_lo() const{ return win.front().first; }
+
+	double jd_hi() const{ return win.back().second; }
+};
+
+struct SpkMeta{
+	static constexpr int VERSION=2;
+
+	std::string path;
+	std::uintmax_t size=0;
+	long long mtime=0;
+	std::uint64_t hash=0;
+	bool cached=false;
+	std::vector<BodyMeta> bodies;
+
+	const BodyMeta*body(int id) const;
+
+	bool cover(const std::vector<int>&ids,double&jd_lo,double&jd_hi) const;
+};
+
+std::string meta_path(const std::string&path);
+
+std::shared_ptr<const SpkMeta> spk_meta(const std::string&path);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include<cstddef>
+#include<memory>
+#include<string>
+#include<vector>
+
+struct SpkSeg{
+	int target=0;
+	int center=0;
+	int frame=0;
+	int type=0;
+	double et_beg=0.0;
+	double et_end=0.0;
+	double init=0.0;
+	double intlen=0.0;
+	int rsize=0;
+	int n_rec=0;
+	const double*data=nullptr;
+	bool shadow=false;
+	std::string name;
+};
+
+struct SpkSub{
+	std::size_t n_seg=0;
+	std::size_t bytes=0;
+	double et_beg=0.0;
+	double et_end=0.0;
+};
+
+class SpkFile{
+  public:
+	explicit SpkFile(const std::string&path);
+	~SpkFile();
+
+	SpkFile(const SpkFile&)=delete;
+	SpkFile&operator=(const SpkFile&)=delete;
+
+	const std::string&path() const{ return path_; }
+
+	const std::vector<SpkSeg>&segs() const{ return segs_; }
+
+	const SpkSeg*find_seg(int body,double et) const;
+
+	const SpkSeg*find_seg(int body,double et,const SpkSeg*hint) const;
+
+	static void seg_state(const SpkSeg&seg,double et,double st[6]);
+
+	void state(int target,int observer,double et,double st[6]) const;
+
+	void state_n(int target,int observer,const double*et,std::size_t n,
+				 double st[][6]) const;
+
+  private:
+	std::string path_;
+	const unsigned char*base_=nullptr;
+	std::size_t size_=0;
+#ifdef _WIN32
+	void*h_file_=nullptr;
+	void*h_map_=nullptr;
+#else
+	int fd_=-1;
+#endif
+	std::vector<SpkSeg> segs_;
+
+	int find_seg4(int body,const double et[4],const SpkSeg*seg[4],
+				  const SpkSeg*&hint) const;
+	bool state4(int target,int observer,const double et[4],double st[][6],
+				const SpkSeg**hint) const;
+
+	void map_file();
+	void unmap_file();
+	void parse_daf();
+};
+
+std::shared_ptr<const SpkFile> spk_open(const std::string&path);
+
+SpkSub spk_extract(const SpkFile&src,const std::vector<int>&bodies,
+				   double et_lo,double et_hi,const std::string&out_path);
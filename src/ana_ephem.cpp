@@ -0,0 +1,692 @@
+#include "lunar/ana_ephem.hpp"
+
+#include<array>
+#include<cmath>
+#include<stdexcept>
+#include<string>
+
+#include "lunar/frames.hpp"
+
+namespace{
+
+struct VTerm{
+	double a,b,c;
+};
+
+struct LrTerm{
+	signed char d,m,mp,f;
+	double l,r;
+};
+
+struct BTerm{
+	signed char d,m,mp,f;
+	double b;
+};
+
+constexpr double DEG=PI/180.0;
+constexpr double ASEC=DEG/3600.0;
+constexpr double MOON_R0=385000.56;
+constexpr double EMRAT=81.3005690699;
+
+constexpr double kThr=LUNAR_ANA_LEVEL>=2?0.0:
+					  LUNAR_ANA_LEVEL==1?1e-6:1e-5;
+
+constexpr double fabs_c(double x){ return x<0.0?-x:x; }
+
+constexpr bool keep(const VTerm&t){ return t.a*1e-8>=kThr; }
+
+constexpr bool keep(const LrTerm&t){
+	return fabs_c(t.l)*1e-6*DEG>=kThr||fabs_c(t.r)*1e-3/MOON_R0>=kThr;
+}
+
+constexpr bool keep(const BTerm&t){ return fabs_c(t.b)*1e-6*DEG>=kThr; }
+
+template<class T,std::size_t M>
+constexpr std::size_t n_keep(const T(&tab)[M]){
+	std::size_t n=0;
+	for(std::size_t i=0;i<M;++i){
+		if(keep(tab[i])){
+			++n;
+		}
+	}
+	return n;
+}
+
+template<std::size_t N,class T,std::size_t M>
+constexpr std::array<T,N> trunc(const T(&tab)[M]){
+	std::array<T,N> out{};
+	std::size_t k=0;
+	for(std::size_t i=0;i<M;++i){
+		if(keep(tab[i])){
+			out[k++]=tab[i];
+		}
+	}
+	return out;
+}
+
+constexpr VTerm kL0f[]={
+	{175347046,0,0},
+	{3341656,4.6692568,6283.0758500},
+	{34894,4.62610,12566.15170},
+	{3497,2.7441,5753.3849},
+	{3418,2.8289,3.5231},
+	{3136,3.6277,77713.7715},
+	{2676,4.4181,7860.4194},
+	{2343,6.1352,3930.2097},
+	{1324,0.7425,11506.7698},
+	{1273,2.0371,529.6910},
+	{1199,1.1096,1577.3435},
+	{990,5.233,5884.927},
+	{902,2.045,26.298},
+	{857,3.508,398.149},
+	{780,1.179,5223.694},
+	{753,2.533,5507.553},
+	{505,4.583,18849.228},
+	{492,4.205,775.523},
+	{357,2.920,0.067},
+	{317,5.849,11790.629},
+	{284,1.899,796.298},
+	{271,0.315,10977.079},
+	{243,0.345,5486.778},
+	{206,4.806,2544.314},
+	{205,1.869,5573.143},
+	{202,2.458,6069.777},
+	{156,0.833,213.299},
+	{132,3.411,2942.463},
+	{126,1.083,20.775},
+	{115,0.645,0.980},
+	{103,0.636,4694.003},
+	{102,0.976,15720.839},
+	{102,4.267,7.114},
+	{99,6.21,2146.17},
+	{98,0.68,155.42},
+	{86,5.98,161000.69},
+	{85,1.30,6275.96},
+	{85,3.67,71430.70},
+	{80,1.81,17260.15},
+	{79,3.04,12036.46},
+	{75,1.76,5088.63},
+	{74,3.50,3154.69},
+	{74,4.68,801.82},
+	{70,0.83,9437.76},
+	{62,3.98,8827.39},
+	{61,1.82,7084.90},
+	{57,2.78,6286.60},
+	{56,4.39,14143.50},
+	{56,3.47,6279.55},
+	{52,0.19,12139.55},
+	{52,1.33,1748.02},
+	{51,0.28,5856.48},
+	{49,0.49,1194.45},
+	{41,5.37,8429.24},
+	{41,2.40,19651.05},
+	{39,6.17,10447.39},
+	{37,6.04,10213.29},
+	{37,2.57,1059.38},
+	{36,1.71,2352.87},
+	{36,1.78,6812.77},
+	{33,0.59,17789.85},
+	{30,0.44,83996.85},
+	{30,2.74,1349.87},
+	{25,3.16,4690.48},
+};
+
+constexpr VTerm kL1f[]={
+	{628331966747.0,0,0},
+	{206059,2.678235,6283.075850},
+	{4303,2.6351,12566.1517},
+	{425,1.590,3.523},
+	{119,5.796,26.298},
+	{109,2.966,1577.344},
+	{93,2.59,18849.23},
+	{72,1.14,529.69},
+	{68,1.87,398.15},
+	{67,4.41,5507.55},
+	{59,2.89,5223.69},
+	{56,2.17,155.42},
+	{45,0.40,796.30},
+	{36,0.47,775.52},
+	{29,2.65,7.11},
+	{21,5.34,0.98},
+	{19,1.85,5486.78},
+	{19,4.97,213.30},
+	{17,2.99,6275.96},
+	{16,0.03,2544.31},
+	{16,1.43,2146.17},
+	{15,1.21,10977.08},
+	{12,2.83,1748.02},
+	{12,3.26,5088.63},
+	{12,5.27,1194.45},
+	{12,2.08,4694.00},
+	{11,0.77,553.57},
+	{10,1.30,6286.60},
+	{10,4.24,1349.87},
+	{9,2.70,242.73},
+	{9,5.64,951.72},
+	{8,5.30,2352.87},
+	{6,2.65,9437.76},
+	{6,4.67,4690.48},
+};
+
+constexpr VTerm kL2f[]={
+	{52919,0,0},
+	{8720,1.0721,6283.0758},
+	{309,0.867,12566.152},
+	{27,0.05,3.52},
+	{16,5.19,26.30},
+	{16,3.68,155.42},
+	{10,0.76,18849.23},
+	{9,2.06,77713.77},
+	{7,0.83,775.52},
+	{5,4.66,1577.34},
+	{4,1.03,7.11},
+	{4,3.44,5573.14},
+	{3,5.14,796.30},
+	{3,6.05,5507.55},
+	{3,1.19,242.73},
+	{3,6.12,529.69},
+	{3,0.31,398.15},
+	{3,2.28,553.57},
+	{2,4.38,5223.69},
+	{2,3.75,0.98},
+};
+
+constexpr VTerm kL3f[]={
+	{289,5.844,6283.076},
+	{35,0,0},
+	{17,5.49,12566.15},
+	{3,5.20,155.42},
+	{1,4.72,3.52},
+	{1,5.30,18849.23},
+	{1,5.97,242.73},
+};
+
+constexpr VTerm kL4f[]={
+	{114,3.142,0},
+	{8,4.13,6283.08},
+	{1,3.84,12566.15},
+};
+
+constexpr VTerm kL5f[]={
+	{1,3.14,0},
+};
+
+constexpr VTerm kB0f[]={
+	{280,3.199,84334.662},
+	{102,5.422,5507.553},
+	{80,3.88,5223.69},
+	{44,3.70,2352.87},
+	{32,4.00,1577.34},
+};
+
+constexpr VTerm kB1f[]={
+	{9,3.90,5507.55},
+	{6,1.73,5223.69},
+};
+
+constexpr VTerm kR0f[]={
+	{100013989,0,0},
+	{1670700,3.0984635,6283.0758500},
+	{13956,3.05525,12566.15170},
+	{3084,5.1985,77713.7715},
+	{1628,1.1739,5753.3849},
+	{1576,2.8469,7860.4194},
+	{925,5.453,11506.770},
+	{542,4.564,3930.210},
+	{472,3.661,5884.927},
+	{346,0.964,5507.553},
+	{329,5.900,5223.694},
+	{307,0.299,5573.143},
+	{243,4.273,11790.629},
+	{212,5.847,1577.344},
+	{186,5.022,10977.079},
+	{175,3.012,18849.228},
+	{110,5.055,5486.778},
+	{98,0.89,6069.78},
+	{86,5.69,15720.84},
+	{86,1.27,161000.69},
+	{65,0.27,17260.15},
+	{63,0.92,529.69},
+	{57,2.01,83996.85},
+	{56,5.24,71430.70},
+	{49,3.25,2544.31},
+	{47,2.58,775.52},
+	{45,5.54,9437.76},
+	{43,6.01,6275.96},
+	{39,5.36,4694.00},
+	{38,2.39,8827.39},
+	{37,0.83,19651.05},
+	{37,4.90,12139.55},
+	{36,1.67,12036.46},
+	{35,1.84,2942.46},
+	{33,0.24,7084.90},
+	{32,0.18,5088.63},
+	{32,1.78,398.15},
+	{28,1.21,6286.60},
+	{28,1.90,6279.55},
+	{26,4.59,10447.39},
+};
+
+constexpr VTerm kR1f[]={
+	{103019,1.107490,6283.075850},
+	{1721,1.0644,12566.1517},
+	{702,3.142,0},
+	{32,1.02,18849.23},
+	{31,2.84,5507.55},
+	{25,1.32,5223.69},
+	{18,1.42,1577.34},
+	{10,5.91,10977.08},
+	{9,1.42,6275.96},
+	{9,0.27,5486.78},
+};
+
+constexpr VTerm kR2f[]={
+	{4359,5.7846,6283.0758},
+	{124,5.579,12566.152},
+	{12,3.14,0},
+	{9,3.63,77713.77},
+	{6,1.87,5573.14},
+	{3,5.47,18849.23},
+};
+
+constexpr VTerm kR3f[]={
+	{145,4.273,6283.076},
+	{7,3.92,12566.15},
+};
+
+constexpr VTerm kR4f[]={
+	{4,2.56,6283.08},
+};
+
+constexpr LrTerm kLrf[]={
+	{0,0,1,0,6288774,-20905355},
+	{2,0,-1,0,1274027,-3699111},
+	{2,0,0,0,658314,-2955968},
+	{0,0,2,0,213618,-569925},
+	{0,1,0,0,-185116,48888},
+	{0,0,0,2,-114332,-3149},
+	{2,0,-2,0,58793,246158},
+	{2,-1,-1,0,57066,-152138},
+	{2,0,1,0,53322,-170733},
+	{2,-1,0,0,45758,-204586},
+	{0,1,-1,0,-40923,-129620},
+	{1,0,0,0,-34720,108743},
+	{0,1,1,0,-30383,104755},
+	{2,0,0,-2,15327,10321},
+	{0,0,1,2,-12528,0},
+	{0,0,1,-2,10980,79661},
+	{4,0,-1,0,10675,-34782},
+	{0,0,3,0,10034,-23210},
+	{4,0,-2,0,8548,-21636},
+	{2,1,-1,0,-7888,24208},
+	{2,1,0,0,-6766,30824},
+	{1,0,-1,0,-5163,-8379},
+	{1,1,0,0,4987,-16675},
+	{2,-1,1,0,4036,-12831},
+	{2,0,2,0,3994,-10445},
+	{4,0,0,0,3861,-11650},
+	{2,0,-3,0,3665,14403},
+	{0,1,-2,0,-2689,-7003},
+	{2,0,-1,2,-2602,0},
+	{2,-1,-2,0,2390,10056},
+	{1,0,1,0,-2348,6322},
+	{2,-2,0,0,2236,-9884},
+	{0,1,2,0,-2120,5751},
+	{0,2,0,0,-2069,0},
+	{2,-2,-1,0,2048,-4950},
+	{2,0,1,-2,-1773,4130},
+	{2,0,0,2,-1595,0},
+	{4,-1,-1,0,1215,-3958},
+	{0,0,2,2,-1110,0},
+	{3,0,-1,0,-892,3258},
+	{2,1,1,0,-810,2616},
+	{4,-1,-2,0,759,-1897},
+	{0,2,-1,0,-713,-2117},
+	{2,2,-1,0,-700,2354},
+	{2,1,-2,0,691,0},
+	{2,-1,0,-2,596,0},
+	{4,0,1,0,549,-1423},
+	{0,0,4,0,537,-1117},
+	{4,-1,0,0,520,-1571},
+	{1,0,-2,0,-487,-1739},
+	{2,1,0,-2,-399,0},
+	{0,0,2,-2,-381,-4421},
+	{1,1,1,0,351,0},
+	{3,0,-2,0,-340,0},
+	{4,0,-3,0,330,0},
+	{2,-1,2,0,327,0},
+	{0,2,1,0,-323,1165},
+	{1,1,-1,0,299,0},
+	{2,0,3,0,294,0},
+	{2,0,-1,-2,0,8752},
+};
+
+constexpr BTerm kBf[]={
+	{0,0,0,1,5128122},
+	{0,0,1,1,280602},
+	{0,0,1,-1,277693},
+	{2,0,0,-1,173237},
+	{2,0,-1,1,55413},
+	{2,0,-1,-1,46271},
+	{2,0,0,1,32573},
+	{0,0,2,1,17198},
+	{2,0,1,-1,9266},
+	{0,0,2,-1,8822},
+	{2,-1,0,-1,8216},
+	{2,0,-2,-1,4324},
+	{2,0,1,1,4200},
+	{2,1,0,-1,-3359},
+	{2,-1,-1,1,2463},
+	{2,-1,0,1,2211},
+	{2,-1,-1,-1,2065},
+	{0,1,-1,-1,-1870},
+	{4,0,-1,-1,1828},
+	{0,1,0,1,-1794},
+	{0,0,0,3,-1749},
+	{0,1,-1,1,-1565},
+	{1,0,0,1,-1491},
+	{0,1,1,1,-1475},
+	{0,1,1,-1,-1410},
+	{0,1,0,-1,-1344},
+	{1,0,0,-1,-1335},
+	{0,0,3,1,1107},
+	{4,0,0,-1,1021},
+	{4,0,-1,1,833},
+	{0,0,1,-3,777},
+	{4,0,-2,1,671},
+	{2,0,0,-3,607},
+	{2,0,2,-1,596},
+	{2,-1,1,-1,491},
+	{2,0,-2,1,-451},
+	{0,0,3,-1,439},
+	{2,0,2,1,422},
+	{2,0,-3,-1,421},
+	{2,1,-1,1,-366},
+	{2,1,0,1,-351},
+	{4,0,0,1,331},
+	{2,-1,1,1,315},
+	{2,-2,0,-1,302},
+	{0,0,1,3,-283},
+	{2,1,1,-1,-229},
+	{1,1,0,-1,223},
+	{1,1,0,1,223},
+	{0,1,-2,-1,-220},
+	{2,1,-1,-1,-220},
+	{1,0,1,1,-185},
+	{2,-1,-2,-1,181},
+	{0,1,2,1,-177},
+	{4,0,-2,-1,176},
+	{4,-1,-1,-1,166},
+	{1,0,1,-1,-164},
+	{4,0,1,-1,132},
+	{1,0,-1,-1,-119},
+	{4,-1,0,-1,115},
+	{2,-2,0,1,107},
+};
+
+constexpr auto kL0=trunc<n_keep(kL0f)>(kL0f);
+constexpr auto kL1=trunc<n_keep(kL1f)>(kL1f);
+constexpr auto kL2=trunc<n_keep(kL2f)>(kL2f);
+constexpr auto kL3=trunc<n_keep(kL3f)>(kL3f);
+constexpr auto kL4=trunc<n_keep(kL4f)>(kL4f);
+constexpr auto kL5=trunc<n_keep(kL5f)>(kL5f);
+constexpr auto kB0=trunc<n_keep(kB0f)>(kB0f);
+constexpr auto kB1=trunc<n_keep(kB1f)>(kB1f);
+constexpr auto kR0=trunc<n_keep(kR0f)>(kR0f);
+constexpr auto kR1=trunc<n_keep(kR1f)>(kR1f);
+constexpr auto kR2=trunc<n_keep(kR2f)>(kR2f);
+constexpr auto kR3=trunc<n_keep(kR3f)>(kR3f);
+constexpr auto kR4=trunc<n_keep(kR4f)>(kR4f);
+constexpr auto kLr=trunc<n_keep(kLrf)>(kLrf);
+constexpr auto kB=trunc<n_keep(kBf)>(kBf);
+
+template<std::size_t N>
+void vsop_sum(const std::array<VTerm,N>&tab,double t,double&s,double&ds){
+	s=0.0;
+	ds=0.0;
+	for(const VTerm&v : tab){
+		const double arg=v.b+v.c*t;
+		s+=v.a*std::cos(arg);
+		ds-=v.a*v.c*std::sin(arg);
+	}
+}
+
+double horner(const double*s,const double*ds,int n,double t,double&d){
+	double v=0.0;
+	d=0.0;
+	for(int k=n-1;k>=0;--k){
+		d=ds[k]+v+t*d;
+		v=s[k]+t*v;
+	}
+	return v;
+}
+
+void sph_cart(double L,double B,double R,double dL,double dB,double dR,
+			  Vec3&pos,Vec3&vel){
+	const double cL=std::cos(L),sL=std::sin(L);
+	const double cB=std::cos(B),sB=std::sin(B);
+	pos=Vec3(R*cB*cL,R*cB*sL,R*sB);
+	const double dq=dR*cB-R*sB*dB;
+	vel=Vec3(dq*cL-R*cB*sL*dL,dq*sL+R*cB*cL*dL,dR*sB+R*cB*dB);
+}
+
+struct Rot{
+	double c,s;
+};
+
+Rot rot_mul(const Rot&a,const Rot&b){
+	return {a.c*b.c-a.s*b.s,a.s*b.c+a.c*b.s};
+}
+
+void rot_tab(double x,Rot r[5]){
+	r[0]={1.0,0.0};
+	r[1]={std::cos(x),std::sin(x)};
+	for(int k=2;k<5;++k){
+		r[k]=rot_mul(r[k-1],r[1]);
+	}
+}
+
+Rot rot_at(const Rot r[5],int k){
+	return k<0?Rot{r[-k].c,-r[-k].s}:r[k];
+}
+
+double deg_poly(const double c[5],double T,double&d){
+	d=(c[1]+T*(2.0*c[2]+T*(3.0*c[3]+T*4.0*c[4])))*DEG;
+	const double v=c[0]+T*(c[1]+T*(c[2]+T*(c[3]+T*c[4])));
+	return std::fmod(v,360.0)*DEG;
+}
+
+const double kLp[5]={218.3164477,481267.88123421,-0.0015786,1.0/538841.0,
+					 -1.0/65194000.0};
+const double kD[5]={297.8501921,445267.1114034,-0.0018819,1.0/545868.0,
+					-1.0/113065000.0};
+const double kM[5]={357.5291092,35999.0502909,-0.0001536,1.0/24490000.0,
+					0.0};
+const double kMp[5]={134.9633964,477198.8675055,0.0087414,1.0/69699.0,
+					 -1.0/14712000.0};
+const double kF[5]={93.2720950,483202.0175233,-0.0036539,-1.0/3526000.0,
+					1.0/863310000.0};
+
+struct Memo{
+	double jd_e=-1.0;
+	Vec3 ep,ev;
+	double jd_r=-1.0;
+	Mat3 rot;
+};
+
+Memo&memo(){
+	thread_local Memo m;
+	return m;
+}
+
+Mat3 ecl_icrf(double jd_tdb){
+	Memo&mm=memo();
+	if(mm.jd_r==jd_tdb){
+		return mm.rot;
+	}
+	const Mat3 m=CoordTf::R1(PrecNut::mean_obl(jd_tdb))*
+				 PrecNut::prec_mat(jd_tdb)*CoordTf::bias_mat();
+	Mat3 t;
+	for(int i=0;i<3;++i){
+		for(int j=0;j<3;++j){
+			t.m[i][j]=m.m[j][i];
+		}
+	}
+	mm.jd_r=jd_tdb;
+	mm.rot=t;
+	return t;
+}
+
+bool helio_ecl(int id,double jd_tdb,Vec3&pos,Vec3&vel){
+	if(id==0||id==10){
+		pos=Vec3();
+		vel=Vec3();
+		return true;
+	}
+	if(id!=3&&id!=301&&id!=399){
+		return false;
+	}
+	Memo&mm=memo();
+	if(mm.jd_e!=jd_tdb){
+		AnalyticEphem::earth_ecl(jd_tdb,mm.ep,mm.ev);
+		mm.jd_e=jd_tdb;
+	}
+	pos=mm.ep;
+	vel=mm.ev;
+	if(id==399){
+		return true;
+	}
+	Vec3 mp,mv;
+	AnalyticEphem::moon_ecl(jd_tdb,mp,mv);
+	const double f=id==3?1.0/(1.0+EMRAT):1.0;
+	pos+=mp*f;
+	vel+=mv*f;
+	return true;
+}
+
+} // namespace
+
+std::size_t AnalyticEphem::n_terms(){
+	return kL0.size()+kL1.size()+kL2.size()+kL3.size()+kL4.size()+
+		   kL5.size()+kB0.size()+kB1.size()+kR0.size()+kR1.size()+
+		   kR2.size()+kR3.size()+kR4.size()+kLr.size()+kB.size();
+}
+
+void AnalyticEphem::earth_ecl(double jd_tdb,Vec3&pos,Vec3&vel){
+	const double t=(jd_tdb-2451545.0)/365250.0;
+	double s[6],ds[6];
+	vsop_sum(kL0,t,s[0],ds[0]);
+	vsop_sum(kL1,t,s[1],ds[1]);
+	vsop_sum(kL2,t,s[2],ds[2]);
+	vsop_sum(kL3,t,s[3],ds[3]);
+	vsop_sum(kL4,t,s[4],ds[4]);
+	vsop_sum(kL5,t,s[5],ds[5]);
+	double dL;
+	double L=horner(s,ds,6,t,dL)*1e-8;
+	vsop_sum(kB0,t,s[0],ds[0]);
+	vsop_sum(kB1,t,s[1],ds[1]);
+	double dB;
+	double B=horner(s,ds,2,t,dB)*1e-8;
+	vsop_sum(kR0,t,s[0],ds[0]);
+	vsop_sum(kR1,t,s[1],ds[1]);
+	vsop_sum(kR2,t,s[2],ds[2]);
+	vsop_sum(kR3,t,s[3],ds[3]);
+	vsop_sum(kR4,t,s[4],ds[4]);
+	double dR;
+	const double R=horner(s,ds,5,t,dR)*1e-8;
+	const double T=10.0*t;
+	const double lp=L-(1.397+0.00031*T)*T*DEG;
+	L+=-0.09033*ASEC;
+	B+=0.03916*ASEC*(std::cos(lp)-std::sin(lp));
+	const double k=1e-8/365250.0;
+	sph_cart(L,B,R,dL*k,dB*k,dR*k,pos,vel);
+}
+
+void AnalyticEphem::moon_ecl(double jd_tdb,Vec3&pos,Vec3&vel){
+	const double T=(jd_tdb-2451545.0)/36525.0;
+	double dLp,dD,dM,dMp,dF;
+	const double Lp=deg_poly(kLp,T,dLp);
+	const double D=deg_poly(kD,T,dD);
+	const double M=deg_poly(kM,T,dM);
+	const double Mp=deg_poly(kMp,T,dMp);
+	const double F=deg_poly(kF,T,dF);
+	const double E=1.0-T*(0.002516+0.0000074*T);
+	const double ef[3]={1.0,E,E*E};
+	double sl=0.0,dsl=0.0,sr=0.0,dsr=0.0,sb=0.0,dsb=0.0;
+	Rot rD[5],rM[5],rMp[5],rF[5];
+	rot_tab(D,rD);
+	rot_tab(M,rM);
+	rot_tab(Mp,rMp);
+	rot_tab(F,rF);
+	auto arg_at=[&](int d,int m,int mp,int f){
+		return rot_mul(rot_mul(rot_at(rD,d),rot_at(rM,m)),
+					   rot_mul(rot_at(rMp,mp),rot_at(rF,f)));
+	};
+	for(const LrTerm&c : kLr){
+		const Rot a=arg_at(c.d,c.m,c.mp,c.f);
+		const double da=c.d*dD+c.m*dM+c.mp*dMp+c.f*dF;
+		const double e=ef[c.m<0?-c.m:c.m];
+		const double sa=a.s,ca=a.c;
+		sl+=e*c.l*sa;
+		dsl+=e*c.l*ca*da;
+		sr+=e*c.r*ca;
+		dsr-=e*c.r*sa*da;
+	}
+	for(const BTerm&c : kB){
+		const Rot a=arg_at(c.d,c.m,c.mp,c.f);
+		const double da=c.d*dD+c.m*dM+c.mp*dMp+c.f*dF;
+		const double e=ef[c.m<0?-c.m:c.m];
+		sb+=e*c.b*a.s;
+		dsb+=e*c.b*a.c*da;
+	}
+	const double A1=(119.75+131.849*T)*DEG,dA1=131.849*DEG;
+	const double A2=(53.09+479264.290*T)*DEG,dA2=479264.290*DEG;
+	const double A3=(313.45+481266.484*T)*DEG,dA3=481266.484*DEG;
+	sl+=3958.0*std::sin(A1)+1962.0*std::sin(Lp-F)+318.0*std::sin(A2);
+	dsl+=3958.0*std::cos(A1)*dA1+1962.0*std::cos(Lp-F)*(dLp-dF)+
+		 318.0*std::cos(A2)*dA2;
+	sb+=-2235.0*std::sin(Lp)+382.0*std::sin(A3)+175.0*std::sin(A1-F)+
+		175.0*std::sin(A1+F)+127.0*std::sin(Lp-Mp)-115.0*std::sin(Lp+Mp);
+	dsb+=-2235.0*std::cos(Lp)*dLp+382.0*std::cos(A3)*dA3+
+		 175.0*std::cos(A1-F)*(dA1-dF)+175.0*std::cos(A1+F)*(dA1+dF)+
+		 127.0*std::cos(Lp-Mp)*(dLp-dMp)-115.0*std::cos(Lp+Mp)*(dLp+dMp);
+	const double k=1.0/36525.0;
+	const double lam=Lp+sl*1e-6*DEG;
+	const double bet=sb*1e-6*DEG;
+	const double dist=(MOON_R0+sr*1e-3)/AU_KM;
+	sph_cart(lam,bet,dist,(dLp+dsl*1e-6*DEG)*k,dsb*1e-6*DEG*k,
+			 dsr*1e-3/AU_KM*k,pos,vel);
+}
+
+bool AnalyticEphem::body(int id,double jd_tdb,Vec3&pos,Vec3&vel){
+	Vec3 p,v;
+	if(!helio_ecl(id,jd_tdb,p,v)){
+		return false;
+	}
+	const Mat3 m=ecl_icrf(jd_tdb);
+	pos=m*p;
+	vel=m*v;
+	return true;
+}
+
+void AnalyticEphem::state(int target,int observer,double jd_tdb,Vec3&pos,
+						  Vec3&vel){
+	Vec3 tp,tv,op,ov;
+	if(target==301&&observer==399){
+		moon_ecl(jd_tdb,tp,tv);
+	}else{
+		if(!helio_ecl(target,jd_tdb,tp,tv)){
+			throw std::runtime_error("analytic ephemeris has no body "+
+									 std::to_string(target));
+		}
+		if(!helio_ecl(observer,jd_tdb,op,ov)){
+			throw std::runtime_error("analytic ephemeris has no body "+
+									 std::to_string(observer));
+		}
+		tp-=op;
+		tv-=ov;
+	}
+	const Mat3 m=ecl_icrf(jd_tdb);
+	pos=m*tp;
+	vel=m*tv;
+}
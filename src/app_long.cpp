@@ -2,6 +2,33 @@
 
 #include<algorithm>
 #include<cmath>
+#include<stdexcept>
+
+LtMode AberCorr::def_lt=LtMode::ITER;
+
+LtMode parse_lt(const std::string&name){
+	if(name=="iter"){
+		return LtMode::ITER;
+	}
+	if(name=="linear"){
+		return LtMode::LINEAR;
+	}
+	if(name=="vel"){
+		return LtMode::VEL;
+	}
+	throw std::invalid_argument("--light-time must be iter|linear|vel");
+}
+
+std::string lt_name(LtMode mode){
+	switch(mode){
+	case LtMode::LINEAR:
+		return "linear";
+	case LtMode::VEL:
+		return "vel";
+	default:
+		return "iter";
+	}
+}
 
 double AberCorr::lightday(const Vec3&vec){
 	double r=vec.norm();
@@ -24,25 +51,160 @@ RetProp AberCorr::geo_prop(EphRead&eph,int target,double jd_tdb,int max_iter){
 		tr=tr_new;
 	}
 
-	Vec3 xt=eph.get_pos(target,eph.SSB,tr);
-	Vec3 xE=eph.get_pos(eph.EARTH,eph.SSB,tr);
-	Vec3 X=xt-xE;
-
-	Vec3 vt=eph.get_vel(target,eph.SSB,tr);
-	Vec3 vE=eph.get_vel(eph.EARTH,eph.SSB,tr);
-	Vec3 V=vt-vE;
+	auto st_t=eph.get_state(target,eph.SSB,tr);
+	auto st_E=eph.get_state(eph.EARTH,eph.SSB,tr);
+	Vec3 X=st_t.first-st_E.first;
+	Vec3 V=st_t.second-st_E.second;
 
 	return {X,V,tr};
 }
 
+RetProp AberCorr::geo_lt(EphRead&eph,int target,double jd_tdb,LtMode mode){
+	if(mode==LtMode::ITER){
+		return geo_prop(eph,target,jd_tdb);
+	}
+	auto st=eph.get_state(target,eph.EARTH,jd_tdb);
+	const Vec3 X0=st.first;
+	const Vec3 V0=st.second;
+	double lt=lightday(X0);
+	const int n_it=mode==LtMode::LINEAR?1:8;
+	for(int i=0;i<n_it;++i){
+		double lt_new=lightday(X0-V0*lt);
+		bool done=std::fabs(lt_new-lt)<1e-12;
+		lt=lt_new;
+		if(done){
+			break;
+		}
+	}
+	const double tr=jd_tdb-lt;
+	if(mode==LtMode::LINEAR){
+		return {X0-V0*lt,V0,tr};
+	}
+	st=eph.get_state(target,eph.EARTH,tr);
+	return {st.first,st.second,tr};
+}
+
+void AberCorr::geo_lt_n(EphRead&eph,int target,const double*jd_tdb,
+						std::size_t n,std::vector<RetProp>&out,LtMode mode){
+	if(mode==LtMode::ITER){
+		geo_prop_n(eph,target,jd_tdb,n,out);
+		return;
+	}
+	out.resize(n);
+	StateBuf buf;
+	eph.get_states(target,eph.EARTH,jd_tdb,n,buf);
+	std::vector<double> tr(n);
+	const int n_it=mode==LtMode::LINEAR?1:8;
+	for(std::size_t i=0;i<n;++i){
+		const Vec3 X0=buf.pos(i);
+		const Vec3 V0=buf.vel(i);
+		double lt=lightday(X0);
+		for(int k=0;k<n_it;++k){
+			double lt_new=lightday(X0-V0*lt);
+			bool done=std::fabs(lt_new-lt)<1e-12;
+			lt=lt_new;
+			if(done){
+				break;
+			}
+		}
+		tr[i]=jd_tdb[i]-lt;
+		out[i]={X0-V0*lt,V0,tr[i]};
+	}
+	if(mode==LtMode::LINEAR){
+		return;
+	}
+	eph.get_states(target,eph.EARTH,tr,buf);
+	for(std::size_t i=0;i<n;++i){
+		out[i]={buf.pos(i),buf.vel(i),tr[i]};
+	}
+}
+
+void AberCorr::geo_prop_sm(EphRead&eph,double jd_tdb,RetProp&sun,
+						   RetProp&moon,int max_iter){
+	const int tgt[2]={eph.SUN,eph.MOON};
+	double tr[2]={jd_tdb,jd_tdb};
+	bool live[2]={true,true};
+	Vec3 xE_jd;
+	bool have_jd=false;
+	for(int i=0;i<max_iter&&(live[0]||live[1]);++i){
+		for(int l=0;l<2;++l){
+			if(!live[l]){
+				continue;
+			}
+			Vec3 xt=eph.get_pos(tgt[l],eph.SSB,tr[l]);
+			Vec3 xE;
+			if(tr[l]==jd_tdb){
+				if(!have_jd){
+					xE_jd=eph.get_pos(eph.EARTH,eph.SSB,jd_tdb);
+					have_jd=true;
+				}
+				xE=xE_jd;
+			}else{
+				xE=eph.get_pos(eph.EARTH,eph.SSB,tr[l]);
+			}
+			double tr_new=jd_tdb-lightday(xt-xE);
+			live[l]=!(std::fabs(tr_new-tr[l])<1e-12);
+			tr[l]=tr_new;
+		}
+	}
+
+	RetProp*out[2]={&sun,&moon};
+	for(int l=0;l<2;++l){
+		auto st_t=eph.get_state(tgt[l],eph.SSB,tr[l]);
+		auto st_E=eph.get_state(eph.EARTH,eph.SSB,tr[l]);
+		*out[l]={st_t.first-st_E.first,st_t.second-st_E.second,tr[l]};
+	}
+}
+
+void AberCorr::geo_prop_n(EphRead&eph,int target,const double*jd_tdb,
+						  std::size_t n,std::vector<RetProp>&out,int max_iter){
+	out.resize(n);
+	std::vector<double> tr(jd_tdb,jd_tdb+n);
+	std::vector<std::size_t> live(n);
+	for(std::size_t i=0;i<n;++i){
+		live[i]=i;
+	}
+	std::vector<double> ep;
+	StateBuf bt;
+	StateBuf bE;
+	for(int it=0;it<max_iter&&!live.empty();++it){
+		ep.resize(live.size());
+		for(std::size_t k=0;k<live.size();++k){
+			ep[k]=tr[live[k]];
+		}
+		eph.get_states(target,eph.SSB,ep,bt);
+		eph.get_states(eph.EARTH,eph.SSB,ep,bE);
+		std::size_t m=0;
+		for(std::size_t k=0;k<live.size();++k){
+			const std::size_t i=live[k];
+			Vec3 X=bt.pos(k)-bE.pos(k);
+			double lt=lightday(X);
+			double tr_new=jd_tdb[i]-lt;
+			bool done=std::fabs(tr_new-tr[i])<1e-12;
+			tr[i]=tr_new;
+			if(!done){
+				live[m++]=i;
+			}
+		}
+		live.resize(m);
+	}
+
+	eph.get_states(target,eph.SSB,tr,bt);
+	eph.get_states(eph.EARTH,eph.SSB,tr,bE);
+	for(std::size_t i=0;i<n;++i){
+		out[i]={bt.pos(i)-bE.pos(i),bt.vel(i)-bE.vel(i),tr[i]};
+	}
+}
+
 Vec3 AberCorr::geo_app(EphRead&eph,int target,double jd_tdb,int max_iter){
 	return geo_app(eph,target,jd_tdb,nullptr,max_iter);
 }
 
 Vec3 AberCorr::geo_app(EphRead&eph,int target,double jd_tdb,double*tr_out,
 					   int max_iter){
-	Vec3 xE_t=eph.get_pos(eph.EARTH,eph.SSB,jd_tdb);
-	Vec3 vE_t=eph.get_vel(eph.EARTH,eph.SSB,jd_tdb);
+	auto st_E=eph.get_state(eph.EARTH,eph.SSB,jd_tdb);
+	const Vec3&xE_t=st_E.first;
+	const Vec3&vE_t=st_E.second;
 
 	double tr=jd_tdb;
 	Vec3 xt=eph.get_pos(target,eph.SSB,tr);
@@ -85,8 +247,8 @@ Vec3 AberCorr::geo_app(EphRead&eph,int target,double jd_tdb,double*tr_out,
 }
 
 AppLon::AppLon(EphRead&reader)
-	: eph(reader),frame_bias(CoordTf::bias_mat()),prec_ok(false),r1n_ok(false),
-	  rot_ok(false){}
+	: eph(reader),frame_bias(CoordTf::bias_mat()),lt(AberCorr::def_lt),
+	  fc_on(FrameCache::def_on),prec_ok(false),r1n_ok(false),rot_ok(false){}
 
 double AppLon::epsA(double jd_tdb){ return PrecNut::mean_obl(jd_tdb); }
 
@@ -116,19 +278,35 @@ Mat3 AppLon::prec_mat(double jd_tdb){
 
 Mat3 AppLon::rot_mat(double jd_tdb){
 	if(!rot_ok||rot_jd!=jd_tdb){
-		Mat3 P=prec_mat(jd_tdb);
-		Mat3 R1N=R1_eps_N(jd_tdb);
-		rot_cache=R1N*P*frame_bias;
+		++n_rot;
+		Mat3 P;
+		Mat3 R1N;
+		if(fc_on&&fc_eval(jd_tdb,R1N,P)){
+			rot_cache=R1N*P*frame_bias;
+		}else{
+			rot_cache=PrecNut::ecl_mat(jd_tdb);
+		}
 		rot_jd=jd_tdb;
 		rot_ok=true;
 	}
 	return rot_cache;
 }
 
-std::pair<double,double> AppLon::sun_calc(double jd_tdb){
-	RetProp st=AberCorr::geo_prop(eph,eph.SUN,jd_tdb);
+bool AppLon::fc_eval(double jd_tdb,Mat3&r1n,Mat3&prec){
+	for(int i=0;i<2;++i){
+		if(fc[i]&&fc[i]->eval(jd_tdb,r1n,prec)){
+			if(i==1){
+				std::swap(fc[0],fc[1]);
+			}
+			return true;
+		}
+	}
+	fc[1]=std::move(fc[0]);
+	fc[0]=frame_cache(jd_tdb);
+	return fc[0]->eval(jd_tdb,r1n,prec);
+}
 
-	Mat3 R=rot_mat(jd_tdb);
+std::pair<double,double> AppLon::lon_rate(const Mat3&R,const RetProp&st){
 	Vec3 Xec=R*st.X;
 	double lam=std::atan2(Xec.y,Xec.x);
 	if(lam<0){
@@ -145,22 +323,92 @@ std::pair<double,double> AppLon::sun_calc(double jd_tdb){
 	return {lam,lam_dot};
 }
 
+std::pair<double,double> AppLon::sun_calc(double jd_tdb){
+	if(eph.lfit){
+		return eph.lfit->sun(jd_tdb);
+	}
+	RetProp st=AberCorr::geo_lt(eph,eph.SUN,jd_tdb,lt);
+	return lon_rate(rot_mat(jd_tdb),st);
+}
+
 std::pair<double,double> AppLon::moon_calc(double jd_tdb){
-	RetProp st=AberCorr::geo_prop(eph,eph.MOON,jd_tdb);
+	if(eph.lfit){
+		return eph.lfit->moon(jd_tdb);
+	}
+	RetProp st=AberCorr::geo_lt(eph,eph.MOON,jd_tdb,lt);
+	return lon_rate(rot_mat(jd_tdb),st);
+}
 
-	Mat3 R=rot_mat(jd_tdb);
-	Vec3 Xec=R*st.X;
-	double lam=std::atan2(Xec.y,Xec.x);
-	if(lam<0){
-		lam+=TWO_PI;
+SunMoon AppLon::sun_moon_calc(double jd_tdb){
+	if(eph.lfit){
+		return {eph.lfit->sun(jd_tdb),eph.lfit->moon(jd_tdb)};
 	}
+	RetProp st_s;
+	RetProp st_m;
+	if(lt==LtMode::ITER){
+		AberCorr::geo_prop_sm(eph,jd_tdb,st_s,st_m);
+	}else{
+		st_s=AberCorr::geo_lt(eph,eph.SUN,jd_tdb,lt);
+		st_m=AberCorr::geo_lt(eph,eph.MOON,jd_tdb,lt);
+	}
+	const Mat3 R=rot_mat(jd_tdb);
+	return {lon_rate(R,st_s),lon_rate(R,st_m)};
+}
 
-	Vec3 Xec_dot=R*st.V;
+void AppLon::lon_n(int target,const double*jd_tdb,std::size_t n,double*lam,
+				   double*lam_dot){
+	if(eph.lfit){
+		for(std::size_t i=0;i<n;++i){
+			auto lr=target==eph.MOON?eph.lfit->moon(jd_tdb[i])
+									:eph.lfit->sun(jd_tdb[i]);
+			lam[i]=lr.first;
+			lam_dot[i]=lr.second;
+		}
+		return;
+	}
+	std::vector<RetProp> st;
+	AberCorr::geo_lt_n(eph,target,jd_tdb,n,st,lt);
+	for(std::size_t i=0;i<n;++i){
+		auto lr=lon_rate(rot_mat(jd_tdb[i]),st[i]);
+		lam[i]=lr.first;
+		lam_dot[i]=lr.second;
+	}
+}
 
-	double denom=Xec.x*Xec.x+Xec.y*Xec.y;
-	double lam_dot=0.0;
-	if(denom!=0.0){
-		lam_dot=(Xec.x*Xec_dot.y-Xec.y*Xec_dot.x)/denom;
+void AppLon::sun_calc_n(const double*jd_tdb,std::size_t n,double*lam,
+						double*lam_dot){
+	lon_n(eph.SUN,jd_tdb,n,lam,lam_dot);
+}
+
+void AppLon::moon_calc_n(const double*jd_tdb,std::size_t n,double*lam,
+						 double*lam_dot){
+	lon_n(eph.MOON,jd_tdb,n,lam,lam_dot);
+}
+
+void AppLon::sun_moon_n(const double*jd_tdb,std::size_t n,double*lam_s,
+						double*dot_s,double*lam_m,double*dot_m){
+	if(eph.lfit){
+		for(std::size_t i=0;i<n;++i){
+			auto ls=eph.lfit->sun(jd_tdb[i]);
+			auto lm=eph.lfit->moon(jd_tdb[i]);
+			lam_s[i]=ls.first;
+			dot_s[i]=ls.second;
+			lam_m[i]=lm.first;
+			dot_m[i]=lm.second;
+		}
+		return;
+	}
+	std::vector<RetProp> st_s;
+	std::vector<RetProp> st_m;
+	AberCorr::geo_lt_n(eph,eph.SUN,jd_tdb,n,st_s,lt);
+	AberCorr::geo_lt_n(eph,eph.MOON,jd_tdb,n,st_m,lt);
+	for(std::size_t i=0;i<n;++i){
+		const Mat3 R=rot_mat(jd_tdb[i]);
+		auto ls=lon_rate(R,st_s[i]);
+		auto lm=lon_rate(R,st_m[i]);
+		lam_s[i]=ls.first;
+		dot_s[i]=ls.second;
+		lam_m[i]=lm.first;
+		dot_m[i]=lm.second;
 	}
-	return {lam,lam_dot};
 }
@@ -0,0 +1,1310 @@
+#include "lunar/cli.hpp"
+#include "lunar/cli_common.hpp"
+
+#include<algorithm>
+#include<array>
+#include<chrono>
+#include<cmath>
+#include<cstring>
+#include<functional>
+#include<iomanip>
+#include<iostream>
+#include<sstream>
+#include<stdexcept>
+#include<string>
+#include<thread>
+#include<unordered_map>
+#include<utility>
+#include<vector>
+
+#include "lunar/ana_ephem.hpp"
+#include "lunar/app_long.hpp"
+#include "lunar/calendar.hpp"
+#include "lunar/cheb_simd.hpp"
+#include "lunar/eph_cache.hpp"
+#include "lunar/js_writer.hpp"
+#include "lunar/lon_fit.hpp"
+#include "lunar/nut_ser.hpp"
+#include "lunar/root_proc.hpp"
+#include "lunar/spc_ephem.hpp"
+#include "lunar/spk_native.hpp"
+
+extern "C"{
+#include "SpiceUsr.h"
+}
+
+namespace{
+
+using cli_util::OutTgt;
+using cli_util::chk_fmt;
+using cli_util::note_out;
+using cli_util::open_out;
+using cli_util::parse_bool01;
+using cli_util::parse_int;
+using cli_util::req_val;
+using cli_util::to_low;
+
+using OptHandler=
+	std::function<void(const std::vector<std::string>&,std::size_t&,
+					   const std::string&)>;
+using OptMap=std::unordered_map<std::string,OptHandler>;
+
+void apply_opt(const OptMap&handlers,const std::vector<std::string>&args,
+			   std::size_t&idx,const std::string&opt,const std::string&ctx){
+	auto it=handlers.find(opt);
+	if(it==handlers.end()){
+		throw std::invalid_argument("unknown "+ctx+" option: "+opt);
+	}
+	it->second(args,idx,opt);
+}
+
+using FmtHandler=std::function<void()>;
+using FmtMap=std::unordered_map<std::string,FmtHandler>;
+
+void run_fmt(const FmtMap&handlers,const std::string&format,
+			 const std::string&ctx){
+	auto it=handlers.find(format);
+	if(it==handlers.end()){
+		throw std::invalid_argument("unsupported "+ctx+" format: "+format);
+	}
+	it->second();
+}
+
+using BenchClock=std::chrono::steady_clock;
+
+struct BenchRow{
+	std::string sect;
+	std::string name;
+	double value=0.0;
+	std::string unit;
+};
+
+struct BenchCfg{
+	std::string ephem;
+	int iters=20000;
+	double jd0=2460676.5;
+};
+
+volatile double bench_sink=0.0;
+
+template<typename Fn> double ns_per(int n,Fn&&fn){
+	auto t0=BenchClock::now();
+	for(int i=0;i<n;++i){
+		fn(i);
+	}
+	auto t1=BenchClock::now();
+	return std::chrono::duration<double,std::nano>(t1-t0).count()/
+		   static_cast<double>(n);
+}
+
+std::vector<double> bench_roots(SolLunCal&sv,int year,double jd0){
+	std::vector<double> out;
+	for(const auto&p : SolLunCal::st_defs()){
+		double jd=SolLunCal::st_guess(year,p.first);
+		out.push_back(sv.newton<RootKind::SOLAR>(jd,p.second.lambda));
+	}
+	for(int k=0;k<13;++k){
+		out.push_back(sv.newton<RootKind::LUNAR>(jd0+20.0+k*SYNODDAY,0.0));
+	}
+	return out;
+}
+
+void bn_handle(EphRead&eph,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	const int n=cfg.iters;
+	double slow=ns_per(n,[&](int i){
+		eph.load_kern();
+		bench_sink=bench_sink+eph.get_pos(eph.MOON,eph.SSB,cfg.jd0+i*0.01).x;
+	});
+	double fast=ns_per(n,[&](int i){
+		bench_sink=bench_sink+eph.get_pos(eph.MOON,eph.SSB,cfg.jd0+i*0.01).x;
+	});
+	rows.push_back({"handle","get_state_chk",slow,"ns/call"});
+	rows.push_back({"handle","get_state",fast,"ns/call"});
+	rows.push_back({"handle","speedup",fast>0.0?slow/fast:0.0,"x"});
+}
+
+void bn_native(EphRead&,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	const int n=cfg.iters;
+	EphRead e_sp(cfg.ephem,EphBack::SPICE);
+	EphRead e_nt(cfg.ephem,EphBack::NATIVE);
+	const int moon=e_sp.MOON;
+	const int ssb=e_sp.SSB;
+	double t_sp=ns_per(n,[&](int i){
+		bench_sink=bench_sink+e_sp.get_pos(moon,ssb,cfg.jd0+i*0.01).x;
+	});
+	double t_nt=ns_per(n,[&](int i){
+		bench_sink=bench_sink+e_nt.get_pos(moon,ssb,cfg.jd0+i*0.01).x;
+	});
+	double max_ulp=0.0;
+	double max_km=0.0;
+	for(int i=0;i<256;++i){
+		double jd=cfg.jd0+i*1.37;
+		for(int body : {e_sp.SUN,e_sp.EMB,e_sp.MOON,e_sp.EARTH}){
+			auto a=e_sp.get_state(body,e_sp.SSB,jd);
+			auto b=e_nt.get_state(body,e_nt.SSB,jd);
+			const double va[3]={a.first.x,a.first.y,a.first.z};
+			const double vb[3]={b.first.x,b.first.y,b.first.z};
+			for(int k=0;k<3;++k){
+				max_ulp=std::max(max_ulp,ulp_dist(va[k],vb[k]));
+				max_km=std::max(max_km,std::fabs(va[k]-vb[k])*AU_KM);
+			}
+		}
+	}
+	rows.push_back({"native","spice",t_sp,"ns/call"});
+	rows.push_back({"native","spk_native",t_nt,"ns/call"});
+	rows.push_back({"native","speedup",t_nt>0.0?t_sp/t_nt:0.0,"x"});
+	rows.push_back({"native","max_ulp",max_ulp,"ulp"});
+	rows.push_back({"native","max_diff",max_km,"km"});
+}
+
+void bn_cheb(EphRead&,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	const int n=cfg.iters;
+	auto spk=spk_open(cfg.ephem);
+	EphRead e_sp(cfg.ephem,EphBack::SPICE);
+	const double et0=EphRead::et_fromjd(cfg.jd0);
+	const SpkSeg*seg=spk->find_seg(e_sp.MOON,et0);
+	if(seg==nullptr||(seg->type!=2&&seg->type!=3)){
+		throw std::runtime_error("bench cheb: no Chebyshev Moon segment");
+	}
+	const int ncf=(seg->rsize-2)/(seg->type==2?3:6);
+	const double*rec=seg->data;
+	const double span=rec[1];
+	const ChebIsa isa0=cheb_isa();
+	const bool has_avx=cheb_use(ChebIsa::AVX2);
+
+	std::vector<double> et(static_cast<std::size_t>(n));
+	for(int i=0;i<n;++i){
+		et[static_cast<std::size_t>(i)]=et0+i*60.0;
+	}
+	std::vector<double> ets(et.size());
+	for(std::size_t i=0;i<ets.size();++i){
+		ets[i]=rec[0]-span+2.0*span*static_cast<double>(i%997)/997.0;
+	}
+	std::vector<std::array<double,6>> ref(et.size());
+	std::vector<std::array<double,6>> out(et.size());
+
+	cheb_use(ChebIsa::SCALAR);
+	double t_sc=ns_per(n,[&](int i){
+		const std::size_t k=static_cast<std::size_t>(i);
+		cheb_rec(rec,seg->type,ncf,ets[k],ref[k].data());
+	});
+	double t_st=ns_per(n,[&](int i){
+		const std::size_t k=static_cast<std::size_t>(i);
+		spk->state(e_sp.MOON,e_sp.SSB,et[k],out[k].data());
+	});
+	double t_bs=ns_per(1,[&](int){
+		spk->state_n(e_sp.MOON,e_sp.SSB,et.data(),et.size(),
+					 reinterpret_cast<double(*)[6]>(out[0].data()));
+	})/n;
+	rows.push_back({"cheb","rec_scalar",t_sc,"ns/rec"});
+	rows.push_back({"cheb","state_scalar",t_st,"ns/epoch"});
+	rows.push_back({"cheb","state_n_scalar",t_bs,"ns/epoch"});
+
+	double max_ulp=0.0;
+	if(has_avx){
+		cheb_use(ChebIsa::AVX2);
+		double t_av=ns_per(n,[&](int i){
+			const std::size_t k=static_cast<std::size_t>(i);
+			cheb_rec(rec,seg->type,ncf,ets[k],out[k].data());
+		});
+		for(std::size_t k=0;k<out.size();++k){
+			for(int c=0;c<6;++c){
+				max_ulp=std::max(max_ulp,ulp_dist(ref[k][c],out[k][c]));
+			}
+		}
+		double t_sa=ns_per(n,[&](int i){
+			const std::size_t k=static_cast<std::size_t>(i);
+			spk->state(e_sp.MOON,e_sp.SSB,et[k],out[k].data());
+		});
+		double t_ba=ns_per(1,[&](int){
+			spk->state_n(e_sp.MOON,e_sp.SSB,et.data(),et.size(),
+						 reinterpret_cast<double(*)[6]>(out[0].data()));
+		})/n;
+		for(std::size_t k=0;k<et.size();++k){
+			double st[6];
+			cheb_use(ChebIsa::SCALAR);
+			spk->state(e_sp.MOON,e_sp.SSB,et[k],st);
+			cheb_use(ChebIsa::AVX2);
+			for(int c=0;c<6;++c){
+				max_ulp=std::max(max_ulp,ulp_dist(st[c],out[k][c]));
+			}
+		}
+		rows.push_back({"cheb","rec_avx2",t_av,"ns/rec"});
+		rows.push_back({"cheb","state_avx2",t_sa,"ns/epoch"});
+		rows.push_back({"cheb","state_n_avx2",t_ba,"ns/epoch"});
+	}
+	double t_sp=ns_per(n,[&](int i){
+		const std::size_t k=static_cast<std::size_t>(i);
+		bench_sink=bench_sink+
+				   e_sp.get_pos(e_sp.MOON,e_sp.SSB,2451545.0+et[k]/SEC_DAY).x;
+	});
+	cheb_use(isa0);
+	rows.push_back({"cheb","spice",t_sp,"ns/epoch"});
+	rows.push_back({"cheb","avx2_ulp",max_ulp,"ulp"});
+	rows.push_back({"cheb","avx2",has_avx?1.0:0.0,"bool"});
+}
+
+void bn_state(EphRead&eph,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	const int n=cfg.iters;
+	EphRead e_sp(cfg.ephem,EphBack::SPICE);
+	double t_nm=ns_per(n,[&](int i){
+		const std::string tn=e_sp.to_name(e_sp.MOON);
+		const std::string on=e_sp.to_name(e_sp.SSB);
+		SpiceDouble st[6];
+		SpiceDouble lt;
+		spkezr_c(tn.c_str(),EphRead::et_fromjd(cfg.jd0+i*0.01),"J2000","NONE",
+				 on.c_str(),st,&lt);
+		chk_spice("spkezr_c failed for target "+tn+" observer "+on);
+		bench_sink=bench_sink+st[0];
+	});
+	double t_id=ns_per(n,[&](int i){
+		bench_sink=bench_sink+
+				   e_sp.get_state(e_sp.MOON,e_sp.SSB,cfg.jd0+i*0.01).first.x;
+	});
+	double t_ps=ns_per(n,[&](int i){
+		bench_sink=bench_sink+e_sp.get_pos(e_sp.MOON,e_sp.SSB,cfg.jd0+i*0.01).x;
+	});
+	double t_gp=ns_per(n,[&](int i){
+		bench_sink=bench_sink+
+				   AberCorr::geo_prop(eph,eph.MOON,cfg.jd0+i*0.01).X.x;
+	});
+	rows.push_back({"state","spkezr_c_names",t_nm,"ns/call"});
+	rows.push_back({"state","get_state_ids",t_id,"ns/call"});
+	rows.push_back({"state","get_pos_ids",t_ps,"ns/call"});
+	rows.push_back({"state","geo_prop",t_gp,"ns/call"});
+}
+
+void bn_batch(EphRead&eph,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	const int blk=256;
+	const int n_blk=std::max(1,cfg.iters/blk);
+	std::vector<double> jd(blk);
+	for(int k=0;k<blk;++k){
+		jd[k]=cfg.jd0+k*1.0;
+	}
+	StateBuf buf;
+	double t_one=ns_per(n_blk,[&](int i){
+		const double dt=i*1e-3;
+		for(int k=0;k<blk;++k){
+			auto st=eph.get_state(eph.MOON,eph.SSB,jd[k]+dt);
+			bench_sink=bench_sink+st.first.x;
+		}
+	});
+	std::vector<double> ep(blk);
+	double t_bat=ns_per(n_blk,[&](int i){
+		for(int k=0;k<blk;++k){
+			ep[k]=jd[k]+i*1e-3;
+		}
+		eph.get_states(eph.MOON,eph.SSB,ep,buf);
+		bench_sink=bench_sink+buf.x[0];
+	});
+	double t_gp=ns_per(n_blk,[&](int){
+		for(int k=0;k<blk;++k){
+			bench_sink=bench_sink+AberCorr::geo_prop(eph,eph.MOON,jd[k]).X.x;
+		}
+	});
+	std::vector<RetProp> gp;
+	double t_gpn=ns_per(n_blk,[&](int){
+		AberCorr::geo_prop_n(eph,eph.MOON,jd.data(),jd.size(),gp);
+		bench_sink=bench_sink+gp[0].X.x;
+	});
+	double max_ulp=0.0;
+	for(int k=0;k<blk;++k){
+		RetProp a=AberCorr::geo_prop(eph,eph.MOON,jd[k]);
+		const double va[6]={a.X.x,a.X.y,a.X.z,a.V.x,a.V.y,a.V.z};
+		const double vb[6]={gp[k].X.x,gp[k].X.y,gp[k].X.z,
+							gp[k].V.x,gp[k].V.y,gp[k].V.z};
+		for(int c=0;c<6;++c){
+			max_ulp=std::max(max_ulp,ulp_dist(va[c],vb[c]));
+		}
+	}
+	rows.push_back({"batch","get_state_loop",t_one/blk,"ns/epoch"});
+	rows.push_back({"batch","get_states",t_bat/blk,"ns/epoch"});
+	rows.push_back({"batch","speedup",t_one/t_bat,"x"});
+	rows.push_back({"batch","geo_prop_loop",t_gp/blk,"ns/epoch"});
+	rows.push_back({"batch","geo_prop_n",t_gpn/blk,"ns/epoch"});
+	rows.push_back({"batch","geo_prop_ulp",max_ulp,"ulp"});
+}
+
+void bn_hcache(EphRead&,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	const double span=430.0;
+	EphRead e_raw(cfg.ephem);
+	EphRead e_hc(cfg.ephem);
+	e_hc.load_kern();
+	auto t0=BenchClock::now();
+	const EphemCache&hc=e_hc.cache_span(cfg.jd0,cfg.jd0+span);
+	auto t1=BenchClock::now();
+	double max_mm=0.0;
+	double max_vel=0.0;
+	for(int i=0;i<4096;++i){
+		double jd=cfg.jd0+std::fmod(i*0.2137,span);
+		for(int body : {e_raw.SUN,e_raw.EARTH,e_raw.MOON}){
+			auto a=e_raw.get_state(body,e_raw.SSB,jd);
+			auto b=e_hc.get_state(body,e_hc.SSB,jd);
+			max_mm=std::max(max_mm,(a.first-b.first).norm()*AU_KM*1e6);
+			max_vel=std::max(max_vel,(a.second-b.second).norm()*AU_KM*1e6/
+										 SEC_DAY);
+		}
+	}
+	const int n=cfg.iters;
+	double t_raw=ns_per(n,[&](int i){
+		double jd=cfg.jd0+std::fmod(i*0.01,span);
+		bench_sink=bench_sink+e_raw.get_state(e_raw.MOON,e_raw.SSB,jd).first.x;
+	});
+	double t_hc=ns_per(n,[&](int i){
+		double jd=cfg.jd0+std::fmod(i*0.01,span);
+		bench_sink=bench_sink+e_hc.get_state(e_hc.MOON,e_hc.SSB,jd).first.x;
+	});
+
+	int year=0,month=0,day=0,hour=0,minute=0;
+	double second=0.0;
+	jd2greg(cfg.jd0+span*0.5,year,month,day,hour,minute,second);
+	SolLunCal s_raw(e_raw);
+	SolLunCal s_hc(e_hc);
+	s_raw.use_cache=false;
+	s_hc.use_cache=true;
+	auto t2=BenchClock::now();
+	const std::vector<double> r_raw=bench_roots(s_raw,year,cfg.jd0);
+	auto t3=BenchClock::now();
+	const std::vector<double> r_hc=bench_roots(s_hc,year,cfg.jd0);
+	auto t4=BenchClock::now();
+	double max_sec=0.0;
+	for(std::size_t k=0;k<r_raw.size();++k){
+		max_sec=std::max(max_sec,std::fabs(r_raw[k]-r_hc[k])*SEC_DAY);
+	}
+	auto ms=[](BenchClock::duration d){
+		return std::chrono::duration<double,std::milli>(d).count();
+	};
+	rows.push_back({"hcache","build",ms(t1-t0),"ms"});
+	rows.push_back({"hcache","step",hc.step(),"day"});
+	rows.push_back({"hcache","nodes",static_cast<double>(hc.nodes()),"n"});
+	rows.push_back({"hcache","stated_err",hc.err_km()*1e6,"mm"});
+	rows.push_back({"hcache","max_pos_err",max_mm,"mm"});
+	rows.push_back({"hcache","max_vel_err",max_vel,"mm/s"});
+	rows.push_back({"hcache","get_state",t_raw,"ns/call"});
+	rows.push_back({"hcache","get_state_cached",t_hc,"ns/call"});
+	rows.push_back({"hcache","state_speedup",t_hc>0.0?t_raw/t_hc:0.0,"x"});
+	rows.push_back({"hcache","solve",ms(t3-t2),"ms"});
+	rows.push_back({"hcache","solve_cached",ms(t4-t3),"ms"});
+	rows.push_back({"hcache","solve_speedup",ms(t3-t2)/ms(t4-t3),"x"});
+	rows.push_back({"hcache","max_root_diff",max_sec,"s"});
+}
+
+void bn_fit(EphRead&eph,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	const double span=730.0;
+	auto t0=BenchClock::now();
+	LonFit fit=LonFit::build(eph,cfg.jd0,cfg.jd0+span);
+	auto t1=BenchClock::now();
+	AppLon app(eph);
+	const int n=cfg.iters;
+	auto at=[&](int i){ return cfg.jd0+std::fmod(i*0.37,span); };
+	double t_sp=ns_per(n,[&](int i){
+		bench_sink=bench_sink+app.sun_calc(at(i)).first;
+	});
+	double t_mp=ns_per(n,[&](int i){
+		bench_sink=bench_sink+app.moon_calc(at(i)).first;
+	});
+	double t_sf=ns_per(n,[&](int i){
+		bench_sink=bench_sink+fit.sun(at(i)).first;
+	});
+	double t_mf=ns_per(n,[&](int i){
+		bench_sink=bench_sink+fit.moon(at(i)).first;
+	});
+	double max_s=0.0;
+	double max_m=0.0;
+	for(int i=0;i<4096;++i){
+		double jd=cfg.jd0+std::fmod(i*0.1931,span);
+		max_s=std::max(max_s,std::fabs(std::remainder(
+								 app.sun_calc(jd).first-fit.sun(jd).first,
+								 TWO_PI)));
+		max_m=std::max(max_m,std::fabs(std::remainder(
+								 app.moon_calc(jd).first-fit.moon(jd).first,
+								 TWO_PI)));
+	}
+	const double to_as=180.0/PI*3600.0;
+	rows.push_back({"fit","build_2y",
+					std::chrono::duration<double,std::milli>(t1-t0).count(),
+					"ms"});
+	rows.push_back({"fit","sun_calc",t_sp,"ns/call"});
+	rows.push_back({"fit","sun_fit",t_sf,"ns/call"});
+	rows.push_back({"fit","sun_speedup",t_sf>0.0?t_sp/t_sf:0.0,"x"});
+	rows.push_back({"fit","moon_calc",t_mp,"ns/call"});
+	rows.push_back({"fit","moon_fit",t_mf,"ns/call"});
+	rows.push_back({"fit","moon_speedup",t_mf>0.0?t_mp/t_mf:0.0,"x"});
+	rows.push_back({"fit","sun_stated_err",fit.sun_ser.max_err*to_as,"as"});
+	rows.push_back({"fit","moon_stated_err",fit.moon_ser.max_err*to_as,"as"});
+	rows.push_back({"fit","sun_max_err",max_s*to_as,"as"});
+	rows.push_back({"fit","moon_max_err",max_m*to_as,"as"});
+}
+
+void bn_sunmoon(EphRead&eph,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	AppLon app(eph);
+	const int n=cfg.iters;
+	auto at=[&](int i){ return cfg.jd0+i*0.0137; };
+	eph.n_call=0;
+	double t_sep=ns_per(n,[&](int i){
+		const double jd=at(i);
+		bench_sink=bench_sink+app.sun_calc(jd).first+app.moon_calc(jd).first;
+	});
+	const double c_sep=static_cast<double>(eph.n_call)/n;
+	eph.n_call=0;
+	double t_jnt=ns_per(n,[&](int i){
+		SunMoon sm=app.sun_moon_calc(at(i));
+		bench_sink=bench_sink+sm.sun.first+sm.moon.first;
+	});
+	const double c_jnt=static_cast<double>(eph.n_call)/n;
+	double max_d=0.0;
+	for(int i=0;i<4096;++i){
+		const double jd=at(i*7);
+		SunMoon sm=app.sun_moon_calc(jd);
+		auto s=app.sun_calc(jd);
+		auto m=app.moon_calc(jd);
+		max_d=std::max({max_d,std::fabs(sm.sun.first-s.first),
+						std::fabs(sm.moon.first-m.first),
+						std::fabs(sm.sun.second-s.second),
+						std::fabs(sm.moon.second-m.second)});
+	}
+	rows.push_back({"sunmoon","calls_sep",c_sep,"calls/eval"});
+	rows.push_back({"sunmoon","calls_joint",c_jnt,"calls/eval"});
+	rows.push_back({"sunmoon","sun_moon_sep",t_sep,"ns/eval"});
+	rows.push_back({"sunmoon","sun_moon_calc",t_jnt,"ns/eval"});
+	rows.push_back({"sunmoon","speedup",t_jnt>0.0?t_sep/t_jnt:0.0,"x"});
+	rows.push_back({"sunmoon","max_diff",max_d,"rad"});
+}
+
+void bn_ltime(EphRead&eph,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	const int n=cfg.iters;
+	auto at=[&](int i){ return cfg.jd0+i*0.0137; };
+	int year=0,month=0,day=0,hour=0,minute=0;
+	double second=0.0;
+	jd2greg(cfg.jd0+180.0,year,month,day,hour,minute,second);
+	auto solve=[&](LtMode mode){
+		SolLunCal sv(eph);
+		sv.app.lt=mode;
+		return bench_roots(sv,year,cfg.jd0);
+	};
+	AppLon ref(eph);
+	ref.lt=LtMode::ITER;
+	const std::vector<double> r_ref=solve(LtMode::ITER);
+	const double to_mas=180.0/PI*3600.0*1000.0;
+	for(LtMode mode : {LtMode::ITER,LtMode::LINEAR,LtMode::VEL}){
+		const std::string nm=lt_name(mode);
+		AppLon app(eph);
+		app.lt=mode;
+		eph.n_call=0;
+		double t_s=ns_per(n,[&](int i){
+			bench_sink=bench_sink+app.sun_calc(at(i)).first;
+		});
+		const double c_s=static_cast<double>(eph.n_call)/n;
+		eph.n_call=0;
+		double t_m=ns_per(n,[&](int i){
+			bench_sink=bench_sink+app.moon_calc(at(i)).first;
+		});
+		const double c_m=static_cast<double>(eph.n_call)/n;
+		double max_s=0.0;
+		double max_m=0.0;
+		for(int i=0;i<4096;++i){
+			const double jd=at(i*7);
+			max_s=std::max(max_s,std::fabs(std::remainder(
+									 app.sun_calc(jd).first-
+										 ref.sun_calc(jd).first,
+									 TWO_PI)));
+			max_m=std::max(max_m,std::fabs(std::remainder(
+									 app.moon_calc(jd).first-
+										 ref.moon_calc(jd).first,
+									 TWO_PI)));
+		}
+		const std::vector<double> r=solve(mode);
+		double max_sec=0.0;
+		for(std::size_t k=0;k<r.size();++k){
+			max_sec=std::max(max_sec,std::fabs(r[k]-r_ref[k])*SEC_DAY);
+		}
+		rows.push_back({"ltime",nm+"_sun_calls",c_s,"calls/eval"});
+		rows.push_back({"ltime",nm+"_moon_calls",c_m,"calls/eval"});
+		rows.push_back({"ltime",nm+"_sun_calc",t_s,"ns/call"});
+		rows.push_back({"ltime",nm+"_moon_calc",t_m,"ns/call"});
+		rows.push_back({"ltime",nm+"_sun_diff",max_s*to_mas,"mas"});
+		rows.push_back({"ltime",nm+"_moon_diff",max_m*to_mas,"mas"});
+		rows.push_back({"ltime",nm+"_root_diff",max_sec,"s"});
+	}
+}
+
+void bn_frame(EphRead&eph,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	int year=0,month=0,day=0,hour=0,minute=0;
+	double second=0.0;
+	jd2greg(cfg.jd0+180.0,year,month,day,hour,minute,second);
+	auto ms=[](BenchClock::duration d){
+		return std::chrono::duration<double,std::milli>(d).count();
+	};
+	auto t0=BenchClock::now();
+	auto fc=frame_cache(cfg.jd0);
+	auto t1=BenchClock::now();
+
+	SolLunCal s_raw(eph);
+	SolLunCal s_fc(eph);
+	s_raw.app.fc_on=false;
+	s_fc.app.fc_on=true;
+	auto t2=BenchClock::now();
+	const std::vector<double> r_raw=bench_roots(s_raw,year,cfg.jd0);
+	auto t3=BenchClock::now();
+	const std::vector<double> r_fc=bench_roots(s_fc,year,cfg.jd0);
+	auto t4=BenchClock::now();
+	const double n_rot=static_cast<double>(s_raw.app.n_rot);
+
+	const int n=cfg.iters;
+	auto at=[&](int i){ return cfg.jd0+std::fmod(i*0.0137,300.0); };
+	AppLon a_raw(eph);
+	AppLon a_fc(eph);
+	a_raw.fc_on=false;
+	a_fc.fc_on=true;
+	double t_raw=ns_per(n,[&](int i){
+		bench_sink=bench_sink+a_raw.rot_mat(at(i)).m[0][1];
+	});
+	double t_fc=ns_per(n,[&](int i){
+		bench_sink=bench_sink+a_fc.rot_mat(at(i)).m[0][1];
+	});
+	double max_err=0.0;
+	for(int i=0;i<4096;++i){
+		const double jd=at(i*7)+0.001*i;
+		const Mat3 a=a_raw.rot_mat(jd);
+		const Mat3 b=a_fc.rot_mat(jd);
+		for(int r=0;r<3;++r){
+			for(int c=0;c<3;++c){
+				max_err=std::max(max_err,std::fabs(a.m[r][c]-b.m[r][c]));
+			}
+		}
+	}
+	auto split=[](double jd){
+		double eps=PrecNut::mean_obl(jd)+PrecNut::nut_ang(jd).second;
+		return CoordTf::R1(eps)*PrecNut::nut_mat(jd)*PrecNut::prec_mat(jd)*
+			   CoordTf::bias_mat();
+	};
+	double t_split=ns_per(n,[&](int i){
+		bench_sink=bench_sink+split(at(i)).m[0][1];
+	});
+	double t_fused=ns_per(n,[&](int i){
+		bench_sink=bench_sink+PrecNut::ecl_mat(at(i)).m[0][1];
+	});
+	double max_fused=0.0;
+	for(int i=0;i<4096;++i){
+		const double jd=at(i*7)+0.001*i;
+		const Mat3 a=split(jd);
+		const Mat3 b=PrecNut::ecl_mat(jd);
+		for(int r=0;r<3;++r){
+			for(int c=0;c<3;++c){
+				max_fused=std::max(max_fused,std::fabs(a.m[r][c]-b.m[r][c]));
+			}
+		}
+	}
+	double max_sec=0.0;
+	for(std::size_t k=0;k<r_raw.size();++k){
+		max_sec=std::max(max_sec,std::fabs(r_raw[k]-r_fc[k])*SEC_DAY);
+	}
+	const double to_uas=180.0/PI*3600.0*1e6;
+	rows.push_back({"frame","build",ms(t1-t0),"ms"});
+	rows.push_back({"frame","step",fc->step(),"day"});
+	rows.push_back({"frame","nodes",static_cast<double>(fc->nodes()),"n"});
+	rows.push_back({"frame","stated_err",fc->err_rad()*to_uas,"uas"});
+	rows.push_back({"frame","max_err",max_err*to_uas,"uas"});
+	rows.push_back({"frame","rot_mat",t_raw,"ns/call"});
+	rows.push_back({"frame","rot_mat_cached",t_fc,"ns/call"});
+	rows.push_back({"frame","rot_speedup",t_fc>0.0?t_raw/t_fc:0.0,"x"});
+	rows.push_back({"frame","year_rot_calls",n_rot,"n"});
+	rows.push_back({"frame","year_frame",n_rot*t_raw*1e-6,"ms"});
+	rows.push_back({"frame","year_frame_cached",n_rot*t_fc*1e-6,"ms"});
+	rows.push_back({"frame","solve",ms(t3-t2),"ms"});
+	rows.push_back({"frame","solve_cached",ms(t4-t3),"ms"});
+	rows.push_back({"frame","max_root_diff",max_sec,"s"});
+	rows.push_back({"frame","split_rot",t_split,"ns/call"});
+	rows.push_back({"frame","fused_rot",t_fused,"ns/call"});
+	rows.push_back({"frame","fused_speedup",t_fused>0.0?t_split/t_fused:0.0,
+					"x"});
+	rows.push_back({"frame","fused_diff",max_fused*to_uas,"uas"});
+}
+
+void bn_nut(EphRead&,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	const int n=cfg.iters;
+	const std::size_t nb=256;
+	std::vector<double> jd(nb),dp(nb),de(nb),dp_s(nb),de_s(nb);
+	for(std::size_t k=0;k<nb;++k){
+		jd[k]=cfg.jd0+static_cast<double>(k)*0.731;
+	}
+	auto at=[&](int i){ return cfg.jd0+i*0.0137; };
+	const ChebIsa isa0=cheb_isa();
+	const bool has_avx=cheb_use(ChebIsa::AVX2);
+
+	cheb_use(ChebIsa::SCALAR);
+	double t_sc=ns_per(n,[&](int i){
+		bench_sink=bench_sink+nut_eval(at(i)).first;
+	});
+	const int n_blk=std::max(1,n/static_cast<int>(nb));
+	double t_bs=ns_per(n_blk,[&](int){
+		nut_eval_n(jd.data(),nb,dp_s.data(),de_s.data());
+	})/static_cast<double>(nb);
+	rows.push_back({"nut","scalar",t_sc,"ns/eval"});
+	rows.push_back({"nut","batch_scalar",t_bs,"ns/epoch"});
+
+	double max_ulp=0.0;
+	if(has_avx){
+		cheb_use(ChebIsa::AVX2);
+		double t_av=ns_per(n,[&](int i){
+			bench_sink=bench_sink+nut_eval(at(i)).first;
+		});
+		double t_ba=ns_per(n_blk,[&](int){
+			nut_eval_n(jd.data(),nb,dp.data(),de.data());
+		})/static_cast<double>(nb);
+		for(std::size_t k=0;k<nb;++k){
+			auto one=nut_eval(jd[k]);
+			max_ulp=std::max({max_ulp,ulp_dist(dp[k],dp_s[k]),
+							  ulp_dist(de[k],de_s[k]),
+							  ulp_dist(one.first,dp[k]),
+							  ulp_dist(one.second,de[k])});
+		}
+		rows.push_back({"nut","avx2",t_av,"ns/eval"});
+		rows.push_back({"nut","batch_avx2",t_ba,"ns/epoch"});
+	}
+	cheb_use(isa0);
+	rows.push_back({"nut","terms",static_cast<double>(nut_terms()),"n"});
+	rows.push_back({"nut","iau2000a",nut_full()?1.0:0.0,"bool"});
+	rows.push_back({"nut","avx2_ulp",max_ulp,"ulp"});
+
+	double r_dp=0.0;
+	double r_de=0.0;
+	if(nut_ref(cfg.jd0,r_dp,r_de)){
+		double t_ref=ns_per(n,[&](int i){
+			double a=0.0;
+			double b=0.0;
+			nut_ref(at(i),a,b);
+			bench_sink=bench_sink+a;
+		});
+		double max_err=0.0;
+		for(int i=0;i<4096;++i){
+			const double t=cfg.jd0+(i-2048)*9.17;
+			nut_ref(t,r_dp,r_de);
+			auto v=nut_eval(t);
+			max_err=std::max({max_err,std::fabs(v.first-r_dp),
+							  std::fabs(v.second-r_de)});
+		}
+		rows.push_back({"nut","erfa",t_ref,"ns/eval"});
+		rows.push_back({"nut","erfa_err",max_err,"rad"});
+	}
+}
+
+void bn_analytic(EphRead&eph,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	EphRead ana(cfg.ephem,EphBack::ANALYTIC);
+	const int n=cfg.iters;
+	auto at=[&](int i){ return cfg.jd0+i*0.0137; };
+	double t_earth=ns_per(n,[&](int i){
+		bench_sink=bench_sink+ana.get_state(ana.EARTH,ana.SSB,at(i)).first.x;
+	});
+	double t_moon=ns_per(n,[&](int i){
+		bench_sink=bench_sink+ana.get_state(ana.MOON,ana.EARTH,at(i)).first.x;
+	});
+	AppLon a_app(ana);
+	double t_sun_lon=ns_per(n,[&](int i){
+		bench_sink=bench_sink+a_app.sun_calc(at(i)).first;
+	});
+	double t_moon_lon=ns_per(n,[&](int i){
+		bench_sink=bench_sink+a_app.moon_calc(at(i)).first;
+	});
+	rows.push_back({"analytic","level",AnalyticEphem::LEVEL,"n"});
+	rows.push_back({"analytic","terms",
+					static_cast<double>(AnalyticEphem::n_terms()),"n"});
+	rows.push_back({"analytic","earth_state",t_earth,"ns/eval"});
+	rows.push_back({"analytic","moon_state",t_moon,"ns/eval"});
+	rows.push_back({"analytic","sun_calc",t_sun_lon,"ns/eval"});
+	rows.push_back({"analytic","moon_calc",t_moon_lon,"ns/eval"});
+	if(eph.back==EphBack::ANALYTIC||eph.lfit||!eph.reg||
+	   eph.reg->spans().empty()){
+		return;
+	}
+
+	const auto&spans=eph.reg->spans();
+	const double lo=spans.front().jd_lo+2.0;
+	const double hi=spans.back().jd_hi-2.0;
+	auto inside=[&](double jd){
+		for(const auto&sp : spans){
+			if(jd>=sp.jd_lo+2.0&&jd<=sp.jd_hi-2.0){
+				return true;
+			}
+		}
+		return false;
+	};
+	auto wrap=[](double a){ return std::remainder(a,TWO_PI); };
+	AppLon r_app(eph);
+	double s_max=0.0,s_sq=0.0,m_max=0.0,m_sq=0.0,d_max=0.0;
+	int n_pt=0;
+	const int n_smp=2048;
+	for(int i=0;i<n_smp;++i){
+		const double jd=lo+(hi-lo)*(i+0.5)/n_smp;
+		if(!inside(jd)){
+			continue;
+		}
+		const double ds=wrap(a_app.sun_calc(jd).first-r_app.sun_calc(jd).first);
+		const double dm=
+			wrap(a_app.moon_calc(jd).first-r_app.moon_calc(jd).first);
+		const Vec3 pa=ana.get_pos(ana.MOON,ana.EARTH,jd);
+		const Vec3 pr=eph.get_pos(eph.MOON,eph.EARTH,jd);
+		s_max=std::max(s_max,std::fabs(ds));
+		m_max=std::max(m_max,std::fabs(dm));
+		d_max=std::max(d_max,(pa-pr).norm()*AU_KM);
+		s_sq+=ds*ds;
+		m_sq+=dm*dm;
+		++n_pt;
+	}
+	if(n_pt==0){
+		return;
+	}
+
+	int y_lo=0,y_hi=0,month=0,day=0,hour=0,minute=0;
+	double second=0.0;
+	jd2greg(lo+30.0,y_lo,month,day,hour,minute,second);
+	jd2greg(hi-420.0,y_hi,month,day,hour,minute,second);
+	const int y_step=std::max(1,(y_hi-y_lo)/32);
+	SolLunCal s_ana(ana);
+	SolLunCal s_ref(eph);
+	const std::size_t n_st=SolLunCal::st_defs().size();
+	double st_max=0.0,st_sq=0.0,nm_max=0.0,nm_sq=0.0;
+	int n_yr=0;
+	for(int y=y_lo+1;y<=y_hi;y+=y_step){
+		const double jd0=greg2jd(y,1,1);
+		if(!inside(jd0-30.0)||!inside(jd0+420.0)){
+			continue;
+		}
+		const std::vector<double> r_ana=bench_roots(s_ana,y,jd0);
+		const std::vector<double> r_ref=bench_roots(s_ref,y,jd0);
+		for(std::size_t k=0;k<r_ana.size();++k){
+			const double d=std::fabs(r_ana[k]-r_ref[k])*SEC_DAY;
+			double&m=k<n_st?st_max:nm_max;
+			double&sq=k<n_st?st_sq:nm_sq;
+			m=std::max(m,d);
+			sq+=d*d;
+		}
+		++n_yr;
+	}
+	const double n_nm=static_cast<double>(n_yr)*13.0;
+	const double n_tm=static_cast<double>(n_yr)*n_st;
+	const double to_as=180.0/PI*3600.0;
+	rows.push_back({"analytic","span_lo",lo,"jd"});
+	rows.push_back({"analytic","span_hi",hi,"jd"});
+	rows.push_back({"analytic","samples",static_cast<double>(n_pt),"n"});
+	rows.push_back({"analytic","sun_lon_max",s_max*to_as,"arcsec"});
+	rows.push_back({"analytic","sun_lon_rms",
+					std::sqrt(s_sq/n_pt)*to_as,"arcsec"});
+	rows.push_back({"analytic","moon_lon_max",m_max*to_as,"arcsec"});
+	rows.push_back({"analytic","moon_lon_rms",
+					std::sqrt(m_sq/n_pt)*to_as,"arcsec"});
+	rows.push_back({"analytic","moon_pos_max",d_max,"km"});
+	rows.push_back({"analytic","root_years",static_cast<double>(n_yr),"n"});
+	if(n_yr==0){
+		return;
+	}
+	rows.push_back({"analytic","term_root_diff",st_max,"s"});
+	rows.push_back({"analytic","term_root_rms",std::sqrt(st_sq/n_tm),"s"});
+	rows.push_back({"analytic","newmoon_root_diff",nm_max,"s"});
+	rows.push_back({"analytic","newmoon_root_rms",std::sqrt(nm_sq/n_nm),"s"});
+}
+
+std::vector<RootTask> pool_tasks(const BenchCfg&cfg,bool seed=false){
+	int year=0,month=0,day=0,hour=0,minute=0;
+	double second=0.0;
+	jd2greg(cfg.jd0+180.0,year,month,day,hour,minute,second);
+	std::vector<RootTask> tasks;
+	for(int y=year;y<year+8;++y){
+		for(const auto&p : SolLunCal::st_defs()){
+			const double jd=seed?SolLunCal::st_seed(y,p.first)
+								:SolLunCal::st_guess(y,p.first);
+			tasks.push_back({RootKind::SOLAR,p.second.lambda,jd,1e-8,20});
+		}
+		const double jd_a=SolLunCal::st_seed(y,"Z2");
+		for(int k=0;k<13;++k){
+			for(const auto&ph : SolLunCal::lp_defs()){
+				const double off=SolLunCal::lp_offs().at(ph.first);
+				const double ang=ph.second.angle;
+				double jd=jd_a+k*SYNODDAY+off;
+				if(!seed){
+					double ph=ang/TWO_PI;
+					ph-=std::floor(ph);
+					jd=SolLunCal::lp_guess(jd_a+(k+ph)*SYNODDAY,ang);
+				}
+				tasks.push_back({RootKind::LUNAR,ang,jd,1e-8,20});
+			}
+		}
+	}
+	return tasks;
+}
+
+void bn_pool(EphRead&eph,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	EphRead rd=eph.reentrant()?eph:EphRead(cfg.ephem,EphBack::NATIVE);
+	const std::vector<RootTask> tasks=pool_tasks(cfg);
+	auto ms=[](BenchClock::duration d){
+		return std::chrono::duration<double,std::milli>(d).count();
+	};
+	SolLunCal s_ser(rd);
+	std::vector<double> r_ser(tasks.size());
+	auto t0=BenchClock::now();
+	for(std::size_t i=0;i<tasks.size();++i){
+		const RootTask&t=tasks[i];
+		r_ser[i]=s_ser.newton(t.kind,t.jd_initial,t.target,t.eps_days,
+							  t.max_iter);
+	}
+	auto t1=BenchClock::now();
+	SolLunCal s_pool(rd);
+	auto out=s_pool.run_roots(tasks);
+	auto t2=BenchClock::now();
+	out=s_pool.run_roots(tasks);
+	auto t3=BenchClock::now();
+	double n_diff=0.0;
+	for(std::size_t i=0;i<tasks.size();++i){
+		n_diff+=std::memcmp(&r_ser[i],&out.first[i],sizeof(double))!=0;
+	}
+	const double t_ser=ms(t1-t0);
+	const double t_pool=ms(t3-t2);
+	rows.push_back({"pool","threads",
+					static_cast<double>(RootPool::get().slots()),"n"});
+	rows.push_back({"pool","roots",static_cast<double>(tasks.size()),"n"});
+	rows.push_back({"pool","serial",t_ser,"ms"});
+	rows.push_back({"pool","pool_first",ms(t2-t1),"ms"});
+	rows.push_back({"pool","pool",t_pool,"ms"});
+	rows.push_back({"pool","speedup",t_pool>0.0?t_ser/t_pool:0.0,"x"});
+	rows.push_back({"pool","roots_per_s",
+					t_pool>0.0?tasks.size()/t_pool*1e3:0.0,"1/s"});
+	rows.push_back({"pool","diff_roots",n_diff,"n"});
+}
+
+void bn_newton(EphRead&eph,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	const std::vector<RootTask> tasks=pool_tasks(cfg);
+	const int n_rep=std::max(1,cfg.iters/2000);
+	SolLunCal sol(eph);
+	sol.use_cache=false;
+	double t_ns[2]={0.0,0.0};
+	double n_root[2]={0.0,0.0};
+	double n_eph[2]={0.0,0.0};
+	for(int rep=0;rep<n_rep;++rep){
+		for(const RootTask&t : tasks){
+			const int k=static_cast<int>(t.kind);
+			const std::size_t c0=eph.n_call;
+			auto t0=BenchClock::now();
+			bench_sink=bench_sink+sol.newton(t.kind,t.jd_initial,t.target,
+											 t.eps_days,t.max_iter);
+			auto t1=BenchClock::now();
+			t_ns[k]+=std::chrono::duration<double,std::nano>(t1-t0).count();
+			n_eph[k]+=static_cast<double>(eph.n_call-c0);
+			n_root[k]+=1.0;
+		}
+	}
+	const char*name[2]={"solar","lunar"};
+	for(int k=0;k<2;++k){
+		rows.push_back({"newton",std::string(name[k])+"_roots",
+						n_root[k]/n_rep,"n"});
+		rows.push_back({"newton",std::string(name[k])+"_root",
+						t_ns[k]/n_root[k]*1e-3,"us"});
+		rows.push_back({"newton",std::string(name[k])+"_eph_calls",
+						n_eph[k]/n_root[k],"n"});
+	}
+	rows.push_back({"newton","all_root",
+					(t_ns[0]+t_ns[1])/(n_root[0]+n_root[1])*1e-3,"us"});
+}
+
+void bn_lockstep(EphRead&eph,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	const std::vector<RootTask> tasks=pool_tasks(cfg);
+	const int n_rep=std::max(1,cfg.iters/5000);
+	auto ms=[](BenchClock::duration d){
+		return std::chrono::duration<double,std::milli>(d).count();
+	};
+	SolLunCal s_ser(eph);
+	SolLunCal s_ls(eph);
+	s_ser.mode=RootMode::SERIAL;
+	std::pair<std::vector<double>,std::vector<std::string>> ref;
+	auto t0=BenchClock::now();
+	for(int i=0;i<n_rep;++i){
+		ref=s_ser.run_roots(tasks);
+	}
+	auto t1=BenchClock::now();
+	std::vector<double> out(tasks.size());
+	std::vector<std::string> err(tasks.size());
+	std::size_t n_slow=0;
+	for(int i=0;i<n_rep;++i){
+		n_slow=s_ls.lockstep(tasks,out,err);
+	}
+	auto t2=BenchClock::now();
+	double max_sec=0.0;
+	for(std::size_t i=0;i<tasks.size();++i){
+		max_sec=std::max(max_sec,std::fabs(out[i]-ref.first[i])*SEC_DAY);
+	}
+	const double t_ser=ms(t1-t0)/n_rep;
+	const double t_ls=ms(t2-t1)/n_rep;
+	rows.push_back({"lockstep","roots",static_cast<double>(tasks.size()),"n"});
+	rows.push_back({"lockstep","serial",t_ser,"ms"});
+	rows.push_back({"lockstep","lockstep",t_ls,"ms"});
+	rows.push_back({"lockstep","serial_roots_per_s",
+					t_ser>0.0?tasks.size()/t_ser*1e3:0.0,"1/s"});
+	rows.push_back({"lockstep","roots_per_s",
+					t_ls>0.0?tasks.size()/t_ls*1e3:0.0,"1/s"});
+	rows.push_back({"lockstep","speedup",t_ls>0.0?t_ser/t_ls:0.0,"x"});
+	rows.push_back({"lockstep","stragglers",static_cast<double>(n_slow),"n"});
+	rows.push_back({"lockstep","max_root_diff",max_sec,"s"});
+}
+
+void bn_guess(EphRead&eph,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	const int n_rep=std::max(1,cfg.iters/2000);
+	const char*name[2]={"solar","lunar"};
+	std::vector<double> ref;
+	for(int g=0;g<2;++g){
+		const std::vector<RootTask> tasks=pool_tasks(cfg,g==0);
+		const std::string pre=g==0?"seed_":"guess_";
+		SolLunCal sol(eph);
+		sol.use_cache=false;
+		std::vector<double> out(tasks.size());
+		double n_root[2]={0.0,0.0};
+		double n_it[2]={0.0,0.0};
+		double n_vd[2]={0.0,0.0};
+		double n_scan=0.0;
+		double err[2]={0.0,0.0};
+		for(std::size_t i=0;i<tasks.size();++i){
+			const RootTask&t=tasks[i];
+			const int k=static_cast<int>(t.kind);
+			out[i]=sol.newton(t.kind,t.jd_initial,t.target,t.eps_days,
+							  t.max_iter);
+			n_it[k]+=sol.rs.n_iter;
+			n_vd[k]+=sol.rs.n_eval;
+			n_scan+=sol.rs.n_scan;
+			err[k]+=std::fabs(out[i]-t.jd_initial)*1440.0;
+			n_root[k]+=1.0;
+		}
+		auto t0=BenchClock::now();
+		for(int rep=0;rep<n_rep;++rep){
+			for(const RootTask&t : tasks){
+				bench_sink=bench_sink+sol.newton(t.kind,t.jd_initial,
+												 t.target,t.eps_days,
+												 t.max_iter);
+			}
+		}
+		auto t1=BenchClock::now();
+		const double us=std::chrono::duration<double,std::micro>(t1-t0)
+							.count()/(n_rep*static_cast<double>(tasks.size()));
+		for(int k=0;k<2;++k){
+			const std::string key=pre+name[k];
+			rows.push_back({"guess",key+"_iter",n_it[k]/n_root[k],"n"});
+			rows.push_back({"guess",key+"_val_der",n_vd[k]/n_root[k],"n"});
+			rows.push_back({"guess",key+"_err",err[k]/n_root[k],"min"});
+		}
+		rows.push_back({"guess",pre+"scan",n_scan,"n"});
+		rows.push_back({"guess",pre+"root",us,"us"});
+		if(g==0){
+			ref=out;
+			continue;
+		}
+		double max_sec=0.0,n_jump=0.0;
+		for(std::size_t i=0;i<tasks.size();++i){
+			const double d=std::fabs(out[i]-ref[i]);
+			if(d>1.0){
+				n_jump+=1.0;
+				continue;
+			}
+			max_sec=std::max(max_sec,d*SEC_DAY);
+		}
+		rows.push_back({"guess","max_root_diff",max_sec,"s"});
+		rows.push_back({"guess","seed_jumps",n_jump,"n"});
+	}
+}
+
+void bn_prec(EphRead&eph,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	const std::vector<RootTask> base=pool_tasks(cfg);
+	const int n_rep=std::max(1,cfg.iters/5000);
+	std::vector<double> ref;
+	for(RootPrec p : {RootPrec::MS,RootPrec::SEC,RootPrec::MIN}){
+		std::vector<RootTask> tasks=base;
+		for(RootTask&t : tasks){
+			t.eps_days=prec_eps(p);
+			t.prec=p;
+		}
+		SolLunCal sol(eph);
+		sol.mode=RootMode::SERIAL;
+		std::pair<std::vector<double>,std::vector<std::string>> out;
+		auto t0=BenchClock::now();
+		for(int i=0;i<n_rep;++i){
+			out=sol.run_roots(tasks);
+		}
+		auto t1=BenchClock::now();
+		RtSum sum;
+		for(std::size_t i=0;i<tasks.size();++i){
+			sum.add(sol.task_st[i],out.second[i].empty());
+		}
+		if(ref.empty()){
+			ref=out.first;
+		}
+		double max_ms=0.0;
+		for(std::size_t i=0;i<tasks.size();++i){
+			max_ms=std::max(max_ms,std::fabs(out.first[i]-ref[i])*SEC_DAY*1e3);
+		}
+		const double n=static_cast<double>(tasks.size());
+		const std::string key=prec_name(p);
+		rows.push_back({"prec",key+"_eps",prec_eps(p)*SEC_DAY,"s"});
+		rows.push_back({"prec",key+"_val_der",sum.n_eval/n,"n"});
+		rows.push_back({"prec",key+"_iter",sum.n_iter/n,"n"});
+		rows.push_back({"prec",key+"_escalated",
+						static_cast<double>(sum.n_esc),"n"});
+		rows.push_back({"prec",key+"_root",
+						std::chrono::duration<double,std::micro>(t1-t0)
+								.count()/(n_rep*n),"us"});
+		rows.push_back({"prec",key+"_max_diff",max_ms,"ms"});
+	}
+}
+
+void bn_proc(EphRead&eph,const BenchCfg&cfg,std::vector<BenchRow>&rows){
+	const std::vector<RootTask> tasks=pool_tasks(cfg);
+	const int n_rep=3;
+	auto ms=[](BenchClock::duration d){
+		return std::chrono::duration<double,std::milli>(d).count();
+	};
+	SolLunCal s_ser(eph);
+	s_ser.mode=RootMode::SERIAL;
+	auto t0=BenchClock::now();
+	const auto ref=s_ser.run_roots(tasks);
+	auto t1=BenchClock::now();
+	unsigned int hc=std::thread::hardware_concurrency();
+	std::size_t n_wk=hc==0?4:static_cast<std::size_t>(hc);
+	rows.push_back({"proc","workers",
+					static_cast<double>(std::min(n_wk,kMaxWork)),"n"});
+	rows.push_back({"proc","roots",static_cast<double>(tasks.size()),"n"});
+	rows.push_back({"proc","serial",ms(t1-t0),"ms"});
+	const std::size_t n_small=std::max<std::size_t>(2,std::min(n_wk,kMaxWork));
+	const std::vector<RootTask> small(tasks.begin(),tasks.begin()+n_small);
+	const int n_lat=10;
+	for(RootMode md : {RootMode::SERIAL,RootMode::BATCH,RootMode::PIPE,
+					   RootMode::FORK}){
+		const std::string name=mode_name(md);
+		SolLunCal sol(eph);
+		sol.mode=md;
+		if(md!=RootMode::SERIAL){
+			auto t2=BenchClock::now();
+			auto out=sol.run_roots(tasks);
+			auto t3=BenchClock::now();
+			for(int i=0;i<n_rep;++i){
+				out=sol.run_roots(tasks);
+			}
+			auto t4=BenchClock::now();
+			double n_diff=0.0;
+			for(std::size_t i=0;i<tasks.size();++i){
+				n_diff+=std::memcmp(&ref.first[i],&out.first[i],
+									sizeof(double))!=0;
+			}
+			rows.push_back({"proc",name+"_first",ms(t3-t2),"ms"});
+			rows.push_back({"proc",name,ms(t4-t3)/n_rep,"ms"});
+			rows.push_back({"proc","diff_"+name,n_diff,"n"});
+		}
+		auto t5=BenchClock::now();
+		for(int i=0;i<n_lat;++i){
+			sol.run_roots(small);
+		}
+		auto t6=BenchClock::now();
+		rows.push_back({"proc",name+"_start",ms(t6-t5)/n_lat,"ms"});
+	}
+}
+
+using BenchFn=
+	std::function<void(EphRead&,const BenchCfg&,std::vector<BenchRow>&)>;
+
+const std::vector<std::pair<std::string,BenchFn>>&bench_tab(){
+	static const std::vector<std::pair<std::string,BenchFn>> tab={
+		{"handle",bn_handle},
+		{"native",bn_native},
+		{"cheb",bn_cheb},
+		{"state",bn_state},
+		{"batch",bn_batch},
+		{"hcache",bn_hcache},
+		{"fit",bn_fit},
+		{"sunmoon",bn_sunmoon},
+		{"ltime",bn_ltime},
+		{"frame",bn_frame},
+		{"nut",bn_nut},
+		{"analytic",bn_analytic},
+		{"pool",bn_pool},
+		{"newton",bn_newton},
+		{"lockstep",bn_lockstep},
+		{"guess",bn_guess},
+		{"prec",bn_prec},
+		{"proc",bn_proc},
+	};
+	return tab;
+}
+
+std::vector<std::string> split_csv(const std::string&text){
+	std::vector<std::string> out;
+	std::stringstream ss(text);
+	std::string item;
+	while(std::getline(ss,item,',')){
+		if(!item.empty()){
+			out.push_back(to_low(item));
+		}
+	}
+	return out;
+}
+
+} // namespace
+
+int cmd_bench(const std::vector<std::string>&args){
+	if(args.size()==1&&(args[0]=="-h"||args[0]=="--help")){
+		use_bench();
+		return 0;
+	}
+	if(args.empty()){
+		throw std::invalid_argument("bench requires: <bsp>");
+	}
+	BenchCfg cfg;
+	cfg.ephem=args[0];
+	std::string only;
+	std::string format="txt";
+	std::string out_path;
+	bool pretty=true;
+	bool quiet=false;
+	const OptMap handlers={
+		{"--iters",[&](const std::vector<std::string>&src,std::size_t&idx,
+					   const std::string&opt){
+			 cfg.iters=parse_int(req_val(src,idx,opt),"--iters");
+		 }},
+		{"--only",[&](const std::vector<std::string>&src,std::size_t&idx,
+					  const std::string&opt){ only=req_val(src,idx,opt); }},
+		{"--format",[&](const std::vector<std::string>&src,std::size_t&idx,
+						const std::string&opt){
+			 format=to_low(req_val(src,idx,opt));
+		 }},
+		{"--out",[&](const std::vector<std::string>&src,std::size_t&idx,
+					 const std::string&opt){ out_path=req_val(src,idx,opt); }},
+		{"--pretty",[&](const std::vector<std::string>&src,std::size_t&idx,
+						const std::string&opt){
+			 pretty=parse_bool01(req_val(src,idx,opt),"--pretty");
+		 }},
+		{"--quiet",[&](const std::vector<std::string>&,std::size_t&,
+					   const std::string&){ quiet=true; }},
+	};
+	for(std::size_t i=1;i<args.size();++i){
+		const std::string&opt=args[i];
+		apply_opt(handlers,args,i,opt,"bench");
+	}
+	chk_fmt(format,{"json","txt"},"bench");
+	if(cfg.iters<=0){
+		throw std::invalid_argument("--iters must be > 0");
+	}
+
+	std::vector<std::string> pick=split_csv(only);
+	for(const auto&name : pick){
+		bool known=false;
+		for(const auto&b : bench_tab()){
+			known=known||b.first==name;
+		}
+		if(!known){
+			throw std::invalid_argument("unknown bench section: "+name);
+		}
+	}
+
+	EphRead eph(cfg.ephem);
+	std::vector<BenchRow> rows;
+	for(const auto&b : bench_tab()){
+		bool run=pick.empty();
+		for(const auto&name : pick){
+			run=run||b.first==name;
+		}
+		if(!run){
+			continue;
+		}
+		if(!quiet){
+			std::cerr<<"bench "<<b.first<<"..."<<std::endl;
+		}
+		b.second(eph,cfg,rows);
+	}
+
+	OutTgt out=open_out(out_path);
+	const FmtMap fmt_handlers={
+		{"json",[&](){
+			 JsonWriter w(*out.stream,pretty);
+			 w.obj_begin();
+			 w.key("meta");
+			 w.obj_begin();
+			 w.key("tool");
+			 w.value("lunar");
+			 w.key("version");
+			 w.value(tool_ver());
+			 w.key("ephem");
+			 w.value(cfg.ephem);
+			 w.key("iters");
+			 w.value(cfg.iters);
+			 w.obj_end();
+			 w.key("data");
+			 w.arr_begin();
+			 for(const auto&r : rows){
+				 w.obj_begin();
+				 w.key("section");
+				 w.value(r.sect);
+				 w.key("metric");
+				 w.value(r.name);
+				 w.key("value");
+				 w.value(r.value);
+				 w.key("unit");
+				 w.value(r.unit);
+				 w.obj_end();
+			 }
+			 w.arr_end();
+			 w.obj_end();
+			 *out.stream<<"\n";
+		 }},
+		{"txt",[&](){
+			 std::ostream&os=*out.stream;
+			 os<<"tool=lunar format=txt type=bench iters="<<cfg.iters<<"\n";
+			 os<<"section\tmetric\tvalue\tunit\n";
+			 for(const auto&r : rows){
+				 os<<r.sect<<"\t"<<r.name<<"\t"<<std::setprecision(6)
+				   <<r.value<<"\t"<<r.unit<<"\n";
+			 }
+		 }},
+	};
+	run_fmt(fmt_handlers,format,"bench");
+	note_out(out_path,quiet);
+	return 0;
+}
+
+void use_bench(){
+	std::cout<<"Usage:\n"
+			 <<"  lunar bench <bsp> [--only <section,...>] [--iters N]\n"
+			 <<"    [--format json|txt] [--out ...] [--pretty 0|1] [--quiet]\n"
+			 <<"Sections:\n"
+			 <<"  handle  get_state with per-call kernel checks vs validated "
+			   "handle\n"
+			 <<"  native  CSPICE vs in-tree mmap SPK reader (time, ULP "
+			   "diff)\n"
+			 <<"  cheb    scalar vs AVX2 Chebyshev kernel, single vs batched "
+			   "states\n"
+			 <<"  state   name-keyed spkezr_c vs integer-ID spkgeo_c/spkgps_c, "
+			   "geo_prop\n"
+			 <<"  batch   per-epoch get_state/geo_prop vs get_states/"
+			   "geo_prop_n\n"
+			 <<"  hcache  Hermite Sun/Earth/Moon cache: build, error, state "
+			   "and solve speed\n"
+			 <<"  fit     apparent-longitude pipeline vs fitted Chebyshev "
+			   "series (time, error)\n"
+			 <<"  sunmoon sun_calc+moon_calc vs sun_moon_calc (ephemeris "
+			   "calls, time)\n"
+			 <<"  ltime   light-time modes iter/linear/vel: calls, time, "
+			   "longitude and root diff\n"
+			 <<"  frame   split vs fused precession/nutation, FrameCache "
+			   "(build, error, compute_year share)\n"
+			 <<"  nut     SoA nutation series: scalar vs AVX2, single vs "
+			   "batched, error vs eraNut00a\n"
+			 <<"  analytic VSOP87/ELP series backend: time per evaluation, "
+			   "error vs <bsp>\n"
+			 <<"  pool    serial vs in-process root pool (time, roots/s, "
+			   "bit diff)\n"
+			 <<"  newton  per-root cost of the typed solar/lunar Newton "
+			   "solver\n"
+			 <<"  lockstep serial vs lockstep batched Newton (roots/s, "
+			   "stragglers, root diff)\n"
+			 <<"  guess   coarse vs analytic initial guesses (iterations, "
+			   "val_der calls, guess error)\n"
+			 <<"  prec    ms vs s vs min root tolerance (val_der calls, "
+			   "escalations, root diff)\n"
+			 <<"  proc    batch vs pipe vs fork root workers (first call, "
+			   "reuse, per-batch startup, bit diff)\n"
+			 <<"Examples:\n"
+			 <<"  lunar bench D:\\de442.bsp\n"
+			 <<"  lunar bench D:\\de442.bsp --only handle --iters 100000\n";
+}
@@ -184,6 +184,14 @@ int LUNAR_CALL lunar_cmd_comp(int argc,const char*const*argv){
 	return guard([&](){ return run_cmd(cmd_comp,argc,argv); });
 }
 
+int LUNAR_CALL lunar_cmd_bench(int argc,const char*const*argv){
+	return guard([&](){ return run_cmd(cmd_bench,argc,argv); });
+}
+
+int LUNAR_CALL lunar_cmd_fit(int argc,const char*const*argv){
+	return guard([&](){ return run_cmd(cmd_fit,argc,argv); });
+}
+
 int LUNAR_CALL lunar_use_main(void){
 	return guard([](){
 		use_main();
@@ -317,4 +325,18 @@ int LUNAR_CALL lunar_use_comp(void){
 	});
 }
 
+int LUNAR_CALL lunar_use_bench(void){
+	return guard([](){
+		use_bench();
+		return 0;
+	});
+}
+
+int LUNAR_CALL lunar_use_fit(void){
+	return guard([](){
+		use_fit();
+		return 0;
+	});
+}
+
 }
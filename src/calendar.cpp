@@ -10,6 +10,8 @@
 #include<iomanip>
 #include<iostream>
 #include<limits>
+#include<memory>
+#include<mutex>
 #include<sstream>
 #include<stdexcept>
 #include<thread>
@@ -25,12 +27,12 @@
 #include<unistd.h>
 #endif
 
+#include "lunar/root_proc.hpp"
+
 namespace fs=std::filesystem;
 
 namespace{
 
-constexpr std::size_t kMaxWork=8;
-
 std::string clean_txt(std::string text){
 	for(char&c : text){
 		if(c=='\t'||c=='\r'||c=='\n'){
@@ -56,21 +58,9 @@ bool parse_tsv(const std::string&line,std::vector<std::string>&fields,
 	return fields.size()>=min_fields;
 }
 
-std::string quote_arg(const std::string&arg){
-	std::string q="\"";
-	for(char c : arg){
-		if(c=='"'){
-			q+="\\\"";
-		}else{
-			q.push_back(c);
-		}
-	}
-	q.push_back('"');
-	return q;
-}
-
-int run_wproc(const std::string&exe_path,const std::string&ephem_path,
-			  const std::string&input_path,const std::string&out_path){
+int run_wproc(const std::string&exe_path,const std::string&glob_args,
+			  const std::string&ephem_path,const std::string&input_path,
+			  const std::string&out_path){
 #ifdef _WIN32
 	STARTUPINFOA si;
 	PROCESS_INFORMATION pi;
@@ -78,8 +68,9 @@ int run_wproc(const std::string&exe_path,const std::string&ephem_path,
 	std::memset(&pi,0,sizeof(pi));
 	si.cb=sizeof(si);
 
-	std::string cmd=quote_arg(exe_path)+" __root_batch "+quote_arg(ephem_path)+
-					" "+quote_arg(input_path)+" "+quote_arg(out_path);
+	std::string cmd=quote_arg(exe_path)+glob_args+" __root_batch "+
+					quote_arg(ephem_path)+" "+quote_arg(input_path)+" "+
+					quote_arg(out_path);
 	std::vector<char> cmd_buf(cmd.begin(),cmd.end());
 	cmd_buf.push_back('\0');
 
@@ -98,8 +89,9 @@ int run_wproc(const std::string&exe_path,const std::string&ephem_path,
 	CloseHandle(pi.hProcess);
 	return static_cast<int>(exit_code);
 #else
-	std::string cmd=quote_arg(exe_path)+" __root_batch "+quote_arg(ephem_path)+
-					" "+quote_arg(input_path)+" "+quote_arg(out_path);
+	std::string cmd=quote_arg(exe_path)+glob_args+" __root_batch "+
+					quote_arg(ephem_path)+" "+quote_arg(input_path)+" "+
+					quote_arg(out_path);
 	int status=std::system(cmd.c_str());
 	if(status==-1){
 		return -1;
@@ -114,25 +106,158 @@ int run_wproc(const std::string&exe_path,const std::string&ephem_path,
 #endif
 }
 
-std::string exe_path(){
-#ifdef _WIN32
-	char buf[4096];
-	DWORD len=GetModuleFileNameA(nullptr,buf,static_cast<DWORD>(sizeof(buf)));
-	if(len==0||len>=sizeof(buf)){
-		throw std::runtime_error("failed to query executable path");
+constexpr double DEG=PI/180.0;
+
+double sun_app_lon(double jd_tdb){
+	const double T=(jd_tdb-2451545.0)/36525.0;
+	const double L0=280.46646+T*(36000.76983+T*0.0003032);
+	const double M=(357.52911+T*(35999.05029-T*0.0001537))*DEG;
+	const double C=(1.914602-T*(0.004817+T*0.000014))*std::sin(M)+
+				   (0.019993-T*0.000101)*std::sin(2.0*M)+
+				   0.000289*std::sin(3.0*M);
+	const double om=(125.04-1934.136*T)*DEG;
+	return (L0+C-0.00569-0.00478*std::sin(om))*DEG;
+}
+
+struct PhTerm{
+	double a;
+	int e,m,mp,f,om;
+};
+
+const PhTerm kPhNew[]={
+	{-0.40720,0,0,1,0,0},{0.17241,1,1,0,0,0},  {0.01608,0,0,2,0,0},
+	{0.01039,0,0,0,2,0}, {0.00739,1,-1,1,0,0}, {-0.00514,1,1,1,0,0},
+	{0.00208,2,2,0,0,0}, {-0.00111,0,0,1,-2,0},{-0.00057,0,0,1,2,0},
+	{0.00056,1,1,2,0,0}, {-0.00042,0,0,3,0,0}, {0.00042,1,1,0,2,0},
+	{0.00038,1,1,0,-2,0},{-0.00024,1,-1,2,0,0},{-0.00017,0,0,0,0,1},
+	{-0.00007,0,2,1,0,0},{0.00004,0,0,2,-2,0}, {0.00004,0,3,0,0,0},
+	{0.00003,0,1,1,-2,0},{0.00003,0,0,2,2,0},  {-0.00003,0,1,1,2,0},
+	{0.00003,0,-1,1,2,0},{-0.00002,0,-1,1,-2,0},{-0.00002,0,1,3,0,0},
+	{0.00002,0,0,4,0,0},
+};
+
+const PhTerm kPhFull[]={
+	{-0.40614,0,0,1,0,0},{0.17302,1,1,0,0,0},  {0.01614,0,0,2,0,0},
+	{0.01043,0,0,0,2,0}, {0.00734,1,-1,1,0,0}, {-0.00515,1,1,1,0,0},
+	{0.00209,2,2,0,0,0}, {-0.00111,0,0,1,-2,0},{-0.00057,0,0,1,2,0},
+	{0.00056,1,1,2,0,0}, {-0.00042,0,0,3,0,0}, {0.00042,1,1,0,2,0},
+	{0.00038,1,1,0,-2,0},{-0.00024,1,-1,2,0,0},{-0.00017,0,0,0,0,1},
+	{-0.00007,0,2,1,0,0},{0.00004,0,0,2,-2,0}, {0.00004,0,3,0,0,0},
+	{0.00003,0,1,1,-2,0},{0.00003,0,0,2,2,0},  {-0.00003,0,1,1,2,0},
+	{0.00003,0,-1,1,2,0},{-0.00002,0,-1,1,-2,0},{-0.00002,0,1,3,0,0},
+	{0.00002,0,0,4,0,0},
+};
+
+const PhTerm kPhQtr[]={
+	{-0.62801,0,0,1,0,0},{0.17172,1,1,0,0,0},  {-0.01183,1,1,1,0,0},
+	{0.00862,0,0,2,0,0}, {0.00804,0,0,0,2,0},  {0.00454,1,-1,1,0,0},
+	{0.00204,2,2,0,0,0}, {-0.00180,0,0,1,-2,0},{-0.00070,0,0,1,2,0},
+	{-0.00040,0,0,3,0,0},{-0.00034,1,-1,2,0,0},{0.00032,1,1,0,2,0},
+	{0.00032,1,1,0,-2,0},{-0.00028,2,2,1,0,0}, {0.00027,1,1,2,0,0},
+	{-0.00017,0,0,0,0,1},{-0.00005,0,-1,1,-2,0},{0.00004,0,0,2,2,0},
+	{-0.00004,0,1,1,2,0},{0.00004,0,-2,1,0,0}, {0.00003,0,1,1,-2,0},
+	{0.00003,0,3,0,0,0}, {0.00002,0,0,2,-2,0}, {0.00002,0,-1,1,2,0},
+	{-0.00002,0,1,3,0,0},
+};
+
+const double kPhPlan[14][3]={
+	{0.000325,299.77,0.107408},{0.000165,251.88,0.016321},
+	{0.000164,251.83,26.651886},{0.000126,349.42,36.412478},
+	{0.000110,84.66,18.206239},{0.000062,141.74,53.303771},
+	{0.000060,207.14,2.453732},{0.000056,154.84,7.306860},
+	{0.000047,34.52,27.261239},{0.000042,207.19,0.121824},
+	{0.000040,291.34,1.844379},{0.000037,161.72,24.198154},
+	{0.000035,239.56,25.513099},{0.000023,331.55,3.592518},
+};
+
+constexpr double kLunEp=2451550.09766;
+constexpr double kLunLen=29.530588861;
+constexpr int kYrBlock=10;
+
+int lun_k(double jd_tdb){
+	return static_cast<int>(std::floor((jd_tdb-kLunEp)/kLunLen));
+}
+
+double jan1_tdb(int year){
+	return TimeScale::utc_to_tdb(SolLunCal::mk_local(year,1,1).toUtcJD());
+}
+
+double phase_jde(double k,int q){
+	const double T=k/1236.85;
+	const double T2=T*T;
+	double jde=kLunEp+kLunLen*k+
+			   T2*(0.00015437+T*(-0.000000150+T*0.00000000073));
+	if(q<0){
+		return jde;
 	}
-	return std::string(buf,len);
-#else
-	char buf[4096];
-	ssize_t len=readlink("/proc/self/exe",buf,sizeof(buf)-1);
-	if(len<=0){
-		throw std::runtime_error("failed to query executable path");
+	const double E=1.0-T*(0.002516+T*0.0000074);
+	const double M=(2.5534+29.10535670*k-T2*(0.0000014+T*0.00000011))*DEG;
+	const double Mp=(201.5643+385.81693528*k+
+					 T2*(0.0107582+T*(0.00001238-T*0.000000058)))*DEG;
+	const double F=(160.7108+390.67050284*k-
+					T2*(0.0016118+T*(0.00000227-T*0.000000011)))*DEG;
+	const double Om=(124.7746-1.56375588*k+T2*(0.0020672+T*0.00000215))*DEG;
+	const PhTerm*tab=q==0?kPhNew:(q==2?kPhFull:kPhQtr);
+	for(std::size_t i=0;i<25;++i){
+		const PhTerm&t=tab[i];
+		const double e=t.e==0?1.0:(t.e==1?E:E*E);
+		jde+=t.a*e*std::sin(t.m*M+t.mp*Mp+t.f*F+t.om*Om);
 	}
-	buf[len]='\0';
-	return std::string(buf);
-#endif
+	if(q==1||q==3){
+		const double W=0.00306-0.00038*E*std::cos(M)+0.00026*std::cos(Mp)-
+					   0.00002*std::cos(Mp-M)+0.00002*std::cos(Mp+M)+
+					   0.00002*std::cos(2.0*F);
+		jde+=q==1?W:-W;
+	}
+	for(int i=0;i<14;++i){
+		double arg=kPhPlan[i][1]+kPhPlan[i][2]*k;
+		if(i==0){
+			arg-=0.009173*T2;
+		}
+		jde+=kPhPlan[i][0]*std::sin(arg*DEG);
+	}
+	return jde;
 }
 
+struct StatScope{
+	SolLunCal&sol;
+	std::size_t c0;
+
+	explicit StatScope(SolLunCal&s) : sol(s),c0(s.eph.n_call){
+		sol.rs=RootStat{};
+	}
+	~StatScope(){
+		sol.rs.n_eph=static_cast<std::uint32_t>(sol.eph.n_call-c0);
+	}
+};
+
+double ms_since(std::chrono::steady_clock::time_point t0){
+	return std::chrono::duration<double,std::milli>(
+			   std::chrono::steady_clock::now()-t0)
+		.count();
+}
+
+void add_single(const RootTask&task,const RootStat&st,bool ok,double ms){
+	RtStats&rt=rt_stats();
+	std::lock_guard<std::mutex> lock(rt.mtx);
+	++rt.n_single;
+	rt.prec=task.prec;
+	rt.all.add(st,ok);
+	rt.all.ms+=ms;
+}
+
+struct WkSolver{
+	EphRead eph;
+	SolLunCal sol;
+
+	explicit WkSolver(const SolLunCal&src) : eph(src.eph),sol(eph){
+		eph.n_call=0;
+		sol.use_cache=src.use_cache;
+		sol.app.lt=src.app.lt;
+		sol.app.fc_on=src.app.fc_on;
+	}
+};
+
 }
 
 const std::map<int,std::string> CN_MONTH={
@@ -140,8 +265,28 @@ const std::map<int,std::string> CN_MONTH={
 	{7,"七月"},{8,"八月"},{9,"九月"},{10,"十月"},{11,"十一月"},{12,"腊月"},
 };
 
+RootMode SolLunCal::def_mode=RootMode::AUTO;
+RootPrec SolLunCal::def_prec=RootPrec::AUTO;
+int SolLunCal::grid_tz=480;
+
 SolLunCal::SolLunCal(EphRead&reader) : eph(reader),app(reader){}
 
+PrecHint::PrecHint(RootPrec p) : old_(SolLunCal::def_prec){
+	if(old_==RootPrec::AUTO){
+		SolLunCal::def_prec=p;
+	}
+}
+
+PrecHint::~PrecHint(){ SolLunCal::def_prec=old_; }
+
+void SolLunCal::cache_span(double jd_lo,double jd_hi){
+	if(use_cache&&!eph.lfit){
+		eph.cache_span(jd_lo,jd_hi);
+		span_lo=jd_lo;
+		span_hi=jd_hi;
+	}
+}
+
 double SolLunCal::norm_angle(double angle){
 	return angle-TWO_PI*std::floor((angle+PI)/TWO_PI);
 }
@@ -205,7 +350,7 @@ const std::map<std::string,double>&SolLunCal::lp_offs(){
 	return m;
 }
 
-double SolLunCal::st_guess(int year,const std::string&code){
+double SolLunCal::st_seed(int year,const std::string&code){
 	const auto&m=st_init();
 	int month=1;
 	auto it=m.find(code);
@@ -217,6 +362,31 @@ double SolLunCal::st_guess(int year,const std::string&code){
 	return TimeScale::utc_to_tdb(jd0);
 }
 
+double SolLunCal::st_guess(int year,const std::string&code){
+	double jd=st_seed(year,code);
+	const auto&defs=st_defs();
+	auto it=defs.find(code);
+	if(it==defs.end()){
+		return jd;
+	}
+	for(int i=0;i<3;++i){
+		jd+=norm_angle(it->second.lambda-sun_app_lon(jd))*365.2422/TWO_PI;
+	}
+	return jd;
+}
+
+double SolLunCal::lp_guess(double jd_near,double angle){
+	double ph=angle/TWO_PI;
+	ph-=std::floor(ph);
+	const double k0=(jd_near-kLunEp)/kLunLen;
+	const double k=std::round(k0-ph)+ph;
+	int q=static_cast<int>(std::lround(ph*4.0));
+	if(std::fabs(ph*4.0-q)>1e-9){
+		q=-1;
+	}
+	return phase_jde(k,q%4);
+}
+
 double SolLunCal::f_sterm(double jd_tdb,double tgt_lam,double*lam_ptr){
 	double lam;
 	if(lam_ptr){
@@ -236,40 +406,41 @@ double SolLunCal::f_lphase(double jd_tdb,double ph_angle,double*lam_s_ptr,
 		lam_s=*lam_s_ptr;
 		lam_m=*lam_m_ptr;
 	}else{
-		auto s=app.sun_calc(jd_tdb);
-		auto m=app.moon_calc(jd_tdb);
-		lam_s=s.first;
-		lam_m=m.first;
+		SunMoon sm=app.sun_moon_calc(jd_tdb);
+		lam_s=sm.sun.first;
+		lam_m=sm.moon.first;
 	}
 	return norm_angle(lam_m-lam_s-ph_angle);
 }
 
-std::pair<double,double> SolLunCal::val_der(const std::string&kind,
-											double jd_tdb,double target){
-	if(kind=="solar"){
+template<RootKind K>
+std::pair<double,double> SolLunCal::val_der(double jd_tdb,double target){
+	++rs.n_eval;
+	if constexpr(K==RootKind::SOLAR){
 		auto s=app.sun_calc(jd_tdb);
 		double lam=s.first;
 		double lam_dot=s.second;
 		double f=f_sterm(jd_tdb,target,&lam);
 		double fdot=lam_dot;
 		return {f,fdot};
+	}else{
+		SunMoon sm=app.sun_moon_calc(jd_tdb);
+		double lam_s=sm.sun.first;
+		double lam_dot_s=sm.sun.second;
+		double lam_m=sm.moon.first;
+		double lam_dot_m=sm.moon.second;
+		double f=f_lphase(jd_tdb,target,&lam_s,&lam_m);
+		double fdot=lam_dot_m-lam_dot_s;
+		return {f,fdot};
 	}
-
-	auto s=app.sun_calc(jd_tdb);
-	auto m=app.moon_calc(jd_tdb);
-	double lam_s=s.first;
-	double lam_dot_s=s.second;
-	double lam_m=m.first;
-	double lam_dot_m=m.second;
-	double f=f_lphase(jd_tdb,target,&lam_s,&lam_m);
-	double fdot=lam_dot_m-lam_dot_s;
-	return {f,fdot};
 }
 
-double SolLunCal::newton(const std::string&kind,double jd_initial,double target,
-						 double eps_days,int max_iter){
+template<RootKind K>
+double SolLunCal::newton(double jd_initial,double target,double eps_days,
+						 int max_iter){
+	StatScope scope(*this);
 	double jd=jd_initial;
-	auto vf=val_der(kind,jd,target);
+	auto vf=val_der<K>(jd,target);
 	double f=vf.first;
 	double fdot=vf.second;
 	if(std::fabs(f)<1e-12){
@@ -288,7 +459,7 @@ double SolLunCal::newton(const std::string&kind,double jd_initial,double target,
 			delta=-3.0;
 		}
 		double jd_new=jd-delta;
-		auto vf_new=val_der(kind,jd_new,target);
+		auto vf_new=val_der<K>(jd_new,target);
 		double f_new=vf_new.first;
 		double fdot_new=vf_new.second;
 
@@ -297,10 +468,11 @@ double SolLunCal::newton(const std::string&kind,double jd_initial,double target,
 			  backtracks<20){
 			delta*=0.5;
 			jd_new=jd-delta;
-			vf_new=val_der(kind,jd_new,target);
+			vf_new=val_der<K>(jd_new,target);
 			f_new=vf_new.first;
 			fdot_new=vf_new.second;
 			++backtracks;
+			++rs.n_back;
 		}
 
 		if(std::fabs(f_new)>std::fabs(f)&&std::fabs(delta)>eps_days){
@@ -308,16 +480,24 @@ double SolLunCal::newton(const std::string&kind,double jd_initial,double target,
 		}
 
 		if(std::fabs(delta)<eps_days||std::fabs(f_new)<1e-12){
+			++rs.n_iter;
 			return jd_new;
 		}
 
 		jd=jd_new;
 		f=f_new;
 		fdot=fdot_new;
+		++rs.n_iter;
 	}
 
+	rs.n_scan=1;
+	return scan_root<K>(jd,f,target,eps_days);
+}
+
+template<RootKind K>
+double SolLunCal::scan_root(double jd,double f,double target,double eps_days){
 	auto f_only=[&](double jd_val) -> double{
-		return val_der(kind,jd_val,target).first;
+		return val_der<K>(jd_val,target).first;
 	};
 
 	double scan_step=0.5;
@@ -334,7 +514,8 @@ double SolLunCal::newton(const std::string&kind,double jd_initial,double target,
 		double f_left;
 		double f_right;
 	};
-	std::vector<Interval> intervals;
+	Interval intervals[2];
+	int n_iv=0;
 
 	for(int dirSign=-1;dirSign<=1;dirSign+=2){
 		double prev_jd=jd_center;
@@ -351,7 +532,7 @@ double SolLunCal::newton(const std::string&kind,double jd_initial,double target,
 				double right=std::max(prev_jd,cand_jd);
 				double f_left=(left==prev_jd)?prev_f:cand_f;
 				double f_right=(right==cand_jd)?cand_f:prev_f;
-				intervals.push_back({left,right,f_left,f_right});
+				intervals[n_iv++]={left,right,f_left,f_right};
 				break;
 			}
 			prev_jd=cand_jd;
@@ -359,7 +540,8 @@ double SolLunCal::newton(const std::string&kind,double jd_initial,double target,
 		}
 	}
 
-	for(auto&iv : intervals){
+	for(int k=0;k<n_iv;++k){
+		const Interval&iv=intervals[k];
 		double left=iv.left;
 		double right=iv.right;
 		double f_left=iv.f_left;
@@ -389,16 +571,192 @@ double SolLunCal::newton(const std::string&kind,double jd_initial,double target,
 	throw std::runtime_error("Newton-Raphson did not converge");
 }
 
+template double SolLunCal::newton<RootKind::SOLAR>(double,double,double,int);
+template double SolLunCal::newton<RootKind::LUNAR>(double,double,double,int);
+
+double SolLunCal::newton(RootKind kind,double jd_initial,double target,
+						 double eps_days,int max_iter){
+	if(kind==RootKind::SOLAR){
+		return newton<RootKind::SOLAR>(jd_initial,target,eps_days,max_iter);
+	}
+	return newton<RootKind::LUNAR>(jd_initial,target,eps_days,max_iter);
+}
+
+bool SolLunCal::refine(const RootTask&task,double&root,RootStat&st){
+	const double mg=2.0*task.eps_days;
+	if(task.eps_days<=prec_eps(RootPrec::MS)||
+	   !(near_grid(root,prec_grid(task.prec),mg)||
+		 near_grid(root,1.0,mg,grid_tz/1440.0))){
+		return false;
+	}
+	root=newton(task.kind,root,task.target,prec_eps(RootPrec::MS),
+				task.max_iter);
+	st.n_eval+=rs.n_eval;
+	st.n_iter+=rs.n_iter;
+	st.n_back+=rs.n_back;
+	st.n_scan+=rs.n_scan;
+	st.n_eph+=rs.n_eph;
+	st.esc=1;
+	return true;
+}
+
+std::size_t SolLunCal::lockstep(const std::vector<RootTask>&tasks,
+								std::vector<double>&results,
+								std::vector<std::string>&errors){
+	const std::size_t n=tasks.size();
+	std::vector<double> jd(n),f(n),fdot(n),delta(n),x(n);
+	std::vector<int> iter(n,0),back(n,-1);
+	std::vector<std::size_t> live[2];
+	std::vector<std::size_t> slow;
+	task_st.assign(n,RootStat{});
+	for(std::size_t i=0;i<n;++i){
+		jd[i]=x[i]=tasks[i].jd_initial;
+		live[static_cast<int>(tasks[i].kind)].push_back(i);
+	}
+
+	auto step=[&](std::size_t i){
+		if(iter[i]>=tasks[i].max_iter||std::fabs(fdot[i])<1e-12){
+			return false;
+		}
+		delta[i]=std::max(-3.0,std::min(3.0,f[i]/fdot[i]));
+		x[i]=jd[i]-delta[i];
+		back[i]=0;
+		return true;
+	};
+
+	const bool vec=eph.back!=EphBack::ANALYTIC;
+	std::vector<double> ep,ls,ds,lm,dm;
+	while(!live[0].empty()||!live[1].empty()){
+		for(int k=0;k<2;++k){
+			std::vector<std::size_t>&lv=live[k];
+			const std::size_t m=lv.size();
+			if(m==0){
+				continue;
+			}
+			ep.resize(m);
+			ls.resize(m);
+			ds.resize(m);
+			for(std::size_t j=0;j<m;++j){
+				ep[j]=x[lv[j]];
+			}
+			lm.resize(m);
+			dm.resize(m);
+			const std::size_t c0=eph.n_call;
+			if(!vec){
+				for(std::size_t j=0;j<m;++j){
+					if(k==0){
+						auto s=app.sun_calc(ep[j]);
+						ls[j]=s.first;
+						ds[j]=s.second;
+					}else{
+						SunMoon sm=app.sun_moon_calc(ep[j]);
+						ls[j]=sm.sun.first;
+						ds[j]=sm.sun.second;
+						lm[j]=sm.moon.first;
+						dm[j]=sm.moon.second;
+					}
+				}
+			}else if(k==0){
+				app.sun_calc_n(ep.data(),m,ls.data(),ds.data());
+			}else{
+				app.sun_moon_n(ep.data(),m,ls.data(),ds.data(),lm.data(),
+							   dm.data());
+			}
+			const std::size_t d_eph=eph.n_call-c0;
+			std::size_t keep=0;
+			for(std::size_t j=0;j<m;++j){
+				const std::size_t i=lv[j];
+				const RootTask&t=tasks[i];
+				RootStat&st=task_st[i];
+				++st.n_eval;
+				st.n_eph+=static_cast<std::uint32_t>(d_eph/m+(j<d_eph%m));
+				double fv=0.0;
+				double dv=0.0;
+				if(k==0){
+					fv=f_sterm(ep[j],t.target,&ls[j]);
+					dv=ds[j];
+				}else{
+					fv=f_lphase(ep[j],t.target,&ls[j],&lm[j]);
+					dv=dm[j]-ds[j];
+				}
+				const bool worse=std::fabs(fv)>std::fabs(f[i])&&
+								 std::fabs(delta[i])>t.eps_days;
+				bool go=false;
+				if(back[i]<0){
+					f[i]=fv;
+					fdot[i]=dv;
+					if(std::fabs(fv)<1e-12){
+						results[i]=jd[i];
+						continue;
+					}
+					go=step(i);
+				}else if(worse&&back[i]<20){
+					delta[i]*=0.5;
+					x[i]=jd[i]-delta[i];
+					++back[i];
+					++st.n_back;
+					go=true;
+				}else if(worse){
+					go=false;
+				}else if(std::fabs(delta[i])<t.eps_days||
+						 std::fabs(fv)<1e-12){
+					++st.n_iter;
+					results[i]=x[i];
+					continue;
+				}else{
+					jd[i]=x[i];
+					f[i]=fv;
+					fdot[i]=dv;
+					++iter[i];
+					++st.n_iter;
+					go=step(i);
+				}
+				if(go){
+					lv[keep++]=i;
+				}else{
+					slow.push_back(i);
+				}
+			}
+			lv.resize(keep);
+		}
+	}
+
+	for(std::size_t i : slow){
+		const RootTask&t=tasks[i];
+		const std::size_t c0=eph.n_call;
+		rs=RootStat{};
+		try{
+			results[i]=t.kind==RootKind::SOLAR
+						   ?scan_root<RootKind::SOLAR>(jd[i],f[i],t.target,
+													   t.eps_days)
+						   :scan_root<RootKind::LUNAR>(jd[i],f[i],t.target,
+													   t.eps_days);
+		}catch(const std::exception&ex){
+			errors[i]=ex.what();
+		}catch(...){
+			errors[i]="unknown error";
+		}
+		RootStat&st=task_st[i];
+		st.n_eval+=rs.n_eval;
+		st.n_eph+=static_cast<std::uint32_t>(eph.n_call-c0);
+		st.n_scan=1;
+	}
+	return slow.size();
+}
+
 std::pair<std::vector<double>,std::vector<std::string>>
 SolLunCal::run_roots(const std::vector<RootTask>&tasks){
 	std::vector<double> results(tasks.size(),
 								std::numeric_limits<double>::quiet_NaN());
 	std::vector<std::string> errors(tasks.size());
+	task_st.assign(tasks.size(),RootStat{});
 
 	if(tasks.empty()){
 		return {results,errors};
 	}
 
+	const auto t0=std::chrono::steady_clock::now();
+	bool fell=false;
 	auto run_serial=[&](){
 		for(std::size_t idx=0;idx<tasks.size();++idx){
 			const auto&task=tasks[idx];
@@ -410,29 +768,126 @@ SolLunCal::run_roots(const std::vector<RootTask>&tasks){
 			}catch(...){
 				errors[idx]="unknown error";
 			}
+			task_st[idx]=rs;
+		}
+	};
+	auto done=[&](RootMode used){
+		for(std::size_t i=0;i<tasks.size();++i){
+			if(errors[i].empty()){
+				try{
+					refine(tasks[i],results[i],task_st[i]);
+				}catch(const std::exception&ex){
+					errors[i]=std::string("refine: ")+ex.what();
+				}catch(...){
+					errors[i]="refine: unknown error";
+				}
+				if(!errors[i].empty()){
+					results[i]=std::numeric_limits<double>::quiet_NaN();
+				}
+			}
 		}
+		RtSum sum;
+		for(std::size_t i=0;i<tasks.size();++i){
+			sum.add(task_st[i],errors[i].empty());
+		}
+		sum.ms=ms_since(t0);
+		RtStats&rt=rt_stats();
+		std::lock_guard<std::mutex> lock(rt.mtx);
+		++rt.n_batch;
+		rt.n_fallback+=fell;
+		if(!tasks.empty()){
+			rt.prec=tasks.front().prec;
+		}
+		++rt.modes[mode_name(used)];
+		rt.all.add(sum);
+		return std::make_pair(results,errors);
 	};
 
-	if(tasks.size()==1){
+	unsigned int hc=std::thread::hardware_concurrency();
+	RootMode md=mode;
+	if(md==RootMode::AUTO){
+		if(eph.reentrant()){
+			md=RootMode::THREAD;
+		}else if(hc==1){
+			md=RootMode::SERIAL;
+		}else{
+#ifdef __linux__
+			md=RootMode::FORK;
+#else
+			md=RootMode::PIPE;
+#endif
+		}
+	}
+	if(md==RootMode::THREAD&&!eph.reentrant()){
+		md=RootMode::SERIAL;
+	}
+	if(tasks.size()==1||md==RootMode::SERIAL){
 		run_serial();
-		return {results,errors};
+		return done(RootMode::SERIAL);
+	}
+
+	if(md==RootMode::LOCKSTEP){
+		try{
+			lockstep(tasks,results,errors);
+		}catch(...){
+			std::fill(errors.begin(),errors.end(),std::string());
+			fell=true;
+			run_serial();
+		}
+		return done(md);
+	}
+
+	if(md==RootMode::THREAD){
+		RootPool&pool=RootPool::get();
+		RootCtx ctx{std::vector<SolLunCal*>(pool.slots(),nullptr),&tasks,
+					&results,&errors,&task_st};
+		std::vector<std::unique_ptr<WkSolver>> wk(pool.slots());
+		ctx.slots[0]=this;
+		for(std::size_t s=1;s<wk.size();++s){
+			wk[s].reset(new WkSolver(*this));
+			ctx.slots[s]=&wk[s]->sol;
+		}
+		pool.run(tasks.size(),[&](std::size_t slot,std::size_t idx){
+			run_wkr(&ctx,slot,idx);
+		});
+		for(const auto&w : wk){
+			if(w){
+				eph.n_call+=w->eph.n_call;
+				app.n_rot+=w->sol.app.n_rot;
+			}
+		}
+		return done(md);
+	}
+
+	if(md==RootMode::PIPE||md==RootMode::FORK){
+		try{
+			if(md==RootMode::FORK){
+				run_fork(*this,tasks,results,errors);
+			}else{
+				run_pipe(*this,tasks,results,errors);
+			}
+		}catch(...){
+			std::fill(errors.begin(),errors.end(),std::string());
+			fell=true;
+			run_serial();
+		}
+		return done(md);
 	}
 
 	try{
 		const std::string exe_file=exe_path();
 		const std::string ephem_path=fs::absolute(eph.filepath).string();
+		std::string glob_args;
+		for(const std::string&a : wk_args(*this)){
+			glob_args+=" "+a;
+		}
 
-		unsigned int hc=std::thread::hardware_concurrency();
 		std::size_t wk_count=hc==0?4:static_cast<std::size_t>(hc);
 		wk_count=std::min<std::size_t>(wk_count,tasks.size());
 		wk_count=std::min<std::size_t>(wk_count,kMaxWork);
 		if(wk_count==0){
 			wk_count=1;
 		}
-		if(wk_count<=1){
-			run_serial();
-			return {results,errors};
-		}
 
 		std::error_code ec;
 		fs::path tmp_root=fs::temp_directory_path(ec);
@@ -483,7 +938,7 @@ SolLunCal::run_roots(const std::vector<RootTask>&tasks){
 			ofs<<std::setprecision(17);
 			for(std::size_t idx : jobs[i].task_idx){
 				const auto&task=tasks[idx];
-				ofs<<idx<<'\t'<<task.kind<<'\t'<<task.target<<'\t'
+				ofs<<idx<<'\t'<<kind_name(task.kind)<<'\t'<<task.target<<'\t'
 				   <<task.jd_initial<<'\t'<<task.eps_days<<'\t'<<task.max_iter
 				   <<'\n';
 			}
@@ -496,7 +951,8 @@ SolLunCal::run_roots(const std::vector<RootTask>&tasks){
 			}
 			launchers.emplace_back([&,i](){
 				jobs[i].exit_code=
-					run_wproc(exe_file,ephem_path,jobs[i].input_path.string(),
+					run_wproc(exe_file,glob_args,ephem_path,
+							  jobs[i].input_path.string(),
 							  jobs[i].out_path.string());
 			});
 		}
@@ -545,6 +1001,23 @@ SolLunCal::run_roots(const std::vector<RootTask>&tasks){
 				if(idx>=tasks.size()){
 					continue;
 				}
+				if(fields.size()>=8){
+					RootStat&st=task_st[idx];
+					try{
+						st.n_eval=static_cast<std::uint32_t>(
+							std::stoul(fields[3]));
+						st.n_iter=static_cast<std::uint32_t>(
+							std::stoul(fields[4]));
+						st.n_back=static_cast<std::uint32_t>(
+							std::stoul(fields[5]));
+						st.n_scan=static_cast<std::uint32_t>(
+							std::stoul(fields[6]));
+						st.n_eph=static_cast<std::uint32_t>(
+							std::stoul(fields[7]));
+					}catch(...){
+						st=RootStat{};
+					}
+				}
 
 				if(fields[1]=="OK"){
 					try{
@@ -576,10 +1049,11 @@ SolLunCal::run_roots(const std::vector<RootTask>&tasks){
 		}
 
 	}catch(...){
+		fell=true;
 		run_serial();
 	}
 
-	return {results,errors};
+	return done(md);
 }
 
 LocalDT SolLunCal::find_st(const std::string&code,int year){
@@ -589,8 +1063,21 @@ LocalDT SolLunCal::find_st(const std::string&code,int year){
 		throw std::runtime_error("Unknown solar term code: "+code);
 	}
 	double lam_target=it->second.lambda;
-	double jd_tdb0=st_guess(year,code);
-	double jd_tdb=newton("solar",jd_tdb0,lam_target);
+	const RootTask task{RootKind::SOLAR,lam_target,st_guess(year,code),
+						prec_eps(prec),20,prec};
+	const auto t0=std::chrono::steady_clock::now();
+	double jd_tdb=0.0;
+	RootStat st{};
+	try{
+		jd_tdb=newton<RootKind::SOLAR>(task.jd_initial,task.target,
+									   task.eps_days,task.max_iter);
+		st=rs;
+		refine(task,jd_tdb,st);
+	}catch(...){
+		add_single(task,rs,false,ms_since(t0));
+		throw;
+	}
+	add_single(task,st,true,ms_since(t0));
 	double jd_utc=TimeScale::tdb_to_utc(jd_tdb);
 	return utc2loc(jd_utc);
 }
@@ -602,7 +1089,21 @@ LocalDT SolLunCal::find_lp(const std::string&phase_key,double jd_near){
 		throw std::runtime_error("Unknown lunar phase key: "+phase_key);
 	}
 	double ang=it->second.angle;
-	double jd_tdb=newton("lunar",jd_near,ang);
+	const RootTask task{RootKind::LUNAR,ang,lp_guess(jd_near,ang),
+						prec_eps(prec),20,prec};
+	const auto t0=std::chrono::steady_clock::now();
+	double jd_tdb=0.0;
+	RootStat st{};
+	try{
+		jd_tdb=newton<RootKind::LUNAR>(task.jd_initial,task.target,
+									   task.eps_days,task.max_iter);
+		st=rs;
+		refine(task,jd_tdb,st);
+	}catch(...){
+		add_single(task,rs,false,ms_since(t0));
+		throw;
+	}
+	add_single(task,st,true,ms_since(t0));
 	double jd_utc=TimeScale::tdb_to_utc(jd_tdb);
 	return utc2loc(jd_utc);
 }
@@ -612,87 +1113,150 @@ YearResult SolLunCal::compute_year(int year){
 }
 
 YearResult SolLunCal::compute_year(int year,std::ostream*log){
-	if(log){
-		(*log)<<"正在计算 "<<year<<" 年 ..."<<std::endl;
-	}
-	YearResult out;
-	out.year=year;
-
-	const auto&defs=st_defs();
-
-	std::vector<RootTask> tasks;
-	std::vector<TaskMeta> metas;
+	return compute_years(year,year,log).front();
+}
 
-	auto add_stask=[&](int tgt_year,const std::string&code){
-		auto it=defs.find(code);
-		if(it==defs.end()){
-			throw std::runtime_error("Unknown solar term code: "+code);
+std::map<int,YearResult> SolLunCal::compute_years(const std::set<int>&years,
+												  std::ostream*log){
+	std::map<int,YearResult> out;
+	auto it=years.begin();
+	while(it!=years.end()){
+		const int y0=*it;
+		int y1=y0;
+		while(++it!=years.end()&&*it==y1+1){
+			++y1;
+		}
+		for(YearResult&yr : compute_years(y0,y1,log)){
+			const int y=yr.year;
+			out.emplace(y,std::move(yr));
 		}
-		double jd0=st_guess(tgt_year,code);
-		tasks.push_back({"solar",it->second.lambda,jd0,1e-8,20});
-		metas.push_back({true,code,tgt_year,"",-1});
-	};
-
-	add_stask(year-1,"Z11");
-	for(const auto&p : defs){
-		add_stask(year,p.first);
 	}
+	return out;
+}
 
-	double ws_prevt=st_guess(year-1,"Z11");
-	double ws_prevu=TimeScale::tdb_to_utc(ws_prevt);
-	double jd_anch=TimeScale::utc_to_tdb(ws_prevu-45.0);
-
+std::vector<YearResult> SolLunCal::compute_years(int y0,int y1,
+												 std::ostream*log){
+	if(y1<y0){
+		throw std::invalid_argument("compute_years: last year before first");
+	}
+	if(memo_prec!=prec){
+		st_memo.clear();
+		lp_memo.clear();
+		memo_prec=prec;
+	}
+	const auto&defs=st_defs();
 	const auto&phase_defs=lp_defs();
-	const auto&offsets=lp_offs();
+	const double eps=prec_eps(prec);
 
-	for(int idx=0;idx<18;++idx){
-		double base_jd=jd_anch+idx*SYNODDAY;
-		for(const auto&ph : phase_defs){
-			const std::string&key=ph.first;
-			double ang=ph.second.angle;
-			double offset=offsets.at(key);
-			double guess=base_jd+offset;
-			tasks.push_back({"lunar",ang,guess,1e-8,20});
-			metas.push_back({false,"",0,key,idx});
-		}
-	}
+	for(int ya=y0;ya<=y1;ya+=kYrBlock){
+		const int yb=std::min(y1,ya+kYrBlock-1);
+		std::vector<RootTask> tasks;
+		std::vector<TaskMeta> metas;
+		std::vector<int> t_year;
 
-	auto task_out=run_roots(tasks);
-	const auto&roots=task_out.first;
-	const auto&errors=task_out.second;
+		auto add_stask=[&](int tgt_year,const std::string&code){
+			if(st_memo.count({tgt_year,code})){
+				return;
+			}
+			tasks.push_back({RootKind::SOLAR,defs.at(code).lambda,
+							 st_guess(tgt_year,code),eps,20,prec});
+			metas.push_back({true,code,tgt_year,"",0});
+			t_year.push_back(std::max(tgt_year,ya));
+		};
 
-	double ws_prevjd=std::numeric_limits<double>::quiet_NaN();
-	std::map<std::pair<std::string,int>,double> lun_res;
+		add_stask(ya-1,"Z11");
+		for(int y=ya;y<=yb;++y){
+			for(const auto&p : defs){
+				add_stask(y,p.first);
+			}
+		}
 
-	for(std::size_t i=0;i<tasks.size();++i){
-		if(!errors[i].empty()){
-			if(log){
-				(*log)<<"  Root task "<<i<<" failed: "<<errors[i]<<std::endl;
+		const int k_lo=lun_k(jan1_tdb(ya))-1;
+		const int k_hi=lun_k(jan1_tdb(yb+1))+1;
+		for(int k=k_lo;k<=k_hi;++k){
+			for(const auto&ph : phase_defs){
+				const std::string&key=ph.first;
+				if(lp_memo.count({key,k})){
+					continue;
+				}
+				double ang=ph.second.angle;
+				double frac=ang/TWO_PI-std::floor(ang/TWO_PI);
+				double guess=lp_guess(kLunEp+kLunLen*(k+frac),ang);
+				int gy=utc2loc(TimeScale::tdb_to_utc(guess)).year;
+				tasks.push_back({RootKind::LUNAR,ang,guess,eps,20,prec});
+				metas.push_back({false,"",0,key,k});
+				t_year.push_back(std::min(std::max(gy,ya),yb));
 			}
+		}
+		if(tasks.empty()){
 			continue;
 		}
-		const auto&meta=metas[i];
-		double root=roots[i];
-		if(meta.is_solar){
-			if(meta.solar_code=="Z11"&&meta.solar_year==year-1){
-				ws_prevjd=root;
+
+		cache_span(jan1_tdb(ya)-90.0,jan1_tdb(yb+1)+120.0);
+		const auto t0=std::chrono::steady_clock::now();
+		auto task_out=run_roots(tasks);
+		const auto&roots=task_out.first;
+		const auto&errors=task_out.second;
+		{
+			const double ms=ms_since(t0);
+			std::map<int,RtSum> by_year;
+			for(std::size_t i=0;i<tasks.size();++i){
+				by_year[t_year[i]].add(task_st[i],errors[i].empty());
+			}
+			RtStats&rt=rt_stats();
+			std::lock_guard<std::mutex> lock(rt.mtx);
+			for(auto&kv : by_year){
+				kv.second.ms=ms*kv.second.n_root/tasks.size();
+				rt.years[kv.first].add(kv.second);
 			}
-			if(meta.solar_year==year){
-				auto it=defs.find(meta.solar_code);
-				const STermDef&def=it->second;
-				double jd_utc=TimeScale::tdb_to_utc(root);
-				LocalDT dt=utc2loc(jd_utc);
-				out.sol_terms[meta.solar_code]={def.name,dt};
+		}
+
+		for(std::size_t i=0;i<tasks.size();++i){
+			if(!errors[i].empty()){
 				if(log){
-					(*log)<<"  "<<def.name<<": "<<fmt_time(dt)<<std::endl;
+					(*log)<<"  Root task "<<i<<" failed: "<<errors[i]
+						  <<std::endl;
 				}
+				continue;
+			}
+			const auto&meta=metas[i];
+			if(meta.is_solar){
+				st_memo[{meta.solar_year,meta.solar_code}]=roots[i];
+			}else{
+				lp_memo[{meta.lp_key,meta.lp_idx}]=roots[i];
 			}
-		}else{
-			lun_res[{meta.lp_key,meta.lp_idx}]=root;
 		}
 	}
 
-	if(std::isnan(ws_prevjd)){
+	std::vector<YearResult> out;
+	out.reserve(static_cast<std::size_t>(y1-y0+1));
+	for(int y=y0;y<=y1;++y){
+		out.push_back(take_year(y,log));
+	}
+	return out;
+}
+
+YearResult SolLunCal::take_year(int year,std::ostream*log){
+	if(log){
+		(*log)<<"正在计算 "<<year<<" 年 ..."<<std::endl;
+	}
+	YearResult out;
+	out.year=year;
+
+	const auto&defs=st_defs();
+	for(const auto&p : defs){
+		auto it=st_memo.find({year,p.first});
+		if(it==st_memo.end()){
+			continue;
+		}
+		LocalDT dt=utc2loc(TimeScale::tdb_to_utc(it->second));
+		out.sol_terms[p.first]={p.second.name,dt};
+		if(log){
+			(*log)<<"  "<<p.second.name<<": "<<fmt_time(dt)<<std::endl;
+		}
+	}
+
+	if(!st_memo.count({year-1,"Z11"})){
 		throw std::runtime_error("未能求解上一年冬至");
 	}
 
@@ -700,20 +1264,14 @@ YearResult SolLunCal::compute_year(int year,std::ostream*log){
 	LocalDT end_local=mk_local(year+1,1,1);
 
 	int added=0;
-	std::set<int> all_idx;
-	for(const auto&kv : lun_res){
-		all_idx.insert(kv.first.second);
-	}
-
-	for(int idx : all_idx){
-		auto key_nm=std::make_pair(std::string("new_moon"),idx);
-		auto it_nm=lun_res.find(key_nm);
-		if(it_nm==lun_res.end()){
+	const int k_lo=lun_k(jan1_tdb(year))-1;
+	const int k_hi=lun_k(jan1_tdb(year+1))+1;
+	for(int k=k_lo;k<=k_hi;++k){
+		auto it_nm=lp_memo.find({"new_moon",k});
+		if(it_nm==lp_memo.end()){
 			continue;
 		}
-		double jd_new_tdb=it_nm->second;
-		double jd_new_utc=TimeScale::tdb_to_utc(jd_new_tdb);
-		LocalDT dt_new=utc2loc(jd_new_utc);
+		LocalDT dt_new=utc2loc(TimeScale::tdb_to_utc(it_nm->second));
 		if(dt_new<st_local){
 			continue;
 		}
@@ -721,12 +1279,13 @@ YearResult SolLunCal::compute_year(int year,std::ostream*log){
 			break;
 		}
 
-		auto it_fq=lun_res.find({"fst_qtr",idx});
-		auto it_full=lun_res.find({"full_moon",idx});
-		auto it_lq=lun_res.find({"lst_qtr",idx});
-		if(it_fq==lun_res.end()||it_full==lun_res.end()||it_lq==lun_res.end()){
+		auto it_fq=lp_memo.find({"fst_qtr",k});
+		auto it_full=lp_memo.find({"full_moon",k});
+		auto it_lq=lp_memo.find({"lst_qtr",k});
+		if(it_fq==lp_memo.end()||it_full==lp_memo.end()||
+		   it_lq==lp_memo.end()){
 			if(log){
-				(*log)<<"  朔望月索引 "<<idx<<" 结果不完整"<<std::endl;
+				(*log)<<"  朔望月索引 "<<k<<" 结果不完整"<<std::endl;
 			}
 			continue;
 		}
@@ -791,6 +1350,11 @@ LocalDT LunCal6::get_st(const std::string&code,int year){
 	return t;
 }
 
+void LunCal6::cache_year(int year){
+	engine.cache_span(greg2jd(year-1,1,1,0,0,0.0)-40.0,
+					  greg2jd(year+2,1,1,0,0,0.0)+40.0);
+}
+
 double LunCal6::to_utcjd(const LocalDT&t){ return SolLunCal::loc2utc(t); }
 
 LocalDT LunCal6::to_local(double jd){ return SolLunCal::utc2loc(jd); }
@@ -895,6 +1459,7 @@ LocalDT nmon_orbf(LunCal6&calc,const LocalDT&t){
 }
 
 std::vector<LunarMonth> comp_sym(LunCal6&calc,int year){
+	calc.cache_year(year);
 	LocalDT wy_prev=calc.get_st("Z11",year-1);
 	LocalDT wy_curr=calc.get_st("Z11",year);
 
@@ -1038,7 +1603,10 @@ int run_rootw(const std::string&ephem,const std::string&input_path,
 		ofs<<std::setprecision(17);
 
 		std::string line;
+		std::vector<std::vector<std::string>> rows;
 		std::vector<std::string> fields;
+		double jd_lo=std::numeric_limits<double>::infinity();
+		double jd_hi=-jd_lo;
 		while(std::getline(ifs,line)){
 			if(line.empty()){
 				continue;
@@ -1046,23 +1614,35 @@ int run_rootw(const std::string&ephem,const std::string&input_path,
 			if(!parse_tsv(line,fields,6)){
 				continue;
 			}
+			double jd=std::stod(fields[3]);
+			jd_lo=std::min(jd_lo,jd);
+			jd_hi=std::max(jd_hi,jd);
+			rows.push_back(fields);
+		}
+		if(!rows.empty()){
+			solver.cache_span(jd_lo-40.0,jd_hi+40.0);
+		}
 
-			std::size_t idx=static_cast<std::size_t>(std::stoull(fields[0]));
-			const std::string&kind=fields[1];
-			double target=std::stod(fields[2]);
-			double jd_initial=std::stod(fields[3]);
-			double eps_days=std::stod(fields[4]);
-			int max_iter=std::stoi(fields[5]);
+		for(const auto&row : rows){
+			std::size_t idx=static_cast<std::size_t>(std::stoull(row[0]));
+			const RootKind kind=parse_kind(row[1]);
+			double target=std::stod(row[2]);
+			double jd_initial=std::stod(row[3]);
+			double eps_days=std::stod(row[4]);
+			int max_iter=std::stoi(row[5]);
 
 			try{
 				double root=
 					solver.newton(kind,jd_initial,target,eps_days,max_iter);
-				ofs<<idx<<'\t'<<"OK"<<'\t'<<root<<'\n';
+				ofs<<idx<<'\t'<<"OK"<<'\t'<<root;
 			}catch(const std::exception&ex){
-				ofs<<idx<<'\t'<<"ERR"<<'\t'<<clean_txt(ex.what())<<'\n';
+				ofs<<idx<<'\t'<<"ERR"<<'\t'<<clean_txt(ex.what());
 			}catch(...){
-				ofs<<idx<<'\t'<<"ERR"<<'\t'<<"unknown error"<<'\n';
+				ofs<<idx<<'\t'<<"ERR"<<'\t'<<"unknown error";
 			}
+			const RootStat&st=solver.rs;
+			ofs<<'\t'<<st.n_eval<<'\t'<<st.n_iter<<'\t'<<st.n_back<<'\t'
+			   <<st.n_scan<<'\t'<<st.n_eph<<'\n';
 		}
 		return 0;
 	}catch(const std::exception&ex){
@@ -1073,3 +1653,45 @@ int run_rootw(const std::string&ephem,const std::string&input_path,
 		return 1;
 	}
 }
+
+int run_rootp(const std::string&ephem){
+	const int out_fd=rt_out_fd();
+	try{
+		EphRead eph(ephem);
+		SolLunCal solver(eph);
+
+		RtReq req;
+		while(rt_read(0,&req,sizeof(req))){
+			RtRes res;
+			std::memset(&res,0,sizeof(res));
+			res.idx=req.idx;
+			try{
+				if(req.op==RT_SPAN){
+					solver.cache_span(req.jd_initial,req.target);
+				}else{
+					res.root=solver.newton(static_cast<RootKind>(req.op),
+										   req.jd_initial,req.target,
+										   req.eps_days,req.max_iter);
+				}
+				res.ok=1;
+			}catch(const std::exception&ex){
+				std::strncpy(res.err,ex.what(),sizeof(res.err)-1);
+			}catch(...){
+				std::strncpy(res.err,"unknown error",sizeof(res.err)-1);
+			}
+			if(req.op!=RT_SPAN){
+				res.st=solver.rs;
+			}
+			if(!rt_write(out_fd,&res,sizeof(res))){
+				return 1;
+			}
+		}
+		return 0;
+	}catch(const std::exception&ex){
+		std::cerr<<"root pipe worker error: "<<ex.what()<<std::endl;
+		return 1;
+	}catch(...){
+		std::cerr<<"root pipe worker unknown error"<<std::endl;
+		return 1;
+	}
+}
@@ -0,0 +1,267 @@
+#include "lunar/cheb_simd.hpp"
+
+#include<atomic>
+
+#if defined(__x86_64__)||defined(_M_X64)||defined(__i386__)||defined(_M_IX86)
+#define LUNAR_X86 1
+#include<immintrin.h>
+#if defined(_MSC_VER)&&!defined(__clang__)
+#include<intrin.h>
+#define LUNAR_AVX2_FN
+#else
+#define LUNAR_AVX2_FN __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace{
+
+void chbint(const double*cp,int degp,double mid,double rad,double x,
+			double&p,double&dpdx){
+	double w0=0.0,w1=0.0,w2=0.0;
+	double d0=0.0,d1=0.0,d2=0.0;
+	const double s=(x-mid)/rad;
+	const double s2=2.0*s;
+	for(int j=degp;j>0;--j){
+		w2=w1;
+		w1=w0;
+		w0=cp[j]+(s2*w1-w2);
+		d2=d1;
+		d1=d0;
+		d0=w1*2.0+d1*s2-d2;
+	}
+	p=cp[0]+(s*w0-w1);
+	dpdx=(w0+s*d0-d1)/rad;
+}
+
+double chbval(const double*cp,int degp,double mid,double rad,double x){
+	double w0=0.0,w1=0.0,w2=0.0;
+	const double s=(x-mid)/rad;
+	const double s2=2.0*s;
+	for(int j=degp;j>0;--j){
+		w2=w1;
+		w1=w0;
+		w0=cp[j]+(s2*w1-w2);
+	}
+	return (s*w0-w1)+cp[0];
+}
+
+void rec_scalar(const double*rec,int type,int ncf,double et,double st[6]){
+	if(type==2){
+		for(int k=0;k<3;++k){
+			chbint(rec+2+k*ncf,ncf-1,rec[0],rec[1],et,st[k],st[k+3]);
+		}
+		return;
+	}
+	for(int k=0;k<6;++k){
+		st[k]=chbval(rec+2+k*ncf,ncf-1,rec[0],rec[1],et);
+	}
+}
+
+void rec4_scalar(const double*const rec[4],int type,int ncf,const double et[4],
+				 double st[4][6]){
+	for(int l=0;l<4;++l){
+		rec_scalar(rec[l],type,ncf,et[l],st[l]);
+	}
+}
+
+#ifdef LUNAR_X86
+
+LUNAR_AVX2_FN void rec_avx2(const double*rec,int type,int ncf,double et,
+							double st[6]){
+	const __m256d vs=_mm256_set1_pd((et-rec[0])/rec[1]);
+	const __m256d vs2=_mm256_add_pd(vs,vs);
+	const __m256d two=_mm256_set1_pd(2.0);
+	const double*c0=rec+2;
+	const double*c1=c0+ncf;
+	const double*c2=c1+ncf;
+	if(type==2){
+		__m256d w0=_mm256_setzero_pd(),w1=w0,w2=w0;
+		__m256d d0=w0,d1=w0,d2=w0;
+		for(int j=ncf-1;j>0;--j){
+			const __m256d cp=_mm256_set_pd(0.0,c2[j],c1[j],c0[j]);
+			w2=w1;
+			w1=w0;
+			w0=_mm256_add_pd(cp,_mm256_sub_pd(_mm256_mul_pd(vs2,w1),w2));
+			d2=d1;
+			d1=d0;
+			d0=_mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(w1,two),
+										   _mm256_mul_pd(d1,vs2)),
+							 d2);
+		}
+		const __m256d cp=_mm256_set_pd(0.0,c2[0],c1[0],c0[0]);
+		const __m256d p=
+			_mm256_add_pd(cp,_mm256_sub_pd(_mm256_mul_pd(vs,w0),w1));
+		const __m256d dp=_mm256_div_pd(
+			_mm256_sub_pd(_mm256_add_pd(w0,_mm256_mul_pd(vs,d0)),d1),
+			_mm256_set1_pd(rec[1]));
+		alignas(32) double bp[4];
+		alignas(32) double bd[4];
+		_mm256_store_pd(bp,p);
+		_mm256_store_pd(bd,dp);
+		for(int k=0;k<3;++k){
+			st[k]=bp[k];
+			st[k+3]=bd[k];
+		}
+		return;
+	}
+	const double*c3=c2+ncf;
+	const double*c4=c3+ncf;
+	const double*c5=c4+ncf;
+	__m256d a0=_mm256_setzero_pd(),a1=a0,a2=a0;
+	__m256d b0=a0,b1=a0,b2=a0;
+	for(int j=ncf-1;j>0;--j){
+		const __m256d ca=_mm256_set_pd(c3[j],c2[j],c1[j],c0[j]);
+		const __m256d cb=_mm256_set_pd(0.0,0.0,c5[j],c4[j]);
+		a2=a1;
+		a1=a0;
+		a0=_mm256_add_pd(ca,_mm256_sub_pd(_mm256_mul_pd(vs2,a1),a2));
+		b2=b1;
+		b1=b0;
+		b0=_mm256_add_pd(cb,_mm256_sub_pd(_mm256_mul_pd(vs2,b1),b2));
+	}
+	const __m256d ca=_mm256_set_pd(c3[0],c2[0],c1[0],c0[0]);
+	const __m256d cb=_mm256_set_pd(0.0,0.0,c5[0],c4[0]);
+	alignas(32) double ba[4];
+	alignas(32) double bb[4];
+	_mm256_store_pd(ba,
+					_mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(vs,a0),a1),ca));
+	_mm256_store_pd(bb,
+					_mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(vs,b0),b1),cb));
+	for(int k=0;k<4;++k){
+		st[k]=ba[k];
+	}
+	st[4]=bb[0];
+	st[5]=bb[1];
+}
+
+LUNAR_AVX2_FN void rec4_avx2(const double*const rec[4],int type,int ncf,
+							 const double et[4],double st[4][6]){
+	const __m256d vmid=_mm256_set_pd(rec[3][0],rec[2][0],rec[1][0],rec[0][0]);
+	const __m256d vrad=_mm256_set_pd(rec[3][1],rec[2][1],rec[1][1],rec[0][1]);
+	const __m256d vs=_mm256_div_pd(
+		_mm256_sub_pd(_mm256_loadu_pd(et),vmid),vrad);
+	const __m256d vs2=_mm256_add_pd(vs,vs);
+	const __m256d two=_mm256_set1_pd(2.0);
+	const int ncomp=type==2?3:6;
+	alignas(32) double bp[4];
+	alignas(32) double bd[4];
+	for(int k=0;k<ncomp;++k){
+		const int off=2+k*ncf;
+		const double*q0=rec[0]+off;
+		const double*q1=rec[1]+off;
+		const double*q2=rec[2]+off;
+		const double*q3=rec[3]+off;
+		__m256d w0=_mm256_setzero_pd(),w1=w0,w2=w0;
+		if(type==2){
+			__m256d d0=w0,d1=w0,d2=w0;
+			for(int j=ncf-1;j>0;--j){
+				const __m256d cp=_mm256_set_pd(q3[j],q2[j],q1[j],q0[j]);
+				w2=w1;
+				w1=w0;
+				w0=_mm256_add_pd(cp,_mm256_sub_pd(_mm256_mul_pd(vs2,w1),w2));
+				d2=d1;
+				d1=d0;
+				d0=_mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(w1,two),
+											   _mm256_mul_pd(d1,vs2)),
+								 d2);
+			}
+			const __m256d cp=_mm256_set_pd(q3[0],q2[0],q1[0],q0[0]);
+			_mm256_store_pd(
+				bp,_mm256_add_pd(cp,_mm256_sub_pd(_mm256_mul_pd(vs,w0),w1)));
+			_mm256_store_pd(
+				bd,_mm256_div_pd(
+					   _mm256_sub_pd(_mm256_add_pd(w0,_mm256_mul_pd(vs,d0)),d1),
+					   vrad));
+			for(int l=0;l<4;++l){
+				st[l][k]=bp[l];
+				st[l][k+3]=bd[l];
+			}
+			continue;
+		}
+		for(int j=ncf-1;j>0;--j){
+			const __m256d cp=_mm256_set_pd(q3[j],q2[j],q1[j],q0[j]);
+			w2=w1;
+			w1=w0;
+			w0=_mm256_add_pd(cp,_mm256_sub_pd(_mm256_mul_pd(vs2,w1),w2));
+		}
+		const __m256d cp=_mm256_set_pd(q3[0],q2[0],q1[0],q0[0]);
+		_mm256_store_pd(
+			bp,_mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(vs,w0),w1),cp));
+		for(int l=0;l<4;++l){
+			st[l][k]=bp[l];
+		}
+	}
+}
+
+bool cpu_avx2(){
+#if defined(_MSC_VER)&&!defined(__clang__)
+	int r[4];
+	__cpuid(r,0);
+	if(r[0]<7){
+		return false;
+	}
+	__cpuid(r,1);
+	const bool osxsave=(r[2]&(1<<27))!=0;
+	const bool avx=(r[2]&(1<<28))!=0;
+	if(!osxsave||!avx||(_xgetbv(0)&6)!=6){
+		return false;
+	}
+	__cpuidex(r,7,0);
+	return (r[1]&(1<<5))!=0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2")!=0;
+#endif
+}
+
+#else
+
+bool cpu_avx2(){ return false; }
+
+#endif
+
+bool has_avx2(){
+	static const bool ok=cpu_avx2();
+	return ok;
+}
+
+std::atomic<int>&isa_sel(){
+	static std::atomic<int> sel(has_avx2()?static_cast<int>(ChebIsa::AVX2)
+										  :static_cast<int>(ChebIsa::SCALAR));
+	return sel;
+}
+
+} // namespace
+
+ChebIsa cheb_isa(){
+	return static_cast<ChebIsa>(isa_sel().load(std::memory_order_relaxed));
+}
+
+bool cheb_use(ChebIsa isa){
+	if(isa==ChebIsa::AVX2&&!has_avx2()){
+		return false;
+	}
+	isa_sel().store(static_cast<int>(isa),std::memory_order_relaxed);
+	return true;
+}
+
+void cheb_rec(const double*rec,int type,int ncf,double et,double st[6]){
+#ifdef LUNAR_X86
+	if(cheb_isa()==ChebIsa::AVX2){
+		rec_avx2(rec,type,ncf,et,st);
+		return;
+	}
+#endif
+	rec_scalar(rec,type,ncf,et,st);
+}
+
+void cheb_rec4(const double*const rec[4],int type,int ncf,const double et[4],
+			   double st[4][6]){
+#ifdef LUNAR_X86
+	if(cheb_isa()==ChebIsa::AVX2){
+		rec4_avx2(rec,type,ncf,et,st);
+		return;
+	}
+#endif
+	rec4_scalar(rec,type,ncf,et,st);
+}
@@ -25,6 +25,7 @@
 #include "lunar/format.hpp"
 #include "lunar/ics.hpp"
 #include "lunar/js_writer.hpp"
+#include "lunar/spk_native.hpp"
 #include "lunar/time_scale.hpp"
 
 namespace{
@@ -525,6 +526,7 @@ void cli_month(const MonthsArgs&args){
 	chk_mode(mode);
 
 	int tz_off=parse_tz(args.tz);
+	SolLunCal::grid_tz=tz_off;
 
 	EphRead eph(args.ephem);
 	LunCal6 calc(eph);
@@ -565,8 +567,10 @@ void cli_month(const MonthsArgs&args){
 
 void cli_cal(const CalArgs&args){
 	int tz_off=parse_tz(args.tz);
+	SolLunCal::grid_tz=tz_off;
 	const std::string format=to_low(args.format);
 	chk_fmt(format,{"json","txt","ics"},"calendar");
+	const PrecHint hint(format=="ics"?RootPrec::SEC:RootPrec::AUTO);
 
 	std::vector<int> years;
 	if(args.has_years){
@@ -579,10 +583,14 @@ void cli_cal(const CalArgs&args){
 	SolLunCal solver(eph);
 	LunCal6 calc(eph);
 
+	std::map<int,YearResult> yrs=
+		solver.compute_years(std::set<int>(years.begin(),years.end()),
+							 args.quiet?nullptr:&std::cerr);
+
 	std::vector<CalYrData> out_data;
 	out_data.reserve(years.size());
 	for(int y : years){
-		YearResult yr=solver.compute_year(y,args.quiet?nullptr:&std::cerr);
+		const YearResult&yr=yrs.at(y);
 		CalYrData item;
 		item.year=y;
 		item.mode="lunar";
@@ -631,8 +639,10 @@ void cli_cal(const CalArgs&args){
 
 void cli_year(const YearArgs&args){
 	int tz_off=parse_tz(args.tz);
+	SolLunCal::grid_tz=tz_off;
 	const std::string format=to_low(args.format);
 	chk_fmt(format,{"json","txt","ics"},"year");
+	const PrecHint hint(format=="ics"?RootPrec::SEC:RootPrec::AUTO);
 	const std::string mode=to_low(args.mode);
 	chk_mode(mode);
 
@@ -673,8 +683,10 @@ void cli_year(const YearArgs&args){
 
 void cli_event(const EventArgs&args){
 	int tz_off=parse_tz(args.tz);
+	SolLunCal::grid_tz=tz_off;
 	const std::string format=to_low(args.format);
 	chk_fmt(format,{"json","txt","ics"},"event");
+	const PrecHint hint(format=="ics"?RootPrec::SEC:RootPrec::AUTO);
 
 	EphRead eph(args.ephem);
 	SolLunCal solver(eph);
@@ -733,6 +745,42 @@ void cli_event(const EventArgs&args){
 	note_out(args.out,args.quiet);
 }
 
+namespace{
+
+void dl_extract(const DlArgs&args){
+	if(args.years.empty()){
+		throw std::invalid_argument("download extract requires --years <A-B>");
+	}
+	if(args.out.empty()){
+		throw std::invalid_argument("download extract requires --out <path>");
+	}
+	std::error_code ec;
+	if(std::filesystem::equivalent(args.bsp,args.out,ec)){
+		throw std::invalid_argument("extract output must differ from <bsp>");
+	}
+	std::vector<int> ys=parse_year(args.years);
+	const int y_lo=*std::min_element(ys.begin(),ys.end());
+	const int y_hi=*std::max_element(ys.begin(),ys.end());
+	auto to_et=[](double jd_utc){
+		return (TimeScale::utc_to_tdb(jd_utc)-2451545.0)*SEC_DAY;
+	};
+	const double et_lo=to_et(greg2jd(y_lo-2,1,1));
+	const double et_hi=to_et(greg2jd(y_hi+3,1,1));
+
+	std::shared_ptr<const SpkFile> src=spk_open(args.bsp);
+	SpkSub sub=spk_extract(*src,{10,399,301},et_lo,et_hi,args.out);
+	std::cout<<args.out<<std::endl;
+	if(!args.quiet){
+		const std::uintmax_t src_b=std::filesystem::file_size(args.bsp,ec);
+		std::cerr<<"extracted "<<sub.n_seg<<" segments, "<<sub.bytes
+				 <<" of "<<src_b<<" bytes, jd_tdb "<<std::fixed
+				 <<std::setprecision(1)<<2451545.0+sub.et_beg/SEC_DAY<<" - "
+				 <<2451545.0+sub.et_end/SEC_DAY<<std::endl;
+	}
+}
+
+}
+
 void cli_dl(const DlArgs&args){
 	const std::string action=to_low(args.action);
 	if(action=="list"){
@@ -745,8 +793,13 @@ void cli_dl(const DlArgs&args){
 		return;
 	}
 
+	if(action=="extract"){
+		dl_extract(args);
+		return;
+	}
 	if(action!="get"){
-		throw std::invalid_argument("download action must be list or get");
+		throw std::invalid_argument(
+			"download action must be list, get or extract");
 	}
 
 	auto opts=bsp_opts();
@@ -1014,12 +1067,25 @@ int cmd_dl(const std::vector<std::string>&args){
 		}
 		dargs.id=args[i];
 		++i;
+	}else if(dargs.action=="extract"){
+		if(i>=args.size()){
+			throw std::invalid_argument("download extract requires <bsp>");
+		}
+		dargs.bsp=args[i];
+		++i;
 	}else if(dargs.action!="list"){
-		throw std::invalid_argument("download action must be list or get");
+		throw std::invalid_argument(
+			"download action must be list, get or extract");
 	}
 	const OptMap handlers={
 		{"--dir",[&](const std::vector<std::string>&src,std::size_t&idx,
 					 const std::string&opt){ dargs.dir=req_val(src,idx,opt); }},
+		{"--years",[&](const std::vector<std::string>&src,std::size_t&idx,
+					   const std::string&opt){
+			 dargs.years=req_val(src,idx,opt);
+		 }},
+		{"--out",[&](const std::vector<std::string>&src,std::size_t&idx,
+					 const std::string&opt){ dargs.out=req_val(src,idx,opt); }},
 		{"--quiet",[&](const std::vector<std::string>&,std::size_t&,
 					   const std::string&){ dargs.quiet=true; }},
 	};
@@ -1110,10 +1176,17 @@ void use_dl(){
 	std::cout<<"Usage:\n"
 			 <<"  lunar download list\n"
 			 <<"  lunar download get <id> [--dir <path>]\n"
+			 <<"  lunar download extract <bsp> --years <A-B> --out <path>\n"
+			 <<"    [--quiet]\n"
 			 <<"Examples:\n"
 			 <<"  lunar download list\n"
 			 <<"  lunar download get de442\n"
-			 <<"  lunar download get de442s --dir D:\\ephem\n";
+			 <<"  lunar download get de442s --dir D:\\ephem\n"
+			 <<"  lunar download extract D:\\de441_part-2.bsp --years "
+			   "1800-2100 --out D:\\sub.bsp\n"
+			 <<"Notes:\n"
+			 <<"  extract keeps only the Sun, Earth, Moon and their centers,\n"
+			 <<"  trimmed to the records covering years A-2 .. B+2.\n";
 }
 
 void use_main(){
@@ -1137,11 +1210,33 @@ void use_main(){
 			 <<"  lunar selftest ...\n"
 			 <<"  lunar config   ...\n"
 			 <<"  lunar completion...\n"
+			 <<"  lunar bench    ...\n"
+			 <<"  lunar fit      ...\n"
 			 <<"  lunar download ...\n"
 			 <<"\n"
 			 <<"Compatibility:\n"
 			 <<"  lunar <bsp> <years> [months options...]  # same as months\n"
 			 <<"\n"
+			 <<"Global options:\n"
+			 <<"  --ephem spice|native|analytic\n"
+			 <<"                        ephemeris backend (default spice; "
+			   "analytic needs no kernel)\n"
+			 <<"  --ephem-cache 0|1     Hermite Sun/Earth/Moon cache for root "
+			   "solving (default 0)\n"
+			 <<"  --frame-cache 0|1     interpolated precession/nutation "
+			   "tables (default 0)\n"
+			 <<"  --light-time iter|linear|vel\n"
+			 <<"                        light-time strategy for apparent "
+			   "longitudes (default iter)\n"
+			 <<"  --root-mode auto|serial|lockstep|thread|pipe|fork|batch\n"
+			 <<"                        root worker mode (default auto: "
+			   "thread, else fork on Linux, else pipe)\n"
+			 <<"  --precision auto|ms|s|min\n"
+			 <<"                        root tolerance (default auto: s for "
+			   "ics output, else ms)\n"
+			 <<"  --stats txt|json      print root solver counters to stderr "
+			   "after the command\n"
+			 <<"\n"
 			 <<"Subcommand help:\n"
 			 <<"  lunar months --help\n"
 			 <<"  lunar calendar --help\n"
@@ -1160,5 +1255,7 @@ void use_main(){
 			 <<"  lunar selftest --help\n"
 			 <<"  lunar config --help\n"
 			 <<"  lunar completion --help\n"
+			 <<"  lunar bench --help\n"
+			 <<"  lunar fit --help\n"
 			 <<"  lunar download --help\n";
 }
@@ -1,14 +1,84 @@
 #include "lunar/entry.hpp"
 
 #include<iostream>
+#include<stdexcept>
 #include<string>
 #include<vector>
 
 #include "lunar/calendar.hpp"
 #include "lunar/cli.hpp"
+#include "lunar/cli_common.hpp"
 #include "lunar/interact.hpp"
+#include "lunar/spc_ephem.hpp"
 
-int run_cli_args(const std::vector<std::string>&args){
+namespace{
+
+std::string stat_fmt;
+
+std::vector<std::string> take_glob(const std::vector<std::string>&args){
+	std::vector<std::string> rest;
+	rest.reserve(args.size());
+	for(std::size_t i=0;i<args.size();++i){
+		if(args[i]=="--ephem"){
+			if(i+1>=args.size()){
+				throw std::invalid_argument("missing value for --ephem");
+			}
+			EphRead::def_back=parse_back(args[++i]);
+			continue;
+		}
+		if(args[i]=="--ephem-cache"){
+			if(i+1>=args.size()){
+				throw std::invalid_argument("missing value for --ephem-cache");
+			}
+			EphemCache::def_on=
+				cli_util::parse_bool01(args[++i],"--ephem-cache");
+			continue;
+		}
+		if(args[i]=="--frame-cache"){
+			if(i+1>=args.size()){
+				throw std::invalid_argument("missing value for --frame-cache");
+			}
+			FrameCache::def_on=
+				cli_util::parse_bool01(args[++i],"--frame-cache");
+			continue;
+		}
+		if(args[i]=="--light-time"){
+			if(i+1>=args.size()){
+				throw std::invalid_argument("missing value for --light-time");
+			}
+			AberCorr::def_lt=parse_lt(args[++i]);
+			continue;
+		}
+		if(args[i]=="--root-mode"){
+			if(i+1>=args.size()){
+				throw std::invalid_argument("missing value for --root-mode");
+			}
+			SolLunCal::def_mode=parse_mode(args[++i]);
+			continue;
+		}
+		if(args[i]=="--precision"){
+			if(i+1>=args.size()){
+				throw std::invalid_argument("missing value for --precision");
+			}
+			SolLunCal::def_prec=parse_prec(args[++i]);
+			continue;
+		}
+		if(args[i]=="--stats"){
+			if(i+1>=args.size()){
+				throw std::invalid_argument("missing value for --stats");
+			}
+			stat_fmt=cli_util::to_low(args[++i]);
+			if(stat_fmt!="txt"&&stat_fmt!="json"){
+				throw std::invalid_argument("--stats must be txt|json");
+			}
+			continue;
+		}
+		rest.push_back(args[i]);
+	}
+	return rest;
+}
+
+int run_cmd(const std::vector<std::string>&args){
 	if(args.empty()){
 		int_mode();
 		return 0;
@@ -22,6 +92,12 @@ int run_cli_args(const std::vector<std::string>&args){
 		}
 		return run_rootw(args[1],args[2],args[3]);
 	}
+	if(first=="__root_pipe"){
+		if(args.size()!=2){
+			return 2;
+		}
+		return run_rootp(args[1]);
+	}
 
 	if(first=="-h"||first=="--help"){
 		use_main();
@@ -86,6 +162,34 @@ int run_cli_args(const std::vector<std::string>&args){
 	if(first=="completion"){
 		return cmd_comp(std::vector<std::string>(args.begin()+1,args.end()));
 	}
+	if(first=="bench"){
+		return cmd_bench(std::vector<std::string>(args.begin()+1,args.end()));
+	}
+	if(first=="fit"){
+		return cmd_fit(std::vector<std::string>(args.begin()+1,args.end()));
+	}
 
 	return cmd_month(args);
 }
+
+}
+
+int run_cli_args(const std::vector<std::string>&raw_args){
+	const PrecHint keep(RootPrec::AUTO);
+	stat_fmt.clear();
+	rt_reset();
+	const std::vector<std::string> args=take_glob(raw_args);
+	int rc=0;
+	try{
+		rc=run_cmd(args);
+	}catch(...){
+		if(!stat_fmt.empty()){
+			put_stats(std::cerr,stat_fmt);
+		}
+		throw;
+	}
+	if(!stat_fmt.empty()){
+		put_stats(std::cerr,stat_fmt);
+	}
+	return rc;
+}
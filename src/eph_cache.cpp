@@ -0,0 +1,148 @@
+#include "lunar/eph_cache.hpp"
+
+#include<algorithm>
+#include<cmath>
+#include<stdexcept>
+
+#include "lunar/spc_ephem.hpp"
+
+bool EphemCache::def_on=false;
+
+namespace{
+
+const double kNode[8]={-1.0,-1.0,0.0,0.0,1.0,1.0,2.0,2.0};
+
+void herm_coef(const double f[4],const double df[4],double c[8]){
+	double q[8];
+	for(int j=0;j<8;++j){
+		q[j]=f[j/2];
+	}
+	for(int k=1;k<8;++k){
+		for(int j=7;j>=k;--j){
+			if(k==1&&(j&1)){
+				q[j]=df[j/2];
+			}else{
+				q[j]=(q[j]-q[j-1])/(kNode[j]-kNode[j-k]);
+			}
+		}
+		c[k-1]=q[k-1];
+	}
+	c[7]=q[7];
+}
+
+} // namespace
+
+EphemCache::EphemCache(EphRead&eph,double jd_lo,double jd_hi,double step)
+	: ssb_(eph.SSB),step_(step){
+	if(!(step>0.0)||!(jd_hi>=jd_lo)){
+		throw std::invalid_argument("invalid ephemeris cache window");
+	}
+	ids_[0]=eph.SUN;
+	ids_[1]=eph.EARTH;
+	ids_[2]=eph.MOON;
+	n_itv_=static_cast<std::size_t>(std::ceil((jd_hi-jd_lo)/step));
+	n_itv_=std::max<std::size_t>(n_itv_,1);
+	t0_=jd_lo-step;
+
+	const std::size_t n_node=nodes();
+	std::vector<double> jd(n_node);
+	for(std::size_t k=0;k<n_node;++k){
+		jd[k]=t0_+step*static_cast<double>(k);
+	}
+	cf_.assign(n_itv_*kBody*3*kCoef,0.0);
+	StateBuf buf;
+	for(int b=0;b<kBody;++b){
+		eph.get_states(ids_[b],ssb_,jd,buf);
+		const std::vector<double>*p[3]={&buf.x,&buf.y,&buf.z};
+		const std::vector<double>*v[3]={&buf.vx,&buf.vy,&buf.vz};
+		for(std::size_t i=0;i<n_itv_;++i){
+			for(int a=0;a<3;++a){
+				double f[4];
+				double df[4];
+				for(int j=0;j<4;++j){
+					f[j]=(*p[a])[i+j];
+					df[j]=(*v[a])[i+j]*step;
+				}
+				herm_coef(f,df,&cf_[((i*kBody+b)*3+a)*kCoef]);
+			}
+		}
+	}
+	measure(eph);
+}
+
+bool EphemCache::covers(double jd_lo,double jd_hi) const{
+	return jd_lo>=this->jd_lo()&&jd_hi<=this->jd_hi();
+}
+
+int EphemCache::slot(int body) const{
+	for(int b=0;b<kBody;++b){
+		if(ids_[b]==body){
+			return b;
+		}
+	}
+	return -1;
+}
+
+void EphemCache::body_at(int slot,std::size_t itv,double s,Vec3&pos,
+						 Vec3&vel) const{
+	double p[3];
+	double dp[3];
+	for(int a=0;a<3;++a){
+		const double*c=&cf_[((itv*kBody+slot)*3+a)*kCoef];
+		double y=c[7];
+		double dy=0.0;
+		for(int k=6;k>=0;--k){
+			dy=dy*(s-kNode[k])+y;
+			y=y*(s-kNode[k])+c[k];
+		}
+		p[a]=y;
+		dp[a]=dy/step_;
+	}
+	pos=Vec3(p[0],p[1],p[2]);
+	vel=Vec3(dp[0],dp[1],dp[2]);
+}
+
+bool EphemCache::state(int target,int observer,double jd_tdb,Vec3&pos,
+					   Vec3&vel) const{
+	if(!(jd_tdb>=jd_lo()&&jd_tdb<=jd_hi())){
+		return false;
+	}
+	const int st=target==ssb_?kBody:slot(target);
+	const int so=observer==ssb_?kBody:slot(observer);
+	if(st<0||so<0){
+		return false;
+	}
+	const double u=(jd_tdb-t0_)/step_;
+	const double fl=std::min(std::max(std::floor(u),1.0),
+							 static_cast<double>(n_itv_));
+	const std::size_t itv=static_cast<std::size_t>(fl)-1;
+	const double s=u-fl;
+	pos=Vec3();
+	vel=Vec3();
+	Vec3 p,v;
+	if(st<kBody){
+		body_at(st,itv,s,p,v);
+		pos+=p;
+		vel+=v;
+	}
+	if(so<kBody){
+		body_at(so,itv,s,p,v);
+		pos-=p;
+		vel-=v;
+	}
+	return true;
+}
+
+void EphemCache::measure(EphRead&eph){
+	err_km_=0.0;
+	const std::size_t stride=std::max<std::size_t>(1,n_itv_/64);
+	for(std::size_t i=0;i<n_itv_;i+=stride){
+		const double jd=t0_+step_*(static_cast<double>(i)+1.5);
+		for(int b=0;b<kBody;++b){
+			Vec3 p,v;
+			body_at(b,i,0.5,p,v);
+			Vec3 d=p-eph.get_state(ids_[b],ssb_,jd).first;
+			err_km_=std::max(err_km_,d.norm()*AU_KM);
+		}
+	}
+}
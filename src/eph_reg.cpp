@@ -0,0 +1,150 @@
+#include "lunar/eph_reg.hpp"
+
+#include<algorithm>
+#include<filesystem>
+#include<limits>
+#include<map>
+#include<mutex>
+#include<stdexcept>
+
+extern "C"{
+#include "SpiceUsr.h"
+}
+
+#include "lunar/spc_ephem.hpp"
+#include "lunar/spk_meta.hpp"
+
+namespace{
+
+const std::vector<int> kBodies={10,399,301};
+
+struct SpicePin{
+	std::string path;
+
+	explicit SpicePin(const std::string&p) : path(p){
+		furnsh_c(path.c_str());
+		chk_spice("Failed to load ephemeris kernel");
+	}
+
+	~SpicePin(){
+		unload_c(path.c_str());
+		if(failed_c()){
+			reset_c();
+		}
+	}
+};
+
+std::mutex reg_mtx;
+std::map<std::string,std::weak_ptr<const SpicePin>> spice_pins;
+std::map<std::string,std::weak_ptr<const EphReg>> open_regs;
+
+std::shared_ptr<const SpicePin> pin_spice(const std::string&path){
+	auto it=spice_pins.find(path);
+	if(it!=spice_pins.end()){
+		if(auto sp=it->second.lock()){
+			return sp;
+		}
+	}
+	auto sp=std::make_shared<const SpicePin>(path);
+	spice_pins[path]=sp;
+	return sp;
+}
+
+} // namespace
+
+std::vector<std::string> eph_paths(const std::string&spec){
+	std::vector<std::string> out;
+	std::error_code ec;
+	if(spec.find(',')==std::string::npos||std::filesystem::exists(spec,ec)){
+		out.push_back(spec);
+		return out;
+	}
+	std::size_t pos=0;
+	while(pos<=spec.size()){
+		std::size_t end=spec.find(',',pos);
+		if(end==std::string::npos){
+			end=spec.size();
+		}
+		if(end>pos){
+			out.push_back(spec.substr(pos,end-pos));
+		}
+		pos=end+1;
+	}
+	if(out.empty()){
+		throw std::runtime_error("ephemeris path is empty");
+	}
+	return out;
+}
+
+bool spk_cover(const std::string&path,const std::vector<int>&bodies,
+			   double&jd_lo,double&jd_hi){
+	return spk_meta(path)->cover(bodies,jd_lo,jd_hi);
+}
+
+EphReg::EphReg(const std::vector<std::string>&paths,EphBack back){
+	for(const std::string&path : paths){
+		Kern kern;
+		kern.path=path;
+		if(back==EphBack::NATIVE){
+			kern.spk=spk_open(path);
+		}else{
+			kern.pin=pin_spice(path);
+		}
+		if(!spk_cover(path,kBodies,kern.jd_lo,kern.jd_hi)){
+			kern.jd_lo=std::numeric_limits<double>::quiet_NaN();
+			kern.jd_hi=kern.jd_lo;
+		}
+		kerns_.push_back(kern);
+	}
+	index();
+}
+
+void EphReg::index(){
+	std::vector<double> cut;
+	for(const Kern&kern : kerns_){
+		if(kern.jd_lo<kern.jd_hi){
+			cut.push_back(kern.jd_lo);
+			cut.push_back(kern.jd_hi);
+		}
+	}
+	std::sort(cut.begin(),cut.end());
+	cut.erase(std::unique(cut.begin(),cut.end()),cut.end());
+	for(std::size_t i=0;i+1<cut.size();++i){
+		for(std::size_t k=kerns_.size();k-->0;){
+			if(kerns_[k].jd_lo<=cut[i]&&kerns_[k].jd_hi>=cut[i+1]){
+				if(!spans_.empty()&&spans_.back().kern==k&&
+				   spans_.back().jd_hi==cut[i]){
+					spans_.back().jd_hi=cut[i+1];
+				}else{
+					spans_.push_back({cut[i],cut[i+1],k});
+				}
+				break;
+			}
+		}
+	}
+}
+
+std::size_t EphReg::find(double jd_tdb) const{
+	auto it=std::upper_bound(
+		spans_.begin(),spans_.end(),jd_tdb,
+		[](double jd,const Span&span){ return jd<span.jd_lo; });
+	if(it!=spans_.begin()&&jd_tdb<=(it-1)->jd_hi){
+		return (it-1)->kern;
+	}
+	return kerns_.size()-1;
+}
+
+std::shared_ptr<const EphReg> EphReg::open(const std::string&spec,
+										   EphBack back){
+	const std::string key=(back==EphBack::NATIVE?"n:":"s:")+spec;
+	std::lock_guard<std::mutex> lock(reg_mtx);
+	auto it=open_regs.find(key);
+	if(it!=open_regs.end()){
+		if(auto sp=it->second.lock()){
+			return sp;
+		}
+	}
+	std::shared_ptr<const EphReg> sp(new EphReg(eph_paths(spec),back));
+	open_regs[key]=sp;
+	return sp;
+}
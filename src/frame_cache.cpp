@@ -0,0 +1,142 @@
+#include "lunar/frame_cache.hpp"
+
+#include<algorithm>
+#include<cmath>
+#include<map>
+#include<mutex>
+#include<stdexcept>
+
+#include "lunar/frames.hpp"
+#include "lunar/nut_ser.hpp"
+
+bool FrameCache::def_on=false;
+
+namespace{
+
+const double kDen[6]={-120.0,24.0,-12.0,12.0,-24.0,120.0};
+
+void lag_wt(double s,double w[6]){
+	double d[6];
+	for(int i=0;i<6;++i){
+		d[i]=s-static_cast<double>(i-2);
+	}
+	double pre=1.0;
+	for(int i=0;i<6;++i){
+		w[i]=pre;
+		pre*=d[i];
+	}
+	double suf=1.0;
+	for(int i=5;i>=0;--i){
+		w[i]*=suf/kDen[i];
+		suf*=d[i];
+	}
+}
+
+} // namespace
+
+FrameCache::FrameCache(double jd_lo,double jd_hi,double step) : step_(step){
+	if(!(step>0.0)||!(jd_hi>=jd_lo)){
+		throw std::invalid_argument("invalid frame cache window");
+	}
+	k0_=static_cast<long long>(std::floor((jd_lo-JD0)/step))-2;
+	k1_=static_cast<long long>(std::ceil((jd_hi-JD0)/step))+3;
+	const std::size_t n=nodes();
+	std::vector<double> jd(n),dpsi(n),deps(n);
+	for(std::size_t k=0;k<n;++k){
+		jd[k]=JD0+step*static_cast<double>(k0_+static_cast<long long>(k));
+	}
+	nut_eval_n(jd.data(),n,dpsi.data(),deps.data());
+	val_.resize(n*kVal);
+	for(std::size_t k=0;k<n;++k){
+		double*v=&val_[k*kVal];
+		v[0]=PrecNut::mean_obl(jd[k]);
+		PrecNut::nut_j2(jd[k],dpsi[k],deps[k]);
+		v[1]=dpsi[k];
+		v[2]=deps[k];
+		Mat3 P=PrecNut::prec_mat(jd[k]);
+		for(int i=0;i<9;++i){
+			v[3+i]=P.m[i/3][i%3];
+		}
+	}
+	measure();
+}
+
+bool FrameCache::interp(double jd_tdb,double out[kVal]) const{
+	const double u=(jd_tdb-JD0)/step_;
+	const double fl=std::floor(u);
+	if(!(fl-2.0>=static_cast<double>(k0_)&&
+		 fl+3.0<=static_cast<double>(k1_))){
+		return false;
+	}
+	double w[6];
+	lag_wt(u-fl,w);
+	const double*v=&val_[static_cast<std::size_t>(
+		(static_cast<long long>(fl)-2-k0_)*kVal)];
+	for(int j=0;j<kVal;++j){
+		double sum=0.0;
+		for(int i=0;i<6;++i){
+			sum+=w[i]*v[i*kVal+j];
+		}
+		out[j]=sum;
+	}
+	return true;
+}
+
+bool FrameCache::nut_ang(double jd_tdb,double&dpsi,double&deps) const{
+	double v[kVal];
+	if(!interp(jd_tdb,v)){
+		return false;
+	}
+	dpsi=v[1];
+	deps=v[2];
+	return true;
+}
+
+bool FrameCache::eval(double jd_tdb,Mat3&r1n,Mat3&prec) const{
+	double v[kVal];
+	if(!interp(jd_tdb,v)){
+		return false;
+	}
+	r1n=CoordTf::R3(-v[1])*CoordTf::R1(v[0]);
+	for(int i=0;i<9;++i){
+		prec.m[i/3][i%3]=v[3+i];
+	}
+	return true;
+}
+
+void FrameCache::measure(){
+	err_rad_=0.0;
+	const long long n_itv=k1_-k0_-4;
+	const long long stride=std::max<long long>(1,n_itv/16);
+	for(long long i=0;i<n_itv;i+=stride){
+		const double jd=JD0+step_*(static_cast<double>(k0_+2+i)+0.5);
+		Mat3 r1n,prec;
+		eval(jd,r1n,prec);
+		const Mat3 a=r1n*prec*CoordTf::bias_mat();
+		const Mat3 b=PrecNut::ecl_mat(jd);
+		for(int r=0;r<3;++r){
+			for(int c=0;c<3;++c){
+				err_rad_=std::max(err_rad_,std::fabs(a.m[r][c]-b.m[r][c]));
+			}
+		}
+	}
+}
+
+std::shared_ptr<const FrameCache> frame_cache(double jd_tdb){
+	static std::mutex mtx;
+	static std::map<long long,std::weak_ptr<const FrameCache>> blocks;
+	const double span=FrameCache::BLOCK*FrameCache::DEF_STEP;
+	const long long b=
+		static_cast<long long>(std::floor((jd_tdb-FrameCache::JD0)/span));
+	std::lock_guard<std::mutex> lock(mtx);
+	auto it=blocks.find(b);
+	if(it!=blocks.end()){
+		if(auto sp=it->second.lock()){
+			return sp;
+		}
+	}
+	const double lo=FrameCache::JD0+span*static_cast<double>(b);
+	auto sp=std::make_shared<const FrameCache>(lo,lo+span);
+	blocks[b]=sp;
+	return sp;
+}
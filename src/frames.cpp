@@ -2,6 +2,8 @@
 
 #include<cmath>
 
+#include "lunar/nut_ser.hpp"
+
 extern "C"{
 #ifdef USE_ERFA
 #include "erfa.h"
@@ -111,43 +113,20 @@ double PrecNut::mean_obl(double jd_tdb){
 }
 
 std::pair<double,double> PrecNut::nut_ang(double jd_tdb){
+	return nut_eval(jd_tdb);
+}
+
+void PrecNut::nut_j2(double jd_tdb,double&dpsi,double&deps){
 #ifdef USE_ERFA
 	double d1=std::floor(jd_tdb);
 	double d2=jd_tdb-d1;
-	double dpsi=0.0;
-	double deps=0.0;
-	eraNut00a(d1,d2,&dpsi,&deps);
-	return {dpsi,deps};
+	double fj2=-2.7774e-6*((d1-ERFA_DJ00)+d2)/ERFA_DJC;
+	dpsi=dpsi+dpsi*(0.4697e-6+fj2);
+	deps=deps+deps*fj2;
 #else
-	double T=(jd_tdb-2451545.0)/36525.0;
-	double l=(134.96340251+1717915923.2178*T+31.8792*T*T+0.051635*std::pow(T,3)-
-			  0.00024470*std::pow(T,4));
-	double lp=(357.52910918+129596581.0481*T-0.5532*T*T+0.000136*std::pow(T,3)-
-			   0.00001149*std::pow(T,4));
-	double F=(93.27209062+1739527262.8478*T-12.7512*T*T-0.001037*std::pow(T,3)+
-			  0.00000417*std::pow(T,4));
-	double D=(297.85019547+1602961601.2090*T-6.3706*T*T+0.006593*std::pow(T,3)-
-			  0.00003169*std::pow(T,4));
-	double Om=(125.04455501-6962890.5431*T+7.4722*T*T+0.007702*std::pow(T,3)-
-			   0.00005939*std::pow(T,4));
-
-	double d2r=PI/180.0;
-	l*=d2r;
-	lp*=d2r;
-	F*=d2r;
-	D*=d2r;
-	Om*=d2r;
-	double as2rad=PI/648000.0;
-
-	double dpsi=
-		(-17.20642418*std::sin(Om)+0.003386*std::cos(Om)-
-		 1.31709122*std::sin(2*F-2*D+2*Om)-0.0013696*std::cos(2*F-2*D+2*Om))*
-		as2rad;
-	double deps=
-		(0.0015377*std::sin(Om)+9.2052331*std::cos(Om)-
-		 0.0004587*std::sin(2*F-2*D+2*Om)+0.5730336*std::cos(2*F-2*D+2*Om))*
-		as2rad;
-	return {dpsi,deps};
+	(void)jd_tdb;
+	(void)dpsi;
+	(void)deps;
 #endif
 }
 
@@ -168,3 +147,10 @@ Mat3 PrecNut::nut_mat(double jd_tdb){
 	return N;
 #endif
 }
+
+Mat3 PrecNut::ecl_mat(double jd_tdb){
+	auto nd=nut_eval(jd_tdb);
+	nut_j2(jd_tdb,nd.first,nd.second);
+	return CoordTf::R3(-nd.first)*CoordTf::R1(mean_obl(jd_tdb))*prec_mat(jd_tdb)*
+		   CoordTf::bias_mat();
+}
@@ -5,6 +5,9 @@
 #include<iostream>
 #include<vector>
 
+#include "lunar/math.hpp"
+#include "lunar/spk_meta.hpp"
+
 namespace fs=std::filesystem;
 
 const std::string CFG_FILE="lun_cfg.txt";
@@ -85,6 +88,28 @@ std::vector<fs::path> find_bsps(const std::vector<fs::path>&dirs){
 	return files;
 }
 
+std::string cov_label(const fs::path&path){
+	double lo=0.0;
+	double hi=0.0;
+	try{
+		if(!spk_meta(path.string())->cover({10,399,301},lo,hi)){
+			return "覆盖：无日地月数据";
+		}
+	}catch(...){
+		return "覆盖：无法读取";
+	}
+	int y0=0;
+	int y1=0;
+	int m=0;
+	int d=0;
+	int h=0;
+	int mi=0;
+	double sec=0.0;
+	jd2greg(lo,y0,m,d,h,mi,sec);
+	jd2greg(hi,y1,m,d,h,mi,sec);
+	return "覆盖："+std::to_string(y0)+"–"+std::to_string(y1);
+}
+
 std::string ask_line(const std::string&msg){
 	std::cout<<msg;
 	std::string line;
@@ -200,7 +225,8 @@ std::string init_bsp(InterCfg&cfg){
 		std::cout<<"找到以下 BSP 文件："<<std::endl;
 		for(std::size_t i=0;i<bsp_files.size();++i){
 			std::cout<<"["<<(i+1)<<"] "<<bsp_files[i].filename().string()<<"  ("
-					 <<bsp_files[i].string()<<")"<<std::endl;
+					 <<bsp_files[i].string()<<")  "<<cov_label(bsp_files[i])
+					 <<std::endl;
 		}
 		std::cout<<"请选择要使用的星历文件编号（或输入 0 进入下载界面）：";
 		std::string sel;
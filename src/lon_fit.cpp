@@ -0,0 +1,261 @@
+#include "lunar/lon_fit.hpp"
+
+#include<algorithm>
+#include<cmath>
+#include<cstring>
+#include<fstream>
+#include<iterator>
+#include<map>
+#include<mutex>
+#include<stdexcept>
+
+#include "lunar/app_long.hpp"
+#include "lunar/math.hpp"
+#include "lunar/spc_ephem.hpp"
+
+namespace{
+
+const char kMagic[8]={'L','U','N','L','F','I','T','\0'};
+
+double wrap_pi(double a){ return std::remainder(a,TWO_PI); }
+
+void cheb_fit(const double*f,int n,double*c){
+	for(int j=0;j<n;++j){
+		double sum=0.0;
+		for(int k=0;k<n;++k){
+			sum+=f[k]*std::cos(PI*j*(k+0.5)/n);
+		}
+		c[j]=2.0*sum/n;
+	}
+	c[0]*=0.5;
+}
+
+LonSer fit_ser(AppLon&app,bool moon,double jd_lo,double jd_hi,double len,
+			   int ncf){
+	if(!(len>0.0)||ncf<2){
+		throw std::invalid_argument("invalid fit segment settings");
+	}
+	LonSer ser;
+	ser.seg_len=len;
+	ser.ncf=ncf;
+	ser.nseg=std::max(1,static_cast<int>(std::ceil((jd_hi-jd_lo)/len)));
+
+	const std::size_t n_node=static_cast<std::size_t>(ser.nseg)*ncf;
+	std::vector<double> jd(n_node),lam(n_node),lam_dot(n_node);
+	for(int s=0;s<ser.nseg;++s){
+		for(int k=0;k<ncf;++k){
+			double x=std::cos(PI*(k+0.5)/ncf);
+			jd[static_cast<std::size_t>(s)*ncf+k]=jd_lo+len*(s+0.5*(x+1.0));
+		}
+	}
+	if(moon){
+		app.moon_calc_n(jd.data(),n_node,lam.data(),lam_dot.data());
+	}else{
+		app.sun_calc_n(jd.data(),n_node,lam.data(),lam_dot.data());
+	}
+
+	ser.coef.resize(n_node);
+	std::vector<double> f(ncf);
+	for(int s=0;s<ser.nseg;++s){
+		const double*l=&lam[static_cast<std::size_t>(s)*ncf];
+		f[ncf-1]=l[ncf-1];
+		for(int k=ncf-2;k>=0;--k){
+			f[k]=f[k+1]+wrap_pi(l[k]-f[k+1]);
+		}
+		cheb_fit(f.data(),ncf,&ser.coef[static_cast<std::size_t>(s)*ncf]);
+	}
+
+	const double x_chk[4]={-1.0,-0.5,0.0,0.5};
+	std::vector<double> jd_chk;
+	jd_chk.reserve(static_cast<std::size_t>(ser.nseg)*4+1);
+	for(int s=0;s<ser.nseg;++s){
+		for(double x : x_chk){
+			jd_chk.push_back(jd_lo+len*(s+0.5*(x+1.0)));
+		}
+	}
+	jd_chk.push_back(jd_lo+len*ser.nseg);
+	lam.resize(jd_chk.size());
+	lam_dot.resize(jd_chk.size());
+	if(moon){
+		app.moon_calc_n(jd_chk.data(),jd_chk.size(),lam.data(),lam_dot.data());
+	}else{
+		app.sun_calc_n(jd_chk.data(),jd_chk.size(),lam.data(),lam_dot.data());
+	}
+	ser.max_err=0.0;
+	for(std::size_t i=0;i<jd_chk.size();++i){
+		double err=std::fabs(wrap_pi(ser.eval(jd_lo,jd_chk[i]).first-lam[i]));
+		ser.max_err=std::max(ser.max_err,err);
+	}
+	return ser;
+}
+
+template<typename T> void put(std::ofstream&ofs,T v){
+	ofs.write(reinterpret_cast<const char*>(&v),sizeof(T));
+}
+
+template<typename T> T get(const std::vector<char>&buf,std::size_t&pos){
+	if(pos+sizeof(T)>buf.size()){
+		throw std::runtime_error("fit file is truncated");
+	}
+	T v;
+	std::memcpy(&v,buf.data()+pos,sizeof(T));
+	pos+=sizeof(T);
+	return v;
+}
+
+void put_ser(std::ofstream&ofs,const LonSer&ser){
+	put<double>(ofs,ser.seg_len);
+	put<std::uint32_t>(ofs,static_cast<std::uint32_t>(ser.ncf));
+	put<std::uint32_t>(ofs,static_cast<std::uint32_t>(ser.nseg));
+	put<double>(ofs,ser.max_err);
+}
+
+LonSer get_ser(const std::vector<char>&buf,std::size_t&pos){
+	LonSer ser;
+	ser.seg_len=get<double>(buf,pos);
+	ser.ncf=static_cast<int>(get<std::uint32_t>(buf,pos));
+	ser.nseg=static_cast<int>(get<std::uint32_t>(buf,pos));
+	ser.max_err=get<double>(buf,pos);
+	if(!(ser.seg_len>0.0)||ser.ncf<2||ser.ncf>64||ser.nseg<1){
+		throw std::runtime_error("fit file has an invalid series header");
+	}
+	return ser;
+}
+
+} // namespace
+
+std::pair<double,double> LonSer::eval(double jd0,double jd_tdb) const{
+	const double u=(jd_tdb-jd0)/seg_len;
+	const int s=std::min(std::max(static_cast<int>(std::floor(u)),0),nseg-1);
+	const double x=2.0*(u-s)-1.0;
+	const double x2=2.0*x;
+	const double*c=&coef[static_cast<std::size_t>(s)*ncf];
+	double w0=0.0,w1=0.0,w2=0.0;
+	double d0=0.0,d1=0.0,d2=0.0;
+	for(int j=ncf-1;j>0;--j){
+		w2=w1;
+		w1=w0;
+		w0=c[j]+(x2*w1-w2);
+		d2=d1;
+		d1=d0;
+		d0=w1*2.0+(x2*d1-d2);
+	}
+	double lam=std::fmod(c[0]+(x*w0-w1),TWO_PI);
+	if(lam<0){
+		lam+=TWO_PI;
+	}
+	const double lam_dot=(w0+(x*d0-d1))*2.0/seg_len;
+	return {lam,lam_dot};
+}
+
+LonFit LonFit::build(EphRead&eph,double jd_lo,double jd_hi,
+					 const FitOpts&opts){
+	if(eph.lfit){
+		throw std::invalid_argument("fit requires a BSP ephemeris as input");
+	}
+	if(!(jd_hi>jd_lo)){
+		throw std::invalid_argument("fit window is empty");
+	}
+	LonFit out;
+	out.jd_lo=jd_lo;
+	out.jd_hi=jd_hi;
+	AppLon app(eph);
+	out.sun_ser=fit_ser(app,false,jd_lo,jd_hi,opts.sun_days,opts.sun_ncf);
+	out.moon_ser=fit_ser(app,true,jd_lo,jd_hi,opts.moon_days,opts.moon_ncf);
+	return out;
+}
+
+bool LonFit::is_fit(const std::string&path){
+	std::ifstream ifs(path,std::ios::binary);
+	char head[8]={};
+	if(!ifs.read(head,sizeof(head))){
+		return false;
+	}
+	return std::memcmp(head,kMagic,sizeof(kMagic))==0;
+}
+
+void LonFit::save(const std::string&path) const{
+	std::ofstream ofs(path,std::ios::binary|std::ios::trunc);
+	if(!ofs){
+		throw std::runtime_error("failed to open output file: "+path);
+	}
+	ofs.write(kMagic,sizeof(kMagic));
+	put<std::uint32_t>(ofs,VERSION);
+	put<std::uint32_t>(ofs,0);
+	put<double>(ofs,jd_lo);
+	put<double>(ofs,jd_hi);
+	put_ser(ofs,sun_ser);
+	put_ser(ofs,moon_ser);
+	for(const LonSer*ser : {&sun_ser,&moon_ser}){
+		const std::size_t nb=ser->coef.size()*sizeof(double);
+		ofs.write(reinterpret_cast<const char*>(ser->coef.data()),
+				  static_cast<std::streamsize>(nb));
+	}
+	if(!ofs){
+		throw std::runtime_error("failed to write fit file: "+path);
+	}
+}
+
+LonFit LonFit::load(const std::string&path){
+	std::ifstream ifs(path,std::ios::binary);
+	if(!ifs){
+		throw std::runtime_error("failed to open fit file: "+path);
+	}
+	std::vector<char> buf((std::istreambuf_iterator<char>(ifs)),
+						  std::istreambuf_iterator<char>());
+	if(buf.size()<sizeof(kMagic)||
+	   std::memcmp(buf.data(),kMagic,sizeof(kMagic))!=0){
+		throw std::runtime_error("not a lunar fit file: "+path);
+	}
+	std::size_t pos=sizeof(kMagic);
+	std::uint32_t ver=get<std::uint32_t>(buf,pos);
+	if(ver!=VERSION){
+		throw std::runtime_error("unsupported fit file version "+
+								 std::to_string(ver)+": "+path);
+	}
+	get<std::uint32_t>(buf,pos);
+	LonFit out;
+	out.jd_lo=get<double>(buf,pos);
+	out.jd_hi=get<double>(buf,pos);
+	out.sun_ser=get_ser(buf,pos);
+	out.moon_ser=get_ser(buf,pos);
+	for(LonSer*ser : {&out.sun_ser,&out.moon_ser}){
+		const std::size_t n=static_cast<std::size_t>(ser->nseg)*ser->ncf;
+		if(pos+n*sizeof(double)>buf.size()){
+			throw std::runtime_error("fit file is truncated: "+path);
+		}
+		ser->coef.resize(n);
+		std::memcpy(ser->coef.data(),buf.data()+pos,n*sizeof(double));
+		pos+=n*sizeof(double);
+	}
+	return out;
+}
+
+std::pair<double,double> LonFit::sun(double jd_tdb) const{
+	if(!covers(jd_tdb)){
+		throw std::runtime_error("epoch outside fit file coverage");
+	}
+	return sun_ser.eval(jd_lo,jd_tdb);
+}
+
+std::pair<double,double> LonFit::moon(double jd_tdb) const{
+	if(!covers(jd_tdb)){
+		throw std::runtime_error("epoch outside fit file coverage");
+	}
+	return moon_ser.eval(jd_lo,jd_tdb);
+}
+
+std::shared_ptr<const LonFit> lfit_open(const std::string&path){
+	static std::mutex mtx;
+	static std::map<std::string,std::weak_ptr<const LonFit>> open_files;
+	std::lock_guard<std::mutex> lock(mtx);
+	auto it=open_files.find(path);
+	if(it!=open_files.end()){
+		if(auto sp=it->second.lock()){
+			return sp;
+		}
+	}
+	auto sp=std::make_shared<const LonFit>(LonFit::load(path));
+	open_files[path]=sp;
+	return sp;
+}
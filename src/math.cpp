@@ -1,6 +1,8 @@
 #include "lunar/math.hpp"
 
 #include<cmath>
+#include<cstdint>
+#include<cstring>
 #include<iomanip>
 #include<sstream>
 
@@ -120,3 +122,22 @@ std::string fmt_local(const LocalDT&t){
 	oss<<std::fixed<<std::setprecision(3)<<std::setw(6)<<t.second;
 	return oss.str();
 }
+
+double ulp_dist(double a,double b){
+	if(a==b){
+		return 0.0;
+	}
+	if(!std::isfinite(a)||!std::isfinite(b)){
+		return INFINITY;
+	}
+	std::int64_t ia=0,ib=0;
+	std::memcpy(&ia,&a,sizeof(a));
+	std::memcpy(&ib,&b,sizeof(b));
+	if(ia<0){
+		ia=INT64_MIN-ia;
+	}
+	if(ib<0){
+		ib=INT64_MIN-ib;
+	}
+	return std::fabs(static_cast<double>(ia)-static_cast<double>(ib));
+}
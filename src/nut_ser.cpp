@@ -0,0 +1,481 @@
+#include "lunar/nut_ser.hpp"
+
+#include<algorithm>
+#include<cmath>
+#include<vector>
+
+#include "lunar/cheb_simd.hpp"
+#include "lunar/math.hpp"
+
+extern "C"{
+#ifdef USE_ERFA
+#include "erfa.h"
+#endif
+}
+
+#if defined(__x86_64__)||defined(_M_X64)||defined(__i386__)||defined(_M_IX86)
+#define LUNAR_X86 1
+#include<immintrin.h>
+#if defined(_MSC_VER)&&!defined(__clang__)
+#define LUNAR_AVX2_FN
+#else
+#define LUNAR_AVX2_FN __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace{
+
+struct LsTerm{
+	int nl,nlp,nf,nd,nom;
+	double sp,spt,cp,ce,cet,se;
+};
+
+struct PlTerm{
+	int nl,nf,nd,nom,nme,nve,nea,nma,nju,nsa,nur,nne,npa;
+	int sp,cp,se,ce;
+};
+
+#ifdef LUNAR_NUT_TAB
+#include "nut00a_tab.inc"
+#else
+const LsTerm kLs[]={
+	{0,0,0,0,1,-172064241.8,0.0,33860.0,92052331.0,0.0,15377.0},
+	{0,0,2,-2,2,-13170912.2,0.0,-13696.0,5730336.0,0.0,-4587.0},
+};
+#endif
+
+#ifdef USE_ERFA
+const double kU2R=ERFA_DAS2R/1e7;
+#else
+const double kU2R=PI/648000.0/1e7;
+#endif
+
+const double kInvPio2=6.36619772367581382433e-01;
+const double kPio2a=1.57079632673412561417e+00;
+const double kPio2b=6.07710050630396597660e-11;
+const double kPio2c=2.02226624879595063154e-21;
+
+const double kS[6]={-1.66666666666666324348e-01,8.33333333332248946124e-03,
+					-1.98412698298579493134e-04,2.75573137070700676789e-06,
+					-2.50507602534068634195e-08,1.58969099521155010221e-10};
+const double kC[6]={4.16666666666666019037e-02,-1.38888888888741095749e-03,
+					2.48015872894767294178e-05,-2.75573143513906633035e-07,
+					2.08757232129817482790e-09,-1.13596475577881948265e-11};
+
+constexpr int kMaxArg=13;
+
+struct Soa{
+	int n_arg=0;
+	std::size_t n=0;
+	std::vector<double> m;
+	std::vector<double> cf;
+
+	const double*col(int j) const{ return &m[static_cast<std::size_t>(j)*n]; }
+	const double*coef(int k) const{
+		return &cf[static_cast<std::size_t>(k)*n];
+	}
+};
+
+Soa mk_soa(int n_arg,std::size_t n_term){
+	Soa tb;
+	tb.n_arg=n_arg;
+	tb.n=(n_term+3)&~static_cast<std::size_t>(3);
+	tb.m.assign(static_cast<std::size_t>(n_arg)*tb.n,0.0);
+	tb.cf.assign(6*tb.n,0.0);
+	return tb;
+}
+
+void put_cf(Soa&tb,std::size_t i,double sp,double spt,double cp,double ce,
+			double cet,double se){
+	const double v[6]={sp,spt,cp,ce,cet,se};
+	for(int k=0;k<6;++k){
+		tb.cf[static_cast<std::size_t>(k)*tb.n+i]=v[k];
+	}
+}
+
+Soa ls_soa(){
+	const std::size_t n=sizeof(kLs)/sizeof(kLs[0]);
+	Soa tb=mk_soa(5,n);
+	for(std::size_t i=0;i<n;++i){
+		const LsTerm&t=kLs[i];
+		const int mul[5]={t.nl,t.nlp,t.nf,t.nd,t.nom};
+		for(int j=0;j<5;++j){
+			tb.m[static_cast<std::size_t>(j)*tb.n+i]=mul[j];
+		}
+		put_cf(tb,i,t.sp,t.spt,t.cp,t.ce,t.cet,t.se);
+	}
+	return tb;
+}
+
+Soa pl_soa(){
+#ifdef LUNAR_NUT_TAB
+	const std::size_t n=sizeof(kPl)/sizeof(kPl[0]);
+	Soa tb=mk_soa(13,n);
+	for(std::size_t i=0;i<n;++i){
+		const PlTerm&t=kPl[i];
+		const int mul[13]={t.nl, t.nf, t.nd, t.nom,t.nme,t.nve,t.nea,
+						   t.nma,t.nju,t.nsa,t.nur,t.nne,t.npa};
+		for(int j=0;j<13;++j){
+			tb.m[static_cast<std::size_t>(j)*tb.n+i]=mul[j];
+		}
+		put_cf(tb,i,t.sp,0.0,t.cp,t.ce,0.0,t.se);
+	}
+	return tb;
+#else
+	return mk_soa(13,0);
+#endif
+}
+
+const Soa&ls_tab(){
+	static const Soa tb=ls_soa();
+	return tb;
+}
+
+const Soa&pl_tab(){
+	static const Soa tb=pl_soa();
+	return tb;
+}
+
+double jc(double jd_tdb){
+#ifdef USE_ERFA
+	double d1=std::floor(jd_tdb);
+	double d2=jd_tdb-d1;
+	return ((d1-ERFA_DJ00)+d2)/ERFA_DJC;
+#else
+	return (jd_tdb-2451545.0)/36525.0;
+#endif
+}
+
+void ls_arg(double t,double a[kMaxArg]){
+#ifdef LUNAR_NUT_TAB
+	a[0]=eraFal03(t);
+	a[1]=std::fmod(1287104.79305+
+					   t*(129596581.0481+
+						  t*(-0.5532+t*(0.000136+t*(-0.00001149)))),
+				   ERFA_TURNAS)*
+		 ERFA_DAS2R;
+	a[2]=eraFaf03(t);
+	a[3]=std::fmod(1072260.70369+
+					   t*(1602961601.2090+
+						  t*(-6.3706+t*(0.006593+t*(-0.00003169)))),
+				   ERFA_TURNAS)*
+		 ERFA_DAS2R;
+	a[4]=eraFaom03(t);
+#else
+	double as2rad=PI/648000.0;
+	a[0]=0.0;
+	a[1]=0.0;
+	a[2]=(335779.526232+1739527262.8478*t-12.7512*t*t-
+		  0.001037*std::pow(t,3)+0.00000417*std::pow(t,4))*
+		 as2rad;
+	a[3]=(1072260.70369+1602961601.2090*t-6.3706*t*t+
+		  0.006593*std::pow(t,3)-0.00003169*std::pow(t,4))*
+		 as2rad;
+	a[4]=(450160.398036-6962890.5431*t+7.4722*t*t+
+		  0.007702*std::pow(t,3)-0.00005939*std::pow(t,4))*
+		 as2rad;
+#endif
+}
+
+void pl_arg(double t,double a[kMaxArg]){
+#ifdef LUNAR_NUT_TAB
+	a[0]=std::fmod(2.35555598+8328.6914269554*t,ERFA_D2PI);
+	a[1]=std::fmod(1.627905234+8433.466158131*t,ERFA_D2PI);
+	a[2]=std::fmod(5.198466741+7771.3771468121*t,ERFA_D2PI);
+	a[3]=std::fmod(2.18243920-33.757045*t,ERFA_D2PI);
+	a[4]=eraFame03(t);
+	a[5]=eraFave03(t);
+	a[6]=eraFae03(t);
+	a[7]=eraFama03(t);
+	a[8]=eraFaju03(t);
+	a[9]=eraFasa03(t);
+	a[10]=eraFaur03(t);
+	a[11]=std::fmod(5.321159000+3.8127774000*t,ERFA_D2PI);
+	a[12]=eraFapa03(t);
+#else
+	std::fill(a,a+kMaxArg,0.0);
+	(void)t;
+#endif
+}
+
+void sincos1(double x,double&s,double&c){
+	const double q=std::nearbyint(x*kInvPio2);
+	double r=x-q*kPio2a;
+	r=r-q*kPio2b;
+	r=r-q*kPio2c;
+	const double z=r*r;
+	double ps=kS[5];
+	double pc=kC[5];
+	for(int k=4;k>=0;--k){
+		ps=ps*z+kS[k];
+		pc=pc*z+kC[k];
+	}
+	const double sr=r+(r*z)*ps;
+	const double cr=(1.0-0.5*z)+(z*z)*pc;
+	const long long qi=static_cast<long long>(q);
+	s=(qi&1)?cr:sr;
+	c=(qi&1)?sr:cr;
+	if(qi&2){
+		s=-s;
+	}
+	if((qi+1)&2){
+		c=-c;
+	}
+}
+
+void ser_scalar(const Soa&tb,const double*arg,double t,double&dp,
+				double&de){
+	double ap[4]={};
+	double ae[4]={};
+	const double*sp=tb.coef(0);
+	const double*spt=tb.coef(1);
+	const double*cp=tb.coef(2);
+	const double*ce=tb.coef(3);
+	const double*cet=tb.coef(4);
+	const double*se=tb.coef(5);
+	for(std::size_t i=0;i<tb.n;++i){
+		double a=tb.col(0)[i]*arg[0];
+		for(int j=1;j<tb.n_arg;++j){
+			a=a+tb.col(j)[i]*arg[j];
+		}
+		double s,c;
+		sincos1(a,s,c);
+		ap[i&3]+=(sp[i]+spt[i]*t)*s+cp[i]*c;
+		ae[i&3]+=(ce[i]+cet[i]*t)*c+se[i]*s;
+	}
+	dp=(ap[0]+ap[1])+(ap[2]+ap[3]);
+	de=(ae[0]+ae[1])+(ae[2]+ae[3]);
+}
+
+#ifdef LUNAR_X86
+
+LUNAR_AVX2_FN inline void sincos4(__m256d x,__m256d&s,__m256d&c){
+	const __m256d q=
+		_mm256_round_pd(_mm256_mul_pd(x,_mm256_set1_pd(kInvPio2)),
+						_MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC);
+	__m256d r=_mm256_sub_pd(x,_mm256_mul_pd(q,_mm256_set1_pd(kPio2a)));
+	r=_mm256_sub_pd(r,_mm256_mul_pd(q,_mm256_set1_pd(kPio2b)));
+	r=_mm256_sub_pd(r,_mm256_mul_pd(q,_mm256_set1_pd(kPio2c)));
+	const __m256d z=_mm256_mul_pd(r,r);
+	__m256d ps=_mm256_set1_pd(kS[5]);
+	__m256d pc=_mm256_set1_pd(kC[5]);
+	for(int k=4;k>=0;--k){
+		ps=_mm256_add_pd(_mm256_mul_pd(ps,z),_mm256_set1_pd(kS[k]));
+		pc=_mm256_add_pd(_mm256_mul_pd(pc,z),_mm256_set1_pd(kC[k]));
+	}
+	const __m256d sr=_mm256_add_pd(r,_mm256_mul_pd(_mm256_mul_pd(r,z),ps));
+	const __m256d cr=
+		_mm256_add_pd(_mm256_sub_pd(_mm256_set1_pd(1.0),
+									_mm256_mul_pd(_mm256_set1_pd(0.5),z)),
+					  _mm256_mul_pd(_mm256_mul_pd(z,z),pc));
+	const __m256i qi=_mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(q));
+	const __m256i one=_mm256_set1_epi64x(1);
+	const __m256i two=_mm256_set1_epi64x(2);
+	const __m256d swp=_mm256_castsi256_pd(
+		_mm256_cmpeq_epi64(_mm256_and_si256(qi,one),one));
+	const __m256d sgn=_mm256_set1_pd(-0.0);
+	const __m256d ns=_mm256_and_pd(
+		sgn,_mm256_castsi256_pd(
+				_mm256_cmpeq_epi64(_mm256_and_si256(qi,two),two)));
+	const __m256d nc=_mm256_and_pd(
+		sgn,_mm256_castsi256_pd(_mm256_cmpeq_epi64(
+				_mm256_and_si256(_mm256_add_epi64(qi,one),two),two)));
+	s=_mm256_xor_pd(_mm256_blendv_pd(sr,cr,swp),ns);
+	c=_mm256_xor_pd(_mm256_blendv_pd(cr,sr,swp),nc);
+}
+
+LUNAR_AVX2_FN inline __m256d hsum4(__m256d a,__m256d b,__m256d c,
+								   __m256d d){
+	return _mm256_add_pd(_mm256_add_pd(a,b),_mm256_add_pd(c,d));
+}
+
+LUNAR_AVX2_FN void ser_avx2(const Soa&tb,const double*arg,double t,
+							double&dp,double&de){
+	__m256d ap=_mm256_setzero_pd();
+	__m256d ae=_mm256_setzero_pd();
+	const __m256d vt=_mm256_set1_pd(t);
+	__m256d va[kMaxArg];
+	for(int j=0;j<tb.n_arg;++j){
+		va[j]=_mm256_set1_pd(arg[j]);
+	}
+	const double*sp=tb.coef(0);
+	const double*spt=tb.coef(1);
+	const double*cp=tb.coef(2);
+	const double*ce=tb.coef(3);
+	const double*cet=tb.coef(4);
+	const double*se=tb.coef(5);
+	for(std::size_t i=0;i<tb.n;i+=4){
+		__m256d a=_mm256_mul_pd(_mm256_loadu_pd(tb.col(0)+i),va[0]);
+		for(int j=1;j<tb.n_arg;++j){
+			a=_mm256_add_pd(a,_mm256_mul_pd(_mm256_loadu_pd(tb.col(j)+i),
+											va[j]));
+		}
+		__m256d s,c;
+		sincos4(a,s,c);
+		const __m256d amp_p=_mm256_add_pd(
+			_mm256_loadu_pd(sp+i),_mm256_mul_pd(_mm256_loadu_pd(spt+i),vt));
+		const __m256d amp_e=_mm256_add_pd(
+			_mm256_loadu_pd(ce+i),_mm256_mul_pd(_mm256_loadu_pd(cet+i),vt));
+		ap=_mm256_add_pd(ap,_mm256_add_pd(_mm256_mul_pd(amp_p,s),
+										  _mm256_mul_pd(_mm256_loadu_pd(cp+i),
+														c)));
+		ae=_mm256_add_pd(ae,_mm256_add_pd(_mm256_mul_pd(amp_e,c),
+										  _mm256_mul_pd(_mm256_loadu_pd(se+i),
+														s)));
+	}
+	alignas(32) double bp[4];
+	alignas(32) double be[4];
+	_mm256_store_pd(bp,ap);
+	_mm256_store_pd(be,ae);
+	dp=(bp[0]+bp[1])+(bp[2]+bp[3]);
+	de=(be[0]+be[1])+(be[2]+be[3]);
+}
+
+LUNAR_AVX2_FN void ser4_avx2(const Soa&tb,const double arg[][kMaxArg],
+							 const double t[4],double dp[4],double de[4]){
+	__m256d va[kMaxArg];
+	for(int j=0;j<tb.n_arg;++j){
+		va[j]=_mm256_set_pd(arg[3][j],arg[2][j],arg[1][j],arg[0][j]);
+	}
+	const __m256d vt=_mm256_loadu_pd(t);
+	__m256d ap[4];
+	__m256d ae[4];
+	for(int l=0;l<4;++l){
+		ap[l]=_mm256_setzero_pd();
+		ae[l]=_mm256_setzero_pd();
+	}
+	const double*sp=tb.coef(0);
+	const double*spt=tb.coef(1);
+	const double*cp=tb.coef(2);
+	const double*ce=tb.coef(3);
+	const double*cet=tb.coef(4);
+	const double*se=tb.coef(5);
+	for(std::size_t i=0;i<tb.n;++i){
+		__m256d a=_mm256_mul_pd(_mm256_set1_pd(tb.col(0)[i]),va[0]);
+		for(int j=1;j<tb.n_arg;++j){
+			a=_mm256_add_pd(
+				a,_mm256_mul_pd(_mm256_set1_pd(tb.col(j)[i]),va[j]));
+		}
+		__m256d s,c;
+		sincos4(a,s,c);
+		const __m256d amp_p=_mm256_add_pd(
+			_mm256_set1_pd(sp[i]),_mm256_mul_pd(_mm256_set1_pd(spt[i]),vt));
+		const __m256d amp_e=_mm256_add_pd(
+			_mm256_set1_pd(ce[i]),_mm256_mul_pd(_mm256_set1_pd(cet[i]),vt));
+		ap[i&3]=_mm256_add_pd(
+			ap[i&3],_mm256_add_pd(_mm256_mul_pd(amp_p,s),
+								  _mm256_mul_pd(_mm256_set1_pd(cp[i]),c)));
+		ae[i&3]=_mm256_add_pd(
+			ae[i&3],_mm256_add_pd(_mm256_mul_pd(amp_e,c),
+								  _mm256_mul_pd(_mm256_set1_pd(se[i]),s)));
+	}
+	_mm256_storeu_pd(dp,hsum4(ap[0],ap[1],ap[2],ap[3]));
+	_mm256_storeu_pd(de,hsum4(ae[0],ae[1],ae[2],ae[3]));
+}
+
+#endif
+
+void ser_one(const Soa&tb,const double*arg,double t,double&dp,double&de){
+#ifdef LUNAR_X86
+	if(cheb_isa()==ChebIsa::AVX2){
+		ser_avx2(tb,arg,t,dp,de);
+		return;
+	}
+#endif
+	ser_scalar(tb,arg,t,dp,de);
+}
+
+void nut_one(double jd_tdb,double&dpsi,double&deps){
+	const double t=jc(jd_tdb);
+	double a[kMaxArg];
+	double dp=0.0;
+	double de=0.0;
+	ls_arg(t,a);
+	ser_one(ls_tab(),a,t,dp,de);
+	dpsi=dp*kU2R;
+	deps=de*kU2R;
+	if(pl_tab().n>0){
+		pl_arg(t,a);
+		ser_one(pl_tab(),a,t,dp,de);
+		dpsi=dpsi+dp*kU2R;
+		deps=deps+de*kU2R;
+	}
+}
+
+} // namespace
+
+bool nut_full(){
+#ifdef LUNAR_NUT_TAB
+	return true;
+#else
+	return false;
+#endif
+}
+
+std::size_t nut_terms(){
+	return sizeof(kLs)/sizeof(kLs[0])+
+#ifdef LUNAR_NUT_TAB
+		   sizeof(kPl)/sizeof(kPl[0]);
+#else
+		   0;
+#endif
+}
+
+std::pair<double,double> nut_eval(double jd_tdb){
+	double dpsi=0.0;
+	double deps=0.0;
+	nut_one(jd_tdb,dpsi,deps);
+	return {dpsi,deps};
+}
+
+void nut_eval_n(const double*jd_tdb,std::size_t n,double*dpsi,
+				double*deps){
+	std::size_t i=0;
+#ifdef LUNAR_X86
+	if(cheb_isa()==ChebIsa::AVX2){
+		double a[4][kMaxArg];
+		double t[4];
+		double dp[4];
+		double de[4];
+		for(;i+4<=n;i+=4){
+			for(int l=0;l<4;++l){
+				t[l]=jc(jd_tdb[i+l]);
+				ls_arg(t[l],a[l]);
+			}
+			ser4_avx2(ls_tab(),a,t,dp,de);
+			for(int l=0;l<4;++l){
+				dpsi[i+l]=dp[l]*kU2R;
+				deps[i+l]=de[l]*kU2R;
+			}
+			if(pl_tab().n==0){
+				continue;
+			}
+			for(int l=0;l<4;++l){
+				pl_arg(t[l],a[l]);
+			}
+			ser4_avx2(pl_tab(),a,t,dp,de);
+			for(int l=0;l<4;++l){
+				dpsi[i+l]=dpsi[i+l]+dp[l]*kU2R;
+				deps[i+l]=deps[i+l]+de[l]*kU2R;
+			}
+		}
+	}
+#endif
+	for(;i<n;++i){
+		nut_one(jd_tdb[i],dpsi[i],deps[i]);
+	}
+}
+
+bool nut_ref(double jd_tdb,double&dpsi,double&deps){
+#ifdef USE_ERFA
+	double d1=std::floor(jd_tdb);
+	double d2=jd_tdb-d1;
+	eraNut00a(d1,d2,&dpsi,&deps);
+	return true;
+#else
+	(void)jd_tdb;
+	dpsi=0.0;
+	deps=0.0;
+	return false;
+#endif
+}
@@ -4,6 +4,7 @@
 #include<algorithm>
 #include<array>
 #include<cctype>
+#include<chrono>
 #include<cmath>
 #include<cstdio>
 #include<filesystem>
@@ -29,7 +30,10 @@
 #include "lunar/ics.hpp"
 #include "lunar/interact.hpp"
 #include "lunar/js_writer.hpp"
+#include "lunar/lon_fit.hpp"
 #include "lunar/math.hpp"
+#include "lunar/nut_ser.hpp"
+#include "lunar/spk_meta.hpp"
 #include "lunar/time_scale.hpp"
 
 extern "C"{
@@ -197,8 +201,8 @@ NearEvents comp_near(EphRead&eph,double jd_utc,int tz_off){
 
 	std::vector<EventRec> sol_evts;
 	std::vector<EventRec> ph_evts;
-	for(int y : years){
-		YearResult yr=solver.compute_year(y,nullptr);
+	for(const auto&kv : solver.compute_years(years,nullptr)){
+		const YearResult&yr=kv.second;
 		std::vector<EventRec> se=bld_stev(yr,tz_off);
 		std::vector<EventRec> pe=bld_lpev(yr,tz_off);
 		sol_evts.insert(sol_evts.end(),se.begin(),se.end());
@@ -576,9 +580,45 @@ std::vector<BatchLine> read_bat(bool from_stdin,const std::string&input_file){
 	return lines;
 }
 
+struct AtLon{
+	double lam_s=0.0;
+	double lam_s_dot=0.0;
+	double lam_m=0.0;
+	double lam_m_dot=0.0;
+};
+
+bool at_lons(EphRead&eph,const std::vector<double>&jd_utc,
+			 std::vector<AtLon>&out){
+	const std::size_t n=jd_utc.size();
+	std::vector<double> jd_tdb(n);
+	for(std::size_t i=0;i<n;++i){
+		jd_tdb[i]=TimeScale::utc_to_tdb(jd_utc[i]);
+	}
+	std::vector<double> lam(n),lam_dot(n);
+	out.assign(n,AtLon{});
+	try{
+		AppLon app(eph);
+		app.sun_calc_n(jd_tdb.data(),n,lam.data(),lam_dot.data());
+		for(std::size_t i=0;i<n;++i){
+			out[i].lam_s=lam[i];
+			out[i].lam_s_dot=lam_dot[i];
+		}
+		app.moon_calc_n(jd_tdb.data(),n,lam.data(),lam_dot.data());
+		for(std::size_t i=0;i<n;++i){
+			out[i].lam_m=lam[i];
+			out[i].lam_m_dot=lam_dot[i];
+		}
+	}catch(const std::exception&){
+		out.clear();
+		return false;
+	}
+	return true;
+}
+
 AtData at_fromjd(EphRead&eph,double jd_utc,int tz_disp,
 				 const std::string&display_tz,const std::string&time_raw,
-				 const std::string&tz_in,bool inc_ev){
+				 const std::string&tz_in,bool inc_ev,
+				 const AtLon*lon=nullptr){
 	AtData out;
 	out.time_raw=time_raw;
 	out.tz_in=tz_in;
@@ -586,13 +626,19 @@ AtData at_fromjd(EphRead&eph,double jd_utc,int tz_disp,
 	out.jd_utc=jd_utc;
 	out.jd_tdb=TimeScale::utc_to_tdb(jd_utc);
 
-	AppLon app(eph);
-	auto sun=app.sun_calc(out.jd_tdb);
-	auto moon=app.moon_calc(out.jd_tdb);
-	out.lam_s=sun.first;
-	out.lam_s_dot=sun.second;
-	out.lam_m=moon.first;
-	out.lam_m_dot=moon.second;
+	if(lon){
+		out.lam_s=lon->lam_s;
+		out.lam_s_dot=lon->lam_s_dot;
+		out.lam_m=lon->lam_m;
+		out.lam_m_dot=lon->lam_m_dot;
+	}else{
+		AppLon app(eph);
+		SunMoon sm=app.sun_moon_calc(out.jd_tdb);
+		out.lam_s=sm.sun.first;
+		out.lam_s_dot=sm.sun.second;
+		out.lam_m=sm.moon.first;
+		out.lam_m_dot=sm.moon.second;
+	}
 
 	out.elong=norm2pi(out.lam_m-out.lam_s);
 	out.elong_deg=out.elong*180.0/PI;
@@ -611,14 +657,19 @@ AtData at_fromjd(EphRead&eph,double jd_utc,int tz_disp,
 	return out;
 }
 
+double at_parse(const std::string&time_raw,const std::string&input_tz,
+				std::string&tz_in){
+	IsoTime parsed=parse_iso(time_raw,input_tz);
+	tz_in=parsed.has_tz?fmt_tz(parsed.tz_off):fmt_tz(parse_tz(input_tz));
+	return parsed.jd_utc;
+}
+
 AtData at_ftxt(EphRead&eph,const std::string&time_raw,
 			   const std::string&input_tz,int tz_disp,
 			   const std::string&display_tz,bool inc_ev){
-	IsoTime parsed=parse_iso(time_raw,input_tz);
-	std::string tz_in=
-		parsed.has_tz?fmt_tz(parsed.tz_off):fmt_tz(parse_tz(input_tz));
-	return at_fromjd(eph,parsed.jd_utc,tz_disp,display_tz,time_raw,tz_in,
-					 inc_ev);
+	std::string tz_in;
+	double jd_utc=at_parse(time_raw,input_tz,tz_in);
+	return at_fromjd(eph,jd_utc,tz_disp,display_tz,time_raw,tz_in,inc_ev);
 }
 
 void wr_ejson(JsonWriter&w,const EventRec&ev){
@@ -751,12 +802,11 @@ void wr_atxt(std::ostream&os,const AtData&d,bool hdr_on){
 	}
 }
 
-std::vector<EventRec> col_eyrs(EphRead&eph,const std::set<int>&years,int tz_off,
-							   std::ostream*log){
-	SolLunCal solver(eph);
+std::vector<EventRec> col_eyrs(SolLunCal&solver,const std::set<int>&years,
+							   int tz_off,std::ostream*log){
 	std::vector<EventRec> events;
-	for(int y : years){
-		YearResult yr=solver.compute_year(y,log);
+	for(const auto&kv : solver.compute_years(years,log)){
+		const YearResult&yr=kv.second;
 		std::vector<EventRec> solar=bld_stev(yr,tz_off);
 		std::vector<EventRec> phase=bld_lpev(yr,tz_off);
 		events.insert(events.end(),solar.begin(),solar.end());
@@ -768,6 +818,12 @@ std::vector<EventRec> col_eyrs(EphRead&eph,const std::set<int>&years,int tz_off,
 	return events;
 }
 
+std::vector<EventRec> col_eyrs(EphRead&eph,const std::set<int>&years,int tz_off,
+							   std::ostream*log){
+	SolLunCal solver(eph);
+	return col_eyrs(solver,years,tz_off,log);
+}
+
 EvtFilt parse_ef(const std::string&text){
 	EvtFilt f;
 	if(text.empty()){
@@ -828,7 +884,8 @@ void wr_elics(std::ostream&os,const std::string&ephem,
 			  {"schema=lunar.v1","ephem="+ephem,"--tz仅影响显示"});
 }
 
-bool parse_spk(const std::string&ephem,double&jd_start,double&jd_end);
+bool parse_spk(const std::string&ephem,double&jd_start,double&jd_end,
+			   std::vector<BodyMeta>&bodies);
 
 }
 
@@ -866,19 +923,31 @@ int cmd_info(const std::vector<std::string>&args){
 	chk_fmt(format,{"json","txt"},"info");
 
 	std::error_code ec;
-	bool exists=std::filesystem::exists(ephem,ec);
-	std::uintmax_t size=exists?std::filesystem::file_size(ephem,ec):0;
+	bool exists=true;
+	std::uintmax_t size=0;
+	for(const std::string&path : eph_paths(ephem)){
+		if(!std::filesystem::exists(path,ec)){
+			exists=false;
+			continue;
+		}
+		size+=std::filesystem::file_size(path,ec);
+	}
 
 	double jd_start=std::numeric_limits<double>::quiet_NaN();
 	double jd_end=std::numeric_limits<double>::quiet_NaN();
 	bool has_cov=false;
-	if(exists){
+	std::vector<BodyMeta> bodies;
+	std::shared_ptr<const LonFit> fit;
+	if(exists&&LonFit::is_fit(ephem)){
+		fit=lfit_open(ephem);
+	}else if(exists){
 		try{
-			has_cov=parse_spk(ephem,jd_start,jd_end);
+			has_cov=parse_spk(ephem,jd_start,jd_end,bodies);
 		}catch(...){
 			has_cov=false;
 		}
 	}
+	const double to_as=180.0/PI*3600.0;
 
 	OutTgt out=open_out(out_path);
 	const FmtMap fmt_handlers={
@@ -911,11 +980,41 @@ int cmd_info(const std::vector<std::string>&args){
 				 w.value(fmt_iso(TimeScale::tdb_to_utc(jd_start),0,true));
 				 w.key("u_eisoap");
 				 w.value(fmt_iso(TimeScale::tdb_to_utc(jd_end),0,true));
+				 w.key("bodies");
+				 w.arr_begin();
+				 for(const BodyMeta&bm : bodies){
+					 w.obj_begin();
+					 w.key("id");
+					 w.value(bm.body);
+					 w.key("n_seg");
+					 w.value(bm.n_seg);
+					 w.key("jd_tdb_lo");
+					 w.value(bm.jd_lo());
+					 w.key("jd_tdb_hi");
+					 w.value(bm.jd_hi());
+					 w.obj_end();
+				 }
+				 w.arr_end();
 				 w.obj_end();
 			 }else{
 				 w.key("spk_cov");
 				 w.null_val();
 			 }
+			 if(fit){
+				 w.key("fit");
+				 w.obj_begin();
+				 w.key("version");
+				 w.value(static_cast<int>(LonFit::VERSION));
+				 w.key("jd_tdb_lo");
+				 w.value(fit->jd_lo);
+				 w.key("jd_tdb_hi");
+				 w.value(fit->jd_hi);
+				 w.key("sun_err_as");
+				 w.value(fit->sun_ser.max_err*to_as);
+				 w.key("moon_err_as");
+				 w.value(fit->moon_ser.max_err*to_as);
+				 w.obj_end();
+			 }
 			 w.key("tool_ver");
 			 w.value(tool_ver());
 			 w.key("build_time");
@@ -940,9 +1039,23 @@ int cmd_info(const std::vector<std::string>&args){
 				   <<fmt_iso(TimeScale::tdb_to_utc(jd_start),0,true)<<"\n";
 				 os<<"spk.u_eisoap="
 				   <<fmt_iso(TimeScale::tdb_to_utc(jd_end),0,true)<<"\n";
+				 for(const BodyMeta&bm : bodies){
+					 os<<"spk.body."<<bm.body<<"="<<bm.n_seg<<" "
+					   <<format_num(bm.jd_lo())<<" "<<format_num(bm.jd_hi())
+					   <<"\n";
+				 }
 			 }else{
 				 os<<"spk.coverage=not_avail\n";
 			 }
+			 if(fit){
+				 os<<"fit.version="<<LonFit::VERSION<<"\n";
+				 os<<"fit.jd_tdb_lo="<<format_num(fit->jd_lo)<<"\n";
+				 os<<"fit.jd_tdb_hi="<<format_num(fit->jd_hi)<<"\n";
+				 os<<"fit.sun_err_as="<<format_num(fit->sun_ser.max_err*to_as)
+				   <<"\n";
+				 os<<"fit.moon_err_as="
+				   <<format_num(fit->moon_ser.max_err*to_as)<<"\n";
+			 }
 			 os<<"tool.version="<<tool_ver()<<"\n";
 			 os<<"tool.build_time="<<__DATE__<<" "<<__TIME__<<"\n";
 		 }},
@@ -952,6 +1065,151 @@ int cmd_info(const std::vector<std::string>&args){
 	return 0;
 }
 
+int cmd_fit(const std::vector<std::string>&args){
+	if(args.size()==1&&(args[0]=="-h"||args[0]=="--help")){
+		use_fit();
+		return 0;
+	}
+	if(args.empty()){
+		throw std::invalid_argument("fit requires: <bsp>");
+	}
+	std::string ephem=args[0];
+	std::string years;
+	std::string fit_path;
+	std::string format="txt";
+	bool pretty=true;
+	bool quiet=false;
+	FitOpts opts;
+	const OptMap handlers={
+		{"--years",[&](const std::vector<std::string>&src,std::size_t&idx,
+					   const std::string&opt){ years=req_val(src,idx,opt); }},
+		{"--out",[&](const std::vector<std::string>&src,std::size_t&idx,
+					 const std::string&opt){ fit_path=req_val(src,idx,opt); }},
+		{"--sun-days",[&](const std::vector<std::string>&src,std::size_t&idx,
+						  const std::string&opt){
+			 opts.sun_days=parse_int(req_val(src,idx,opt),"--sun-days");
+		 }},
+		{"--sun-ncf",[&](const std::vector<std::string>&src,std::size_t&idx,
+						 const std::string&opt){
+			 opts.sun_ncf=parse_int(req_val(src,idx,opt),"--sun-ncf");
+		 }},
+		{"--moon-days",[&](const std::vector<std::string>&src,std::size_t&idx,
+						   const std::string&opt){
+			 opts.moon_days=parse_int(req_val(src,idx,opt),"--moon-days");
+		 }},
+		{"--moon-ncf",[&](const std::vector<std::string>&src,std::size_t&idx,
+						  const std::string&opt){
+			 opts.moon_ncf=parse_int(req_val(src,idx,opt),"--moon-ncf");
+		 }},
+		{"--format",[&](const std::vector<std::string>&src,std::size_t&idx,
+						const std::string&opt){
+			 format=to_low(req_val(src,idx,opt));
+		 }},
+		{"--pretty",[&](const std::vector<std::string>&src,std::size_t&idx,
+						const std::string&opt){
+			 pretty=parse_bool01(req_val(src,idx,opt),"--pretty");
+		 }},
+		{"--quiet",[&](const std::vector<std::string>&,std::size_t&,
+					   const std::string&){ quiet=true; }},
+	};
+	for(std::size_t i=1;i<args.size();++i){
+		const std::string&opt=args[i];
+		apply_opt(handlers,args,i,opt,"fit");
+	}
+	chk_fmt(format,{"json","txt"},"fit");
+	if(years.empty()){
+		throw std::invalid_argument("fit requires --years <A-B>");
+	}
+	if(fit_path.empty()){
+		throw std::invalid_argument("fit requires --out <file>");
+	}
+	if(opts.sun_ncf<2||opts.sun_ncf>64||opts.moon_ncf<2||opts.moon_ncf>64){
+		throw std::invalid_argument("--sun-ncf/--moon-ncf must be in [2,64]");
+	}
+	std::vector<int> ys=parse_year(years);
+	const int y_lo=*std::min_element(ys.begin(),ys.end());
+	const int y_hi=*std::max_element(ys.begin(),ys.end());
+	const double jd_lo=TimeScale::utc_to_tdb(greg2jd(y_lo-2,1,1));
+	const double jd_hi=TimeScale::utc_to_tdb(greg2jd(y_hi+3,1,1));
+
+	if(!quiet){
+		std::cerr<<"fitting apparent longitudes for "<<y_lo<<"-"<<y_hi
+				 <<" ..."<<std::endl;
+	}
+	EphRead eph(ephem);
+	auto t0=std::chrono::steady_clock::now();
+	LonFit fit=LonFit::build(eph,jd_lo,jd_hi,opts);
+	auto t1=std::chrono::steady_clock::now();
+	fit.save(fit_path);
+	const double build_ms=
+		std::chrono::duration<double,std::milli>(t1-t0).count();
+	std::error_code ec;
+	const std::uintmax_t fsize=std::filesystem::file_size(fit_path,ec);
+	const double to_as=180.0/PI*3600.0;
+
+	const FmtMap fmt_handlers={
+		{"json",[&](){
+			 JsonWriter w(std::cout,pretty);
+			 w.obj_begin();
+			 write_meta(w,ephem,"Z",{"type=fit"});
+			 w.key("data");
+			 w.obj_begin();
+			 w.key("path");
+			 w.value(fit_path);
+			 w.key("version");
+			 w.value(static_cast<int>(LonFit::VERSION));
+			 w.key("fsize_b");
+			 w.value(static_cast<double>(fsize));
+			 w.key("jd_tdb_lo");
+			 w.value(fit.jd_lo);
+			 w.key("jd_tdb_hi");
+			 w.value(fit.jd_hi);
+			 w.key("build_ms");
+			 w.value(build_ms);
+			 for(const auto&kv :
+				 {std::make_pair("sun",&fit.sun_ser),
+				  std::make_pair("moon",&fit.moon_ser)}){
+				 w.key(kv.first);
+				 w.obj_begin();
+				 w.key("seg_days");
+				 w.value(kv.second->seg_len);
+				 w.key("ncf");
+				 w.value(kv.second->ncf);
+				 w.key("nseg");
+				 w.value(kv.second->nseg);
+				 w.key("max_err_as");
+				 w.value(kv.second->max_err*to_as);
+				 w.obj_end();
+			 }
+			 w.obj_end();
+			 w.obj_end();
+			 std::cout<<"\n";
+		 }},
+		{"txt",[&](){
+			 std::ostream&os=std::cout;
+			 os<<"tool=lunar format=txt type=fit\n";
+			 os<<"fit.path="<<fit_path<<"\n";
+			 os<<"fit.version="<<LonFit::VERSION<<"\n";
+			 os<<"fit.fsize_b="<<fsize<<"\n";
+			 os<<"fit.jd_tdb_lo="<<format_num(fit.jd_lo)<<"\n";
+			 os<<"fit.jd_tdb_hi="<<format_num(fit.jd_hi)<<"\n";
+			 os<<"fit.build_ms="<<format_num(build_ms)<<"\n";
+			 for(const auto&kv :
+				 {std::make_pair("sun",&fit.sun_ser),
+				  std::make_pair("moon",&fit.moon_ser)}){
+				 os<<kv.first<<".seg_days="<<format_num(kv.second->seg_len)
+				   <<"\n";
+				 os<<kv.first<<".ncf="<<kv.second->ncf<<"\n";
+				 os<<kv.first<<".nseg="<<kv.second->nseg<<"\n";
+				 os<<kv.first<<".max_err_as="
+				   <<format_num(kv.second->max_err*to_as)<<"\n";
+			 }
+		 }},
+	};
+	run_fmt(fmt_handlers,format,"fit");
+	return 0;
+}
+
 int cmd_test(const std::vector<std::string>&args){
 	if(args.size()==1&&(args[0]=="-h"||args[0]=="--help")){
 		use_test();
@@ -1046,6 +1304,75 @@ int cmd_test(const std::vector<std::string>&args){
 		}
 		cases.push_back(c3);
 		all_pass=all_pass&&c3.pass;
+
+		Case c4;
+		c4.id="spk_ulp";
+		try{
+			EphRead e_sp(ephem,EphBack::SPICE);
+			EphRead e_nt(ephem,EphBack::NATIVE);
+			const int pairs[][2]={{e_sp.SUN,e_sp.SSB},
+								  {e_sp.EMB,e_sp.SSB},
+								  {e_sp.MOON,e_sp.SSB},
+								  {e_sp.EARTH,e_sp.SSB},
+								  {e_sp.MOON,e_sp.EARTH}};
+			double max_ulp=0.0;
+			for(int i=0;i<64;++i){
+				double jd=2460676.5+i*5.71;
+				for(const auto&pr : pairs){
+					auto a=e_sp.get_state(pr[0],pr[1],jd);
+					auto b=e_nt.get_state(pr[0],pr[1],jd);
+					const double va[6]={a.first.x, a.first.y, a.first.z,
+										a.second.x,a.second.y,a.second.z};
+					const double vb[6]={b.first.x, b.first.y, b.first.z,
+										b.second.x,b.second.y,b.second.z};
+					for(int k=0;k<6;++k){
+						max_ulp=std::max(max_ulp,ulp_dist(va[k],vb[k]));
+					}
+				}
+			}
+			c4.pass=(max_ulp<=4.0);
+			std::ostringstream msg;
+			msg<<"native vs spice max_ulp="<<max_ulp;
+			c4.message=msg.str();
+		}catch(const std::exception&ex){
+			c4.pass=false;
+			c4.message=ex.what();
+		}
+		cases.push_back(c4);
+		all_pass=all_pass&&c4.pass;
+
+		Case c5;
+		c5.id="nut_ser";
+		try{
+			std::vector<double> jd(64),dp(64),de(64);
+			for(std::size_t i=0;i<jd.size();++i){
+				jd[i]=2451545.0+(static_cast<double>(i)-32.0)*573.1;
+			}
+			nut_eval_n(jd.data(),jd.size(),dp.data(),de.data());
+			double max_d=0.0;
+			double max_ref=0.0;
+			for(std::size_t i=0;i<jd.size();++i){
+				auto v=nut_eval(jd[i]);
+				max_d=std::max({max_d,std::fabs(v.first-dp[i]),
+								std::fabs(v.second-de[i])});
+				double r_dp=0.0;
+				double r_de=0.0;
+				if(nut_ref(jd[i],r_dp,r_de)){
+					max_ref=std::max({max_ref,std::fabs(v.first-r_dp),
+									  std::fabs(v.second-r_de)});
+				}
+			}
+			c5.pass=(max_d==0.0&&max_ref<=1e-12);
+			std::ostringstream msg;
+			msg<<"terms="<<nut_terms()<<", batch_diff="<<max_d
+			   <<", erfa_diff="<<max_ref;
+			c5.message=msg.str();
+		}catch(const std::exception&ex){
+			c5.pass=false;
+			c5.message=ex.what();
+		}
+		cases.push_back(c5);
+		all_pass=all_pass&&c5.pass;
 	}catch(const std::exception&ex){
 		all_pass=false;
 		cases.push_back(Case{"bootstrap",false,ex.what()});
@@ -1222,7 +1549,7 @@ int cmd_comp(const std::vector<std::string>&args){
 				 <<"  cur=\"${COMP_WORDS[COMP_CWORD]}\"\n"
 				 <<"  local cmds=\"months calendar year event download at "
 				   "convert day monthview next range search festival almanac "
-				   "info selftest config completion\"\n"
+				   "info selftest config completion bench fit\"\n"
 				 <<"  if [[ ${COMP_CWORD} -eq 1 ]]; then\n"
 				 <<"    COMPREPLY=( $(compgen -W \"${cmds}\" -- \"${cur}\") )\n"
 				 <<"    return 0\n"
@@ -1240,7 +1567,7 @@ int cmd_comp(const std::vector<std::string>&args){
 				 <<"complete -c lunar -n '__fish_use_subcommand' -a 'months "
 				   "calendar year event download at convert day monthview next "
 				   "range search festival almanac info selftest config "
-				   "completion'\n";
+				   "completion bench fit'\n";
 		return 0;
 	}
 	if(shell=="powershell"){
@@ -1251,7 +1578,7 @@ int cmd_comp(const std::vector<std::string>&args){
 			<<"  $cmds = "
 			  "'months','calendar','year','event','download','at','convert','"
 			  "day','monthview','next','range','search','festival','almanac','"
-			  "info','selftest','config','completion'\n"
+			  "info','selftest','config','completion','bench','fit'\n"
 			<<"  $cmds | Where-Object { $_ -like \"$wordToComplete*\" } | "
 			  "ForEach-Object {\n"
 			<<"    "
@@ -1356,6 +1683,19 @@ void use_info(){
 			 <<"  lunar info D:\\de442.bsp --format json --out info.json\n";
 }
 
+void use_fit(){
+	std::cout<<"Usage:\n"
+			 <<"  lunar fit <bsp> --years <A-B> --out <file.lfit> [--sun-days "
+			   "N] [--sun-ncf N]\n"
+			 <<"    [--moon-days N] [--moon-ncf N] [--format json|txt] "
+			   "[--pretty 0|1] [--quiet]\n"
+			 <<"The output file can replace <bsp> for calendar commands "
+			   "(months/year/calendar/...).\n"
+			 <<"Examples:\n"
+			 <<"  lunar fit D:\\de442.bsp --years 1900-2100 --out cal.lfit\n"
+			 <<"  lunar year cal.lfit 2025\n";
+}
+
 void use_test(){
 	std::cout
 		<<"Usage:\n"
@@ -1392,6 +1732,7 @@ void cli_at(const AtArgs&args){
 	chk_fmt(format,{"json","txt"},"at");
 
 	int tz_disp=parse_tz(args.tz);
+	SolLunCal::grid_tz=tz_disp;
 	EphRead eph(args.ephem);
 	AtData result=
 		at_ftxt(eph,args.time_raw,args.input_tz,tz_disp,args.tz,args.events);
@@ -1422,6 +1763,7 @@ void cli_conv(const ConvArgs&args){
 	chk_fmt(format,{"json","txt"},"convert");
 
 	int tz_disp=parse_tz(args.tz);
+	SolLunCal::grid_tz=tz_disp;
 
 	EphRead eph(args.ephem);
 
@@ -1597,6 +1939,7 @@ int run_abcli(const AtArgs&args){
 	}
 
 	const int tz_disp=parse_tz(args.tz);
+	SolLunCal::grid_tz=tz_disp;
 	EphRead eph(args.ephem);
 
 	struct Row{
@@ -1608,14 +1951,17 @@ int run_abcli(const AtArgs&args){
 	};
 	std::vector<Row> rows;
 	rows.reserve(lines.size());
+	std::vector<std::string> tz_ins(lines.size());
+	std::vector<double> jds;
+	jds.reserve(lines.size());
 	int err_cnt=0;
-	for(const auto&line : lines){
+	for(std::size_t i=0;i<lines.size();++i){
 		Row row;
-		row.line_no=line.line_no;
-		row.raw=line.raw;
+		row.line_no=lines[i].line_no;
+		row.raw=lines[i].raw;
 		try{
-			row.data=
-				at_ftxt(eph,line.raw,args.input_tz,tz_disp,args.tz,args.events);
+			row.data.jd_utc=at_parse(row.raw,args.input_tz,tz_ins[i]);
+			jds.push_back(row.data.jd_utc);
 			row.ok=true;
 		}catch(const std::exception&ex){
 			row.ok=false;
@@ -1625,6 +1971,26 @@ int run_abcli(const AtArgs&args){
 		rows.push_back(std::move(row));
 	}
 
+	std::vector<AtLon> lons;
+	const bool have_lon=at_lons(eph,jds,lons);
+	std::size_t k=0;
+	for(std::size_t i=0;i<rows.size();++i){
+		Row&row=rows[i];
+		if(!row.ok){
+			continue;
+		}
+		const AtLon*lon=have_lon?&lons[k]:nullptr;
+		++k;
+		try{
+			row.data=at_fromjd(eph,row.data.jd_utc,tz_disp,args.tz,row.raw,
+							   tz_ins[i],args.events,lon);
+		}catch(const std::exception&ex){
+			row.ok=false;
+			row.error=ex.what();
+			++err_cnt;
+		}
+	}
+
 	OutTgt out=open_out(args.out);
 	const FmtMap fmt_handlers={
 		{"jsonl",[&](){
@@ -1734,6 +2100,7 @@ int run_cbcli(const ConvArgs&args){
 	}
 
 	const int tz_disp=parse_tz(args.tz);
+	SolLunCal::grid_tz=tz_disp;
 	EphRead eph(args.ephem);
 
 	struct Row{
@@ -2443,6 +2810,7 @@ int cmd_day(const std::vector<std::string>&args){
 	parse_hms(at_time,hh,mm,ss);
 
 	int tz_off=parse_tz(tz);
+	SolLunCal::grid_tz=tz_off;
 	double smp_jdutc=greg2jd(y,m,d,hh,mm,ss)-UTC8DAY;
 	double day_sutc=cst_midjd(y,m,d);
 	double day_eutc=day_sutc+1.0;
@@ -2593,6 +2961,7 @@ int cmd_mview(const std::vector<std::string>&args){
 	std::tie(year,month)=parse_ym(ym);
 
 	int tz_off=parse_tz(tz);
+	SolLunCal::grid_tz=tz_off;
 	int n_days=days_gm(year,month);
 	EphRead eph(ephem);
 
@@ -2618,10 +2987,17 @@ int cmd_mview(const std::vector<std::string>&args){
 	};
 	std::vector<Row> rows;
 	rows.reserve(static_cast<std::size_t>(n_days));
+	std::vector<double> smp_jds;
+	smp_jds.reserve(static_cast<std::size_t>(n_days));
 	for(int d=1;d<=n_days;++d){
-		double smp_jdutc=greg2jd(year,month,d,12,0,0.0)-UTC8DAY;
-		AtData atd=at_fromjd(eph,smp_jdutc,tz_off,tz,ymd_str(year,month,d),
-							 "+08:00",false);
+		smp_jds.push_back(greg2jd(year,month,d,12,0,0.0)-UTC8DAY);
+	}
+	std::vector<AtLon> lons;
+	const bool have_lon=at_lons(eph,smp_jds,lons);
+	for(int d=1;d<=n_days;++d){
+		const std::size_t di=static_cast<std::size_t>(d-1);
+		AtData atd=at_fromjd(eph,smp_jds[di],tz_off,tz,ymd_str(year,month,d),
+							 "+08:00",false,have_lon?&lons[di]:nullptr);
 		std::string summary;
 		auto it=day2ev.find(d);
 		if(it!=day2ev.end()){
@@ -2761,12 +3137,15 @@ int cmd_next(const std::vector<std::string>&args){
 		throw std::invalid_argument("next requires --from <time>");
 	}
 	chk_fmt(format,{"json","txt","csv","ics","jsonl"},"next");
+	const PrecHint hint(format=="ics"?RootPrec::SEC:RootPrec::AUTO);
 
 	IsoTime parsed=parse_iso(from_time,cfg.default_tz);
 	EvtFilt filter=parse_ef(kinds);
 	int tz_off=parse_tz(tz);
+	SolLunCal::grid_tz=tz_off;
 
 	EphRead eph(ephem);
+	SolLunCal solver(eph);
 	int cst_year=0,cst_month=0,cst_day=0;
 	utc2cst(parsed.jd_utc,cst_year,cst_month,cst_day);
 	int span=1;
@@ -2777,7 +3156,7 @@ int cmd_next(const std::vector<std::string>&args){
 			years.insert(y);
 		}
 		std::vector<EventRec> all=
-			col_eyrs(eph,years,tz_off,quiet?nullptr:&std::cerr);
+			col_eyrs(solver,years,tz_off,quiet?nullptr:&std::cerr);
 		std::vector<EventRec> filtered=
 			filt_evs(all,filter,parsed.jd_utc,
 					 std::numeric_limits<double>::infinity(),false,true);
@@ -2864,6 +3243,7 @@ int cmd_range(const std::vector<std::string>&args){
 			"range requires --from <time> and --to <time>");
 	}
 	chk_fmt(format,{"json","txt","csv","ics","jsonl"},"range");
+	const PrecHint hint(format=="ics"?RootPrec::SEC:RootPrec::AUTO);
 	IsoTime from_par=parse_iso(from_time,cfg.default_tz);
 	IsoTime to_parsed=parse_iso(to_time,cfg.default_tz);
 	if(to_parsed.jd_utc<from_par.jd_utc){
@@ -2872,6 +3252,7 @@ int cmd_range(const std::vector<std::string>&args){
 
 	EvtFilt filter=parse_ef(kinds);
 	int tz_off=parse_tz(tz);
+	SolLunCal::grid_tz=tz_off;
 	EphRead eph(ephem);
 	std::vector<EventRec> picked=load_evs(eph,from_par.jd_utc,to_parsed.jd_utc,
 										  filter,tz_off,quiet,false);
@@ -3024,6 +3405,7 @@ int cmd_fest(const std::vector<std::string>&args){
 	chk_fmt(format,{"json","txt","csv"},"festival");
 
 	int tz_off=parse_tz(tz);
+	SolLunCal::grid_tz=tz_off;
 	EphRead eph(ephem);
 	std::vector<EventRec> festivals=bld_fest(eph,year,tz_off);
 
@@ -3085,6 +3467,7 @@ int cmd_alm(const std::vector<std::string>&args){
 	int y=0,m=0,d=0;
 	std::tie(y,m,d)=parse_ymd(date_text);
 	int tz_off=parse_tz(tz);
+	SolLunCal::grid_tz=tz_off;
 	double smp_jdutc=greg2jd(y,m,d,12,0,0.0)-UTC8DAY;
 	double day_sutc=cst_midjd(y,m,d);
 	double day_eutc=day_sutc+1.0;
@@ -3193,47 +3576,35 @@ int cmd_alm(const std::vector<std::string>&args){
 
 namespace{
 
-bool parse_spk(const std::string&ephem,double&jd_start,double&jd_end){
-	EphRead reader(ephem);
-	reader.load_kern();
-
-	SPICEINT_CELL(ids,10000);
-	scard_c(0,&ids);
-	spkobj_c(ephem.c_str(),&ids);
-	chk_spice("spkobj_c failed");
-	SpiceInt nids=card_c(&ids);
-	if(nids<=0){
-		return false;
-	}
-
-	double min_et=std::numeric_limits<double>::infinity();
-	double max_et=-std::numeric_limits<double>::infinity();
-
-	for(SpiceInt i=0;i<nids;++i){
-		SpiceInt obj=SPICE_CELL_ELEM_I(&ids,i);
-		SPICEDOUBLE_CELL(cover,400000);
-		scard_c(0,&cover);
-		spkcov_c(ephem.c_str(),obj,&cover);
-		chk_spice("spkcov_c failed");
-		SpiceInt nint=wncard_c(&cover);
-		for(SpiceInt k=0;k<nint;++k){
-			SpiceDouble b=0.0;
-			SpiceDouble e=0.0;
-			wnfetd_c(&cover,k,&b,&e);
-			if(b<min_et){
-				min_et=b;
-			}
-			if(e>max_et){
-				max_et=e;
+bool parse_spk(const std::string&ephem,double&jd_start,double&jd_end,
+			   std::vector<BodyMeta>&bodies){
+	bool has_cov=false;
+	for(const std::string&path : eph_paths(ephem)){
+		std::shared_ptr<const SpkMeta> meta=spk_meta(path);
+		double lo=0.0;
+		double hi=0.0;
+		if(!meta->cover({},lo,hi)){
+			continue;
+		}
+		jd_start=has_cov?std::min(jd_start,lo):lo;
+		jd_end=has_cov?std::max(jd_end,hi):hi;
+		has_cov=true;
+		for(const BodyMeta&bm : meta->bodies){
+			auto it=std::find_if(
+				bodies.begin(),bodies.end(),
+				[&](const BodyMeta&b){ return b.body==bm.body; });
+			if(it==bodies.end()){
+				bodies.push_back(bm);
+				continue;
 			}
+			it->n_seg+=bm.n_seg;
+			it->win.insert(it->win.end(),bm.win.begin(),bm.win.end());
+			std::sort(it->win.begin(),it->win.end());
 		}
 	}
-	if(!std::isfinite(min_et)||!std::isfinite(max_et)||min_et>=max_et){
-		return false;
-	}
-	jd_start=2451545.0+min_et/SEC_DAY;
-	jd_end=2451545.0+max_et/SEC_DAY;
-	return true;
+	std::sort(bodies.begin(),bodies.end(),
+			  [](const BodyMeta&a,const BodyMeta&b){ return a.body<b.body; });
+	return has_cov;
 }
 
 }
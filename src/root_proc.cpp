@@ -0,0 +1,574 @@
+#include "lunar/root_proc.hpp"
+
+#include<algorithm>
+#include<atomic>
+#include<cmath>
+#include<cstdlib>
+#include<cstring>
+#include<filesystem>
+#include<memory>
+#include<mutex>
+#include<new>
+#include<stdexcept>
+#include<thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include<fcntl.h>
+#include<io.h>
+#include<windows.h>
+#else
+#include<cerrno>
+#include<csignal>
+#include<fcntl.h>
+#include<sys/socket.h>
+#include<sys/wait.h>
+#include<unistd.h>
+#endif
+
+#ifdef __linux__
+#include<dirent.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#endif
+
+#include "lunar/calendar.hpp"
+
+namespace fs=std::filesystem;
+
+namespace{
+
+RtReq to_req(const RootTask&task,std::size_t idx){
+	RtReq req;
+	std::memset(&req,0,sizeof(req));
+	req.idx=static_cast<std::uint32_t>(idx);
+	req.op=static_cast<std::int32_t>(task.kind);
+	req.max_iter=task.max_iter;
+	req.target=task.target;
+	req.jd_initial=task.jd_initial;
+	req.eps_days=task.eps_days;
+	return req;
+}
+
+void solve_lost(SolLunCal&self,const std::vector<RootTask>&tasks,
+				const std::vector<char>&lost,std::vector<double>&results,
+				std::vector<std::string>&errors){
+	for(std::size_t idx=0;idx<tasks.size();++idx){
+		if(!lost[idx]){
+			continue;
+		}
+		const RootTask&task=tasks[idx];
+		try{
+			results[idx]=self.newton(task.kind,task.jd_initial,task.target,
+									 task.eps_days,task.max_iter);
+		}catch(const std::exception&ex){
+			errors[idx]=ex.what();
+		}catch(...){
+			errors[idx]="unknown error";
+		}
+		self.task_st[idx]=self.rs;
+		self.task_st[idx].lost=1;
+	}
+}
+
+#ifndef _WIN32
+bool sock_send(int fd,const void*buf,std::size_t n){
+	const char*p=static_cast<const char*>(buf);
+	while(n>0){
+#ifdef MSG_NOSIGNAL
+		ssize_t k=send(fd,p,n,MSG_NOSIGNAL);
+#else
+		ssize_t k=send(fd,p,n,0);
+#endif
+		if(k<0&&errno==EINTR){
+			continue;
+		}
+		if(k<=0){
+			return false;
+		}
+		p+=k;
+		n-=static_cast<std::size_t>(k);
+	}
+	return true;
+}
+#endif
+
+#ifdef __linux__
+void priv_fds(){
+	DIR*dir=opendir("/proc/self/fd");
+	if(!dir){
+		return;
+	}
+	const int dir_fd=dirfd(dir);
+	while(dirent*ent=readdir(dir)){
+		const int fd=std::atoi(ent->d_name);
+		if(ent->d_name[0]<'0'||ent->d_name[0]>'9'||fd<=2||fd==dir_fd){
+			continue;
+		}
+		struct stat st;
+		const int fl=fcntl(fd,F_GETFL);
+		if(fl<0||(fl&O_ACCMODE)!=O_RDONLY||fstat(fd,&st)!=0||
+		   !S_ISREG(st.st_mode)){
+			continue;
+		}
+		char path[4096];
+		const std::string link="/proc/self/fd/"+std::string(ent->d_name);
+		ssize_t len=readlink(link.c_str(),path,sizeof(path)-1);
+		if(len<=0){
+			continue;
+		}
+		path[len]='\0';
+		const int nfd=open(path,O_RDONLY);
+		if(nfd<0){
+			continue;
+		}
+		const off_t pos=lseek(fd,0,SEEK_CUR);
+		const int fd_fl=fcntl(fd,F_GETFD);
+		if(dup2(nfd,fd)==fd){
+			fcntl(fd,F_SETFD,fd_fl);
+			if(pos>0){
+				lseek(fd,pos,SEEK_SET);
+			}
+		}
+		close(nfd);
+	}
+	closedir(dir);
+}
+#endif
+
+} // namespace
+
+std::string quote_arg(const std::string&arg){
+	std::string q="\"";
+	for(char c : arg){
+		if(c=='"'){
+			q+="\\\"";
+		}else{
+			q.push_back(c);
+		}
+	}
+	q.push_back('"');
+	return q;
+}
+
+std::string exe_path(){
+#ifdef _WIN32
+	char buf[4096];
+	DWORD len=GetModuleFileNameA(nullptr,buf,static_cast<DWORD>(sizeof(buf)));
+	if(len==0||len>=sizeof(buf)){
+		throw std::runtime_error("failed to query executable path");
+	}
+	return std::string(buf,len);
+#else
+	char buf[4096];
+	ssize_t len=readlink("/proc/self/exe",buf,sizeof(buf)-1);
+	if(len<=0){
+		throw std::runtime_error("failed to query executable path");
+	}
+	buf[len]='\0';
+	return std::string(buf);
+#endif
+}
+
+std::vector<std::string> wk_args(const SolLunCal&self){
+	std::vector<std::string> args;
+	if(self.eph.back!=EphBack::SPICE){
+		args.push_back("--ephem");
+		args.push_back(back_name(self.eph.back));
+	}
+	if(self.use_cache){
+		args.push_back("--ephem-cache");
+		args.push_back("1");
+	}
+	if(self.app.fc_on){
+		args.push_back("--frame-cache");
+		args.push_back("1");
+	}
+	if(self.app.lt!=LtMode::ITER){
+		args.push_back("--light-time");
+		args.push_back(lt_name(self.app.lt));
+	}
+	return args;
+}
+
+bool rt_read(int fd,void*buf,std::size_t n){
+	char*p=static_cast<char*>(buf);
+	while(n>0){
+#ifdef _WIN32
+		int k=_read(fd,p,static_cast<unsigned int>(n));
+#else
+		ssize_t k=read(fd,p,n);
+		if(k<0&&errno==EINTR){
+			continue;
+		}
+#endif
+		if(k<=0){
+			return false;
+		}
+		p+=k;
+		n-=static_cast<std::size_t>(k);
+	}
+	return true;
+}
+
+bool rt_write(int fd,const void*buf,std::size_t n){
+	const char*p=static_cast<const char*>(buf);
+	while(n>0){
+#ifdef _WIN32
+		int k=_write(fd,p,static_cast<unsigned int>(n));
+#else
+		ssize_t k=write(fd,p,n);
+		if(k<0&&errno==EINTR){
+			continue;
+		}
+#endif
+		if(k<=0){
+			return false;
+		}
+		p+=k;
+		n-=static_cast<std::size_t>(k);
+	}
+	return true;
+}
+
+int rt_out_fd(){
+#ifdef _WIN32
+	_setmode(0,_O_BINARY);
+	int fd=_dup(1);
+	_dup2(2,1);
+	_setmode(fd,_O_BINARY);
+	return fd;
+#else
+	int fd=dup(1);
+	dup2(2,1);
+	return fd;
+#endif
+}
+
+RootProc::RootProc(const std::string&exe,const std::vector<std::string>&args){
+#ifdef _WIN32
+	SECURITY_ATTRIBUTES sa;
+	std::memset(&sa,0,sizeof(sa));
+	sa.nLength=sizeof(sa);
+	sa.bInheritHandle=TRUE;
+	HANDLE in_r=nullptr,in_w=nullptr,out_r=nullptr,out_w=nullptr;
+	if(!CreatePipe(&in_r,&in_w,&sa,1<<16)){
+		throw std::runtime_error("failed to create root worker pipe");
+	}
+	if(!CreatePipe(&out_r,&out_w,&sa,1<<16)){
+		CloseHandle(in_r);
+		CloseHandle(in_w);
+		throw std::runtime_error("failed to create root worker pipe");
+	}
+	SetHandleInformation(in_w,HANDLE_FLAG_INHERIT,0);
+	SetHandleInformation(out_r,HANDLE_FLAG_INHERIT,0);
+
+	STARTUPINFOA si;
+	PROCESS_INFORMATION pi;
+	std::memset(&si,0,sizeof(si));
+	std::memset(&pi,0,sizeof(pi));
+	si.cb=sizeof(si);
+	si.dwFlags=STARTF_USESTDHANDLES;
+	si.hStdInput=in_r;
+	si.hStdOutput=out_w;
+	si.hStdError=GetStdHandle(STD_ERROR_HANDLE);
+
+	std::string cmd=quote_arg(exe);
+	for(const std::string&a : args){
+		cmd+=" "+quote_arg(a);
+	}
+	std::vector<char> cmd_buf(cmd.begin(),cmd.end());
+	cmd_buf.push_back('\0');
+	BOOL ok=CreateProcessA(exe.c_str(),cmd_buf.data(),nullptr,nullptr,TRUE,
+						   CREATE_NO_WINDOW,nullptr,nullptr,&si,&pi);
+	CloseHandle(in_r);
+	CloseHandle(out_w);
+	if(!ok){
+		CloseHandle(in_w);
+		CloseHandle(out_r);
+		throw std::runtime_error("failed to start root worker process");
+	}
+	CloseHandle(pi.hThread);
+	proc_=pi.hProcess;
+	h_in_=in_w;
+	h_out_=out_r;
+#else
+	int sv[2];
+	if(socketpair(AF_UNIX,SOCK_STREAM,0,sv)!=0){
+		throw std::runtime_error("failed to create root worker socket");
+	}
+	fcntl(sv[0],F_SETFD,FD_CLOEXEC);
+	fcntl(sv[1],F_SETFD,FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+	int one=1;
+	setsockopt(sv[0],SOL_SOCKET,SO_NOSIGPIPE,&one,sizeof(one));
+#endif
+	std::vector<char*> argv;
+	argv.push_back(const_cast<char*>(exe.c_str()));
+	for(const std::string&a : args){
+		argv.push_back(const_cast<char*>(a.c_str()));
+	}
+	argv.push_back(nullptr);
+	pid_t pid=fork();
+	if(pid<0){
+		close(sv[0]);
+		close(sv[1]);
+		throw std::runtime_error("failed to start root worker process");
+	}
+	if(pid==0){
+		dup2(sv[1],0);
+		dup2(sv[1],1);
+		execv(exe.c_str(),argv.data());
+		_exit(127);
+	}
+	close(sv[1]);
+	pid_=pid;
+	fd_=sv[0];
+#endif
+}
+
+RootProc::~RootProc(){
+#ifdef _WIN32
+	CloseHandle(h_in_);
+	CloseHandle(h_out_);
+	TerminateProcess(proc_,1);
+	WaitForSingleObject(proc_,INFINITE);
+	CloseHandle(proc_);
+#else
+	close(fd_);
+	kill(pid_,SIGKILL);
+	waitpid(pid_,nullptr,0);
+#endif
+}
+
+bool RootProc::call(const RtReq*req,RtRes*res,std::size_t n){
+#ifdef _WIN32
+	const char*p=reinterpret_cast<const char*>(req);
+	std::size_t left=n*sizeof(RtReq);
+	while(left>0){
+		DWORD k=0;
+		if(!WriteFile(h_in_,p,static_cast<DWORD>(left),&k,nullptr)||k==0){
+			return false;
+		}
+		p+=k;
+		left-=k;
+	}
+	char*q=reinterpret_cast<char*>(res);
+	left=n*sizeof(RtRes);
+	while(left>0){
+		DWORD k=0;
+		if(!ReadFile(h_out_,q,static_cast<DWORD>(left),&k,nullptr)||k==0){
+			return false;
+		}
+		q+=k;
+		left-=k;
+	}
+#else
+	if(!sock_send(fd_,req,n*sizeof(RtReq))||
+	   !rt_read(fd_,res,n*sizeof(RtRes))){
+		return false;
+	}
+#endif
+	for(std::size_t i=0;i<n;++i){
+		if(res[i].idx!=req[i].idx){
+			return false;
+		}
+	}
+	return true;
+}
+
+void run_pipe(SolLunCal&self,const std::vector<RootTask>&tasks,
+			  std::vector<double>&results,std::vector<std::string>&errors){
+	static std::mutex mtx;
+	static std::string key;
+	static std::vector<std::unique_ptr<RootProc>> procs;
+
+	const std::string exe=exe_path();
+	std::vector<std::string> args=wk_args(self);
+	args.push_back("__root_pipe");
+	args.push_back(fs::absolute(self.eph.filepath).string());
+	std::string cur=exe;
+	for(const std::string&a : args){
+		cur+='\n'+a;
+	}
+
+	unsigned int hc=std::thread::hardware_concurrency();
+	std::size_t n_wk=hc==0?4:static_cast<std::size_t>(hc);
+	n_wk=std::min({n_wk,kMaxWork,tasks.size()});
+	n_wk=std::max<std::size_t>(n_wk,1);
+
+	RtReq span;
+	std::memset(&span,0,sizeof(span));
+	span.op=RT_SPAN;
+	span.jd_initial=self.span_lo;
+	span.target=self.span_hi;
+	const bool has_span=self.eph.cache&&std::isfinite(self.span_lo);
+
+	std::lock_guard<std::mutex> lock(mtx);
+	if(cur!=key){
+		procs.clear();
+		key=cur;
+	}
+	while(procs.size()<n_wk){
+		procs.emplace_back(new RootProc(exe,args));
+	}
+
+	const std::size_t chunk=std::max<std::size_t>(
+		1,std::min<std::size_t>(kChunk,tasks.size()/(n_wk*4)));
+	std::vector<char> lost(tasks.size(),1);
+	std::atomic<std::size_t> cursor{0};
+	std::vector<std::thread> thr;
+	for(std::size_t i=0;i<n_wk;++i){
+		thr.emplace_back([&,i](){
+			std::unique_ptr<RootProc>&proc=procs[i];
+			int n_fail=0;
+			bool primed=!has_span;
+			RtReq rq[kChunk];
+			RtRes rs[kChunk];
+			auto exec=[&](std::size_t n){
+				while(n_fail<2){
+					try{
+						if(!proc){
+							proc.reset(new RootProc(exe,args));
+							primed=!has_span;
+						}
+					}catch(...){
+						++n_fail;
+						continue;
+					}
+					RtRes sr;
+					if(!primed&&proc->call(&span,&sr,1)&&sr.ok){
+						primed=true;
+					}
+					if(primed&&proc->call(rq,rs,n)){
+						return true;
+					}
+					proc.reset();
+					++n_fail;
+				}
+				return false;
+			};
+			std::size_t lo=0;
+			while((lo=cursor.fetch_add(chunk))<tasks.size()){
+				const std::size_t n=std::min(chunk,tasks.size()-lo);
+				for(std::size_t k=0;k<n;++k){
+					rq[k]=to_req(tasks[lo+k],lo+k);
+				}
+				if(!exec(n)){
+					break;
+				}
+				for(std::size_t k=0;k<n;++k){
+					const std::size_t idx=lo+k;
+					lost[idx]=0;
+					self.task_st[idx]=rs[k].st;
+					if(rs[k].ok){
+						results[idx]=rs[k].root;
+					}else{
+						errors[idx]=std::string(
+							rs[k].err,strnlen(rs[k].err,sizeof(rs[k].err)));
+					}
+				}
+			}
+		});
+	}
+	for(auto&th : thr){
+		th.join();
+	}
+	solve_lost(self,tasks,lost,results,errors);
+}
+
+void run_fork(SolLunCal&self,const std::vector<RootTask>&tasks,
+			  std::vector<double>&results,std::vector<std::string>&errors){
+#ifdef __linux__
+	static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+				  "shared root cursor");
+	const std::size_t n=tasks.size();
+	const std::size_t bytes=sizeof(RtRes)*(n+1);
+	void*mem=MAP_FAILED;
+	int fd=memfd_create("lunar_roots",MFD_CLOEXEC);
+	if(fd>=0){
+		if(ftruncate(fd,static_cast<off_t>(bytes))==0){
+			mem=mmap(nullptr,bytes,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+		}
+		close(fd);
+	}
+	if(mem==MAP_FAILED){
+		throw std::runtime_error("failed to map root result buffer");
+	}
+	auto*next=new(mem) std::atomic<std::uint64_t>(0);
+	RtRes*slot=static_cast<RtRes*>(mem)+1;
+	for(std::size_t i=0;i<n;++i){
+		slot[i].idx=static_cast<std::uint32_t>(i);
+		slot[i].ok=-1;
+	}
+
+	unsigned int hc=std::thread::hardware_concurrency();
+	std::size_t n_wk=hc==0?4:static_cast<std::size_t>(hc);
+	n_wk=std::max<std::size_t>(std::min({n_wk,kMaxWork,n}),1);
+	const std::size_t chunk=std::max<std::size_t>(
+		1,std::min<std::size_t>(kChunk,n/(n_wk*4)));
+
+	std::vector<pid_t> pids;
+	for(std::size_t w=0;w<n_wk;++w){
+		pid_t pid=fork();
+		if(pid==0){
+			priv_fds();
+			std::uint64_t lo=0;
+			while((lo=next->fetch_add(chunk))<n){
+				const std::size_t hi=std::min<std::size_t>(lo+chunk,n);
+				for(std::size_t i=lo;i<hi;++i){
+					const RootTask&task=tasks[i];
+					RtRes&res=slot[i];
+					try{
+						res.root=self.newton(task.kind,task.jd_initial,
+											 task.target,task.eps_days,
+											 task.max_iter);
+						res.ok=1;
+					}catch(const std::exception&ex){
+						std::strncpy(res.err,ex.what(),sizeof(res.err)-1);
+						res.ok=0;
+					}catch(...){
+						std::strncpy(res.err,"unknown error",
+									 sizeof(res.err)-1);
+						res.ok=0;
+					}
+					res.st=self.rs;
+				}
+			}
+			_exit(0);
+		}
+		if(pid>0){
+			pids.push_back(pid);
+		}
+	}
+	for(pid_t pid : pids){
+		while(waitpid(pid,nullptr,0)<0&&errno==EINTR){
+		}
+	}
+
+	std::vector<char> lost(n,0);
+	for(std::size_t i=0;i<n;++i){
+		if(slot[i].ok>=0){
+			self.task_st[i]=slot[i].st;
+		}
+		if(slot[i].ok==1){
+			results[i]=slot[i].root;
+		}else if(slot[i].ok==0){
+			errors[i]=std::string(slot[i].err,
+								  strnlen(slot[i].err,sizeof(slot[i].err)));
+		}else{
+			lost[i]=1;
+		}
+	}
+	munmap(mem,bytes);
+	solve_lost(self,tasks,lost,results,errors);
+#else
+	(void)self;
+	(void)tasks;
+	(void)results;
+	(void)errors;
+	throw std::runtime_error("fork root mode needs Linux");
+#endif
+}
@@ -2,20 +2,395 @@
 
 #include "lunar/calendar.hpp"
 
+#include<algorithm>
+#include<cmath>
 #include<exception>
+#include<iomanip>
+#include<ostream>
+#include<stdexcept>
+#include<thread>
 
-void run_wkr(RootCtx*ctx){
-	std::size_t idx;
-	while((idx=ctx->cursor->fetch_add(1))<ctx->tasks->size()){
-		const auto&task=ctx->tasks->at(idx);
-		try{
-			double root=ctx->self->newton(task.kind,task.jd_initial,task.target,
-										  task.eps_days,task.max_iter);
-			ctx->results->at(idx)=root;
-		}catch(const std::exception&ex){
-			ctx->errors->at(idx)=ex.what();
-		}catch(...){
-			ctx->errors->at(idx)="unknown error";
+#include "lunar/js_writer.hpp"
+#include "lunar/time_scale.hpp"
+
+RootMode parse_mode(const std::string&name){
+	if(name=="auto"){
+		return RootMode::AUTO;
+	}
+	if(name=="serial"){
+		return RootMode::SERIAL;
+	}
+	if(name=="lockstep"){
+		return RootMode::LOCKSTEP;
+	}
+	if(name=="thread"){
+		return RootMode::THREAD;
+	}
+	if(name=="pipe"){
+		return RootMode::PIPE;
+	}
+	if(name=="fork"){
+		return RootMode::FORK;
+	}
+	if(name=="batch"){
+		return RootMode::BATCH;
+	}
+	throw std::invalid_argument(
+		"--root-mode must be auto|serial|lockstep|thread|pipe|fork|batch");
+}
+
+std::string mode_name(RootMode mode){
+	switch(mode){
+	case RootMode::SERIAL:
+		return "serial";
+	case RootMode::LOCKSTEP:
+		return "lockstep";
+	case RootMode::THREAD:
+		return "thread";
+	case RootMode::PIPE:
+		return "pipe";
+	case RootMode::FORK:
+		return "fork";
+	case RootMode::BATCH:
+		return "batch";
+	default:
+		return "auto";
+	}
+}
+
+RootPrec parse_prec(const std::string&name){
+	if(name=="auto"){
+		return RootPrec::AUTO;
+	}
+	if(name=="ms"){
+		return RootPrec::MS;
+	}
+	if(name=="s"){
+		return RootPrec::SEC;
+	}
+	if(name=="min"){
+		return RootPrec::MIN;
+	}
+	throw std::invalid_argument("--precision must be auto|ms|s|min");
+}
+
+std::string prec_name(RootPrec prec){
+	switch(prec){
+	case RootPrec::MS:
+		return "ms";
+	case RootPrec::SEC:
+		return "s";
+	case RootPrec::MIN:
+		return "min";
+	default:
+		return "auto";
+	}
+}
+
+double prec_eps(RootPrec prec){
+	switch(prec){
+	case RootPrec::SEC:
+		return 1e-7;
+	case RootPrec::MIN:
+		return 1e-4;
+	default:
+		return 1e-8;
+	}
+}
+
+double prec_grid(RootPrec prec){
+	switch(prec){
+	case RootPrec::SEC:
+		return 1.0/86400.0;
+	case RootPrec::MIN:
+		return 1.0/96.0;
+	default:
+		return 0.0;
+	}
+}
+
+bool near_grid(double jd_tdb,double grid,double margin,double off){
+	if(grid<=0.0){
+		return false;
+	}
+	const double x=(TimeScale::tdb_to_utc(jd_tdb)+off-0.5)/grid;
+	const double fr=x-std::floor(x);
+	return std::min(fr,1.0-fr)*grid<margin;
+}
+
+RootKind parse_kind(const std::string&name){
+	if(name=="solar"){
+		return RootKind::SOLAR;
+	}
+	if(name=="lunar"){
+		return RootKind::LUNAR;
+	}
+	throw std::invalid_argument("unknown root kind: "+name);
+}
+
+std::string kind_name(RootKind kind){
+	return kind==RootKind::SOLAR?"solar":"lunar";
+}
+
+void RtSum::add(const RootStat&st,bool ok){
+	++n_root;
+	n_fail+=!ok;
+	n_eval+=st.n_eval;
+	n_iter+=st.n_iter;
+	n_back+=st.n_back;
+	n_scan+=st.n_scan;
+	n_eph+=st.n_eph;
+	n_lost+=st.lost;
+	n_esc+=st.esc;
+	max_iter=std::max<std::size_t>(max_iter,st.n_iter);
+	max_eval=std::max<std::size_t>(max_eval,st.n_eval);
+}
+
+void RtSum::add(const RtSum&o){
+	n_root+=o.n_root;
+	n_fail+=o.n_fail;
+	n_eval+=o.n_eval;
+	n_iter+=o.n_iter;
+	n_back+=o.n_back;
+	n_scan+=o.n_scan;
+	n_eph+=o.n_eph;
+	n_lost+=o.n_lost;
+	n_esc+=o.n_esc;
+	max_iter=std::max(max_iter,o.max_iter);
+	max_eval=std::max(max_eval,o.max_eval);
+	ms+=o.ms;
+}
+
+RtStats&rt_stats(){
+	static RtStats st;
+	return st;
+}
+
+void rt_reset(){
+	RtStats&st=rt_stats();
+	std::lock_guard<std::mutex> lock(st.mtx);
+	st.all=RtSum{};
+	st.n_batch=0;
+	st.n_single=0;
+	st.n_fallback=0;
+	st.prec=RootPrec::AUTO;
+	st.modes.clear();
+	st.years.clear();
+}
+
+namespace{
+
+void put_sum(JsonWriter&w,const RtSum&s){
+	const double n=s.n_root>0?static_cast<double>(s.n_root):1.0;
+	w.key("roots");
+	w.value(static_cast<double>(s.n_root));
+	w.key("failed");
+	w.value(static_cast<double>(s.n_fail));
+	w.key("evals");
+	w.value(static_cast<double>(s.n_eval));
+	w.key("iters");
+	w.value(static_cast<double>(s.n_iter));
+	w.key("backtracks");
+	w.value(static_cast<double>(s.n_back));
+	w.key("scans");
+	w.value(static_cast<double>(s.n_scan));
+	w.key("lost");
+	w.value(static_cast<double>(s.n_lost));
+	w.key("escalated");
+	w.value(static_cast<double>(s.n_esc));
+	w.key("eph_calls");
+	w.value(static_cast<double>(s.n_eph));
+	w.key("evals_per_root");
+	w.value(s.n_eval/n);
+	w.key("iters_per_root");
+	w.value(s.n_iter/n);
+	w.key("max_iters");
+	w.value(static_cast<double>(s.max_iter));
+	w.key("max_evals");
+	w.value(static_cast<double>(s.max_eval));
+	w.key("ms");
+	w.value(s.ms);
+}
+
+void put_row(std::ostream&os,const std::string&scope,const RtSum&s){
+	const double n=s.n_root>0?static_cast<double>(s.n_root):1.0;
+	os<<scope<<"\t"<<s.n_root<<"\t"<<s.n_fail<<"\t"<<s.n_eval<<"\t"
+	  <<s.n_iter<<"\t"<<s.n_back<<"\t"<<s.n_scan<<"\t"<<s.n_lost<<"\t"
+	  <<s.n_esc<<"\t"<<s.n_eph<<"\t"<<std::setprecision(4)<<s.n_eval/n
+	  <<"\t"<<s.n_iter/n<<"\t"<<s.max_iter<<"\t"<<s.max_eval<<"\t"
+	  <<std::setprecision(6)<<s.ms<<"\n";
+}
+
+}
+
+void put_stats(std::ostream&os,const std::string&format){
+	RtStats&st=rt_stats();
+	std::lock_guard<std::mutex> lock(st.mtx);
+	const RootPrec prec=
+		st.prec==RootPrec::AUTO?SolLunCal::def_prec:st.prec;
+	if(format=="json"){
+		JsonWriter w(os,true);
+		w.obj_begin();
+		w.key("type");
+		w.value("stats");
+		w.key("precision");
+		w.value(prec_name(prec));
+		w.key("batches");
+		w.value(static_cast<double>(st.n_batch));
+		w.key("single");
+		w.value(static_cast<double>(st.n_single));
+		w.key("fallbacks");
+		w.value(static_cast<double>(st.n_fallback));
+		w.key("modes");
+		w.obj_begin();
+		for(const auto&kv : st.modes){
+			w.key(kv.first);
+			w.value(static_cast<double>(kv.second));
+		}
+		w.obj_end();
+		w.key("all");
+		w.obj_begin();
+		put_sum(w,st.all);
+		w.obj_end();
+		w.key("years");
+		w.arr_begin();
+		for(const auto&kv : st.years){
+			w.obj_begin();
+			w.key("year");
+			w.value(kv.first);
+			put_sum(w,kv.second);
+			w.obj_end();
+		}
+		w.arr_end();
+		w.obj_end();
+		os<<"\n";
+		return;
+	}
+	os<<"tool=lunar format=txt type=stats precision="
+	  <<prec_name(prec)<<" batches="<<st.n_batch
+	  <<" single="<<st.n_single<<" fallbacks="<<st.n_fallback<<" modes=";
+	bool first=true;
+	for(const auto&kv : st.modes){
+		os<<(first?"":",")<<kv.first<<":"<<kv.second;
+		first=false;
+	}
+	os<<(first?"-\n":"\n");
+	os<<"scope\troots\tfailed\tevals\titers\tbacktracks\tscans\tlost\t"
+		"escalated\teph_calls\tevals_per_root\titers_per_root\tmax_iters\t"
+		"max_evals\tms\n";
+	put_row(os,"all",st.all);
+	for(const auto&kv : st.years){
+		put_row(os,std::to_string(kv.first),kv.second);
+	}
+}
+
+void run_wkr(RootCtx*ctx,std::size_t slot,std::size_t idx){
+	const auto&task=ctx->tasks->at(idx);
+	SolLunCal*sol=ctx->slots.at(slot);
+	try{
+		double root=sol->newton(task.kind,task.jd_initial,task.target,
+								task.eps_days,task.max_iter);
+		ctx->results->at(idx)=root;
+	}catch(const std::exception&ex){
+		ctx->errors->at(idx)=ex.what();
+	}catch(...){
+		ctx->errors->at(idx)="unknown error";
+	}
+	ctx->stats->at(idx)=sol->rs;
+}
+
+RootPool&RootPool::get(){
+	static RootPool*pool=[](){
+		unsigned int hc=std::thread::hardware_concurrency();
+		return new RootPool(hc==0?4:static_cast<std::size_t>(hc));
+	}();
+	return *pool;
+}
+
+RootPool::RootPool(std::size_t n_slot)
+	: n_slot_(std::max<std::size_t>(1,n_slot)),rng_(new Range[n_slot_]){
+	for(std::size_t s=1;s<n_slot_;++s){
+		std::thread(&RootPool::loop,this,s).detach();
+	}
+}
+
+void RootPool::run(std::size_t n,const Job&job){
+	std::lock_guard<std::mutex> run_lk(run_mtx_);
+	const std::size_t per=n/n_slot_;
+	const std::size_t extra=n%n_slot_;
+	std::size_t lo=0;
+	for(std::size_t s=0;s<n_slot_;++s){
+		const std::size_t cnt=per+(s<extra?1:0);
+		std::lock_guard<std::mutex> lk(rng_[s].mtx);
+		rng_[s].lo=lo;
+		rng_[s].hi=lo+cnt;
+		lo+=cnt;
+	}
+	{
+		std::lock_guard<std::mutex> lk(mtx_);
+		job_=&job;
+		n_busy_=n_slot_-1;
+		++gen_;
+	}
+	cv_go_.notify_all();
+	drain(0);
+	std::unique_lock<std::mutex> lk(mtx_);
+	cv_done_.wait(lk,[&](){ return n_busy_==0; });
+	job_=nullptr;
+}
+
+void RootPool::loop(std::size_t slot){
+	unsigned long long seen=0;
+	std::unique_lock<std::mutex> lk(mtx_);
+	for(;;){
+		cv_go_.wait(lk,[&](){ return gen_!=seen; });
+		seen=gen_;
+		lk.unlock();
+		drain(slot);
+		lk.lock();
+		if(--n_busy_==0){
+			cv_done_.notify_all();
+		}
+	}
+}
+
+void RootPool::drain(std::size_t slot){
+	std::size_t idx=0;
+	while(next(slot,idx)){
+		(*job_)(slot,idx);
+	}
+}
+
+bool RootPool::next(std::size_t slot,std::size_t&idx){
+	{
+		Range&own=rng_[slot];
+		std::lock_guard<std::mutex> lk(own.mtx);
+		if(own.lo<own.hi){
+			idx=own.lo++;
+			return true;
+		}
+	}
+	for(std::size_t k=1;k<n_slot_;++k){
+		Range&vic=rng_[(slot+k)%n_slot_];
+		std::size_t lo=0;
+		std::size_t hi=0;
+		{
+			std::lock_guard<std::mutex> lk(vic.mtx);
+			if(vic.lo>=vic.hi){
+				continue;
+			}
+			lo=vic.lo+(vic.hi-vic.lo)/2;
+			hi=vic.hi;
+			vic.hi=lo;
+		}
+		idx=lo;
+		if(lo+1<hi){
+			Range&own=rng_[slot];
+			std::lock_guard<std::mutex> lk(own.mtx);
+			own.lo=lo+1;
+			own.hi=hi;
 		}
+		return true;
 	}
+	return false;
 }
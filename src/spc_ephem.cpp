@@ -1,7 +1,9 @@
 #include "lunar/spc_ephem.hpp"
 
+#include<algorithm>
 #include<filesystem>
 #include<mutex>
+#include<numeric>
 #include<sstream>
 #include<stdexcept>
 #include<vector>
@@ -10,14 +12,44 @@ extern "C"{
 #include "SpiceUsr.h"
 }
 
+#include "lunar/ana_ephem.hpp"
+
 namespace fs=std::filesystem;
 
-std::set<std::string> EphRead::load_paths;
-std::set<std::string> EphRead::val_paths;
+namespace{
+
+[[noreturn]] void fit_only(const std::string&path){
+	throw std::runtime_error(
+		"fit file provides apparent longitudes only, not states: "+path);
+}
+
+} // namespace
+
+EphBack EphRead::def_back=EphBack::SPICE;
+
+EphBack parse_back(const std::string&name){
+	if(name=="spice"){
+		return EphBack::SPICE;
+	}
+	if(name=="native"){
+		return EphBack::NATIVE;
+	}
+	if(name=="analytic"){
+		return EphBack::ANALYTIC;
+	}
+	throw std::invalid_argument("--ephem must be spice|native|analytic");
+}
+
+std::string back_name(EphBack back){
+	if(back==EphBack::ANALYTIC){
+		return "analytic";
+	}
+	return back==EphBack::NATIVE?"native":"spice";
+}
 
-EphRead::EphRead(const std::string&path){
+EphRead::EphRead(const std::string&path,EphBack mode) : back(mode){
 	filepath=path;
-	if(filepath.empty()){
+	if(filepath.empty()&&back!=EphBack::ANALYTIC){
 		throw std::runtime_error("ephemeris path is empty");
 	}
 	SSB=0;
@@ -32,44 +64,50 @@ EphRead::EphRead(const std::string&path){
 	id_name[EARTH]="EARTH";
 	id_name[MOON]="MOON";
 
-	cfg_spice();
+	if(back==EphBack::SPICE){
+		cfg_spice();
+	}
 	load_kern();
 }
 
 void EphRead::load_kern(){
-	cfg_spice();
-
-	if(!fs::exists(filepath)){
-		throw std::runtime_error("ephemeris file not found: "+filepath);
+	kern_ok=false;
+	if(back==EphBack::ANALYTIC){
+		kern_ok=true;
+		return;
 	}
 
-	std::error_code ec;
-	auto fsize=fs::file_size(filepath,ec);
-	if(ec||fsize==0){
-		throw std::runtime_error("ephemeris file is not readable or empty: "+
-								 filepath);
+	const std::vector<std::string> paths=eph_paths(filepath);
+	for(const std::string&path : paths){
+		if(!fs::exists(path)){
+			throw std::runtime_error("ephemeris file not found: "+path);
+		}
+		std::error_code ec;
+		auto fsize=fs::file_size(path,ec);
+		if(ec||fsize==0){
+			throw std::runtime_error(
+				"ephemeris file is not readable or empty: "+path);
+		}
 	}
 
-	bool need_load=false;
-	SpiceInt count=0;
-	try{
-		ktotal_c("SPK",&count);
-		if(count==0){
-			need_load=true;
+	if(lfit||(paths.size()==1&&LonFit::is_fit(filepath))){
+		if(!lfit){
+			lfit=lfit_open(filepath);
 		}
-	}catch(...){
-		need_load=true;
+		kern_ok=true;
+		return;
 	}
-	if(load_paths.find(filepath)==load_paths.end()){
-		need_load=true;
+
+	if(back==EphBack::SPICE){
+		cfg_spice();
 	}
-	if(need_load){
-		furnsh_c(filepath.c_str());
-		chk_spice("Failed to load ephemeris kernel");
-		load_paths.insert(filepath);
+	if(!reg){
+		reg=EphReg::open(filepath,back);
 	}
-
-	val_kern();
+	if(back==EphBack::SPICE){
+		val_kern();
+	}
+	kern_ok=true;
 }
 
 std::string EphRead::to_name(int code) const{
@@ -90,28 +128,186 @@ void EphRead::val_kern(){
 		throw std::runtime_error(
 			"No SPK kernels are loaded; expected ephemeris "+filepath);
 	}
-	val_paths.insert(filepath);
 }
 
 double EphRead::et_fromjd(double jd_tdb){ return (jd_tdb-2451545.0)*SEC_DAY; }
 
 std::pair<Vec3,Vec3> EphRead::get_state(int target,int observer,double jd_tdb){
-	load_kern();
+	if(!kern_ok){
+		load_kern();
+	}
+	++n_call;
+	Vec3 c_pos,c_vel;
+	if(cache&&cache->state(target,observer,jd_tdb,c_pos,c_vel)){
+		return {c_pos,c_vel};
+	}
+	if(lfit){
+		fit_only(filepath);
+	}
+	if(back==EphBack::ANALYTIC){
+		AnalyticEphem::state(target,observer,jd_tdb,c_pos,c_vel);
+		return {c_pos,c_vel};
+	}
 	double et=et_fromjd(jd_tdb);
-	std::string tname=to_name(target);
-	std::string oname=to_name(observer);
+	if(back==EphBack::NATIVE){
+		double st[6];
+		reg->spk_at(jd_tdb).state(target,observer,et,st);
+		Vec3 pos(st[0]/AU_KM,st[1]/AU_KM,st[2]/AU_KM);
+		Vec3 vel(st[3]*(SEC_DAY/AU_KM),st[4]*(SEC_DAY/AU_KM),
+				 st[5]*(SEC_DAY/AU_KM));
+		return {pos,vel};
+	}
 	SpiceDouble state[6];
 	SpiceDouble lt;
-	spkezr_c(tname.c_str(),et,"J2000","NONE",oname.c_str(),state,&lt);
-	chk_spice("spkezr_c failed for target "+tname+" observer "+oname);
+	spkgeo_c(target,et,"J2000",observer,state,&lt);
+	if(failed_c()){
+		chk_spice("spkgeo_c failed for target "+std::to_string(target)+
+				  " observer "+std::to_string(observer));
+	}
 	Vec3 pos(state[0]/AU_KM,state[1]/AU_KM,state[2]/AU_KM);
 	Vec3 vel(state[3]*(SEC_DAY/AU_KM),state[4]*(SEC_DAY/AU_KM),
 			 state[5]*(SEC_DAY/AU_KM));
 	return {pos,vel};
 }
 
+void StateBuf::resize(std::size_t n){
+	x.resize(n);
+	y.resize(n);
+	z.resize(n);
+	vx.resize(n);
+	vy.resize(n);
+	vz.resize(n);
+}
+
+void EphRead::get_states(int target,int observer,const double*jd_tdb,
+						 std::size_t n,StateBuf&out){
+	if(!kern_ok){
+		load_kern();
+	}
+	++n_call;
+	if(lfit){
+		fit_only(filepath);
+	}
+	out.resize(n);
+	if(n==0){
+		return;
+	}
+	std::vector<std::size_t> ord(n);
+	std::iota(ord.begin(),ord.end(),std::size_t(0));
+	if(!std::is_sorted(jd_tdb,jd_tdb+n)){
+		std::stable_sort(ord.begin(),ord.end(),[&](std::size_t a,std::size_t b){
+			return jd_tdb[a]<jd_tdb[b];
+		});
+	}
+	if(cache&&cache->covers(jd_tdb[ord[0]],jd_tdb[ord[n-1]])){
+		Vec3 p,v;
+		bool hit=true;
+		for(std::size_t i=0;i<n&&hit;++i){
+			hit=cache->state(target,observer,jd_tdb[i],p,v);
+			out.x[i]=p.x;
+			out.y[i]=p.y;
+			out.z[i]=p.z;
+			out.vx[i]=v.x;
+			out.vy[i]=v.y;
+			out.vz[i]=v.z;
+		}
+		if(hit){
+			return;
+		}
+	}
+	if(back==EphBack::ANALYTIC){
+		Vec3 p,v;
+		for(std::size_t i=0;i<n;++i){
+			AnalyticEphem::state(target,observer,jd_tdb[i],p,v);
+			out.x[i]=p.x;
+			out.y[i]=p.y;
+			out.z[i]=p.z;
+			out.vx[i]=v.x;
+			out.vy[i]=v.y;
+			out.vz[i]=v.z;
+		}
+		return;
+	}
+	std::vector<double> et(n);
+	for(std::size_t k=0;k<n;++k){
+		et[k]=et_fromjd(jd_tdb[ord[k]]);
+	}
+	std::vector<double> st(6*n);
+	double(*sv)[6]=reinterpret_cast<double(*)[6]>(st.data());
+	if(back==EphBack::NATIVE){
+		for(std::size_t k=0;k<n;){
+			const std::size_t kern=reg->find(jd_tdb[ord[k]]);
+			std::size_t end=k+1;
+			while(end<n&&reg->find(jd_tdb[ord[end]])==kern){
+				++end;
+			}
+			reg->kerns()[kern].spk->state_n(target,observer,et.data()+k,end-k,
+											sv+k);
+			k=end;
+		}
+	}else{
+		for(std::size_t k=0;k<n;++k){
+			SpiceDouble lt;
+			spkgeo_c(target,et[k],"J2000",observer,sv[k],&lt);
+			if(failed_c()){
+				chk_spice("spkgeo_c failed for target "+std::to_string(target)+
+						  " observer "+std::to_string(observer));
+			}
+		}
+	}
+	for(std::size_t k=0;k<n;++k){
+		const std::size_t i=ord[k];
+		out.x[i]=sv[k][0]/AU_KM;
+		out.y[i]=sv[k][1]/AU_KM;
+		out.z[i]=sv[k][2]/AU_KM;
+		out.vx[i]=sv[k][3]*(SEC_DAY/AU_KM);
+		out.vy[i]=sv[k][4]*(SEC_DAY/AU_KM);
+		out.vz[i]=sv[k][5]*(SEC_DAY/AU_KM);
+	}
+}
+
+void EphRead::get_states(int target,int observer,
+						 const std::vector<double>&jd_tdb,StateBuf&out){
+	get_states(target,observer,jd_tdb.data(),jd_tdb.size(),out);
+}
+
 Vec3 EphRead::get_pos(int target,int observer,double jd_tdb){
-	return get_state(target,observer,jd_tdb).first;
+	Vec3 c_pos,c_vel;
+	if(cache&&cache->state(target,observer,jd_tdb,c_pos,c_vel)){
+		++n_call;
+		return c_pos;
+	}
+	if(lfit){
+		fit_only(filepath);
+	}
+	if(back!=EphBack::SPICE||!kern_ok){
+		return get_state(target,observer,jd_tdb).first;
+	}
+	++n_call;
+	SpiceDouble pos[3];
+	SpiceDouble lt;
+	spkgps_c(target,et_fromjd(jd_tdb),"J2000",observer,pos,&lt);
+	if(failed_c()){
+		chk_spice("spkgps_c failed for target "+std::to_string(target)+
+				  " observer "+std::to_string(observer));
+	}
+	return Vec3(pos[0]/AU_KM,pos[1]/AU_KM,pos[2]/AU_KM);
+}
+
+const EphemCache&EphRead::cache_span(double jd_lo,double jd_hi,
+									 double tol_km){
+	if(cache&&cache->covers(jd_lo,jd_hi)){
+		return *cache;
+	}
+	cache.reset();
+	double step=EphemCache::DEF_STEP;
+	auto built=std::make_shared<const EphemCache>(*this,jd_lo,jd_hi,step);
+	while(built->err_km()>tol_km&&step>1.0/64.0){
+		step*=0.5;
+		built=std::make_shared<const EphemCache>(*this,jd_lo,jd_hi,step);
+	}
+	cache=built;
+	return *cache;
 }
 
 Vec3 EphRead::get_vel(int target,int observer,double jd_tdb){
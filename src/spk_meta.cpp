@@ -0,0 +1,348 @@
+#include "lunar/spk_meta.hpp"
+
+#include<algorithm>
+#include<atomic>
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+#include<filesystem>
+#include<fstream>
+#include<iomanip>
+#include<limits>
+#include<map>
+#include<mutex>
+#include<sstream>
+#include<stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include<windows.h>
+#else
+#include<unistd.h>
+#endif
+
+extern "C"{
+#include "SpiceUsr.h"
+}
+
+#include "lunar/math.hpp"
+#include "lunar/spc_ephem.hpp"
+#include "lunar/spk_native.hpp"
+
+namespace fs=std::filesystem;
+
+namespace{
+
+constexpr std::streamsize kRecLen=1024;
+
+std::uint64_t fnv(std::uint64_t h,const char*p,std::streamsize n){
+	for(std::streamsize i=0;i<n;++i){
+		h^=static_cast<unsigned char>(p[i]);
+		h*=1099511628211ULL;
+	}
+	return h;
+}
+
+template<typename T> T rd_daf(const char*p,bool swap){
+	unsigned char b[sizeof(T)];
+	std::memcpy(b,p,sizeof(T));
+	if(swap){
+		std::reverse(b,b+sizeof(T));
+	}
+	T v;
+	std::memcpy(&v,b,sizeof(T));
+	return v;
+}
+
+std::uint64_t daf_hash(const std::string&path,std::uintmax_t size){
+	std::ifstream ifs(path,std::ios::binary);
+	char rec[kRecLen]={};
+	ifs.read(rec,kRecLen);
+	std::uint64_t h=fnv(1469598103934665603ULL,rec,ifs.gcount());
+	if(ifs.gcount()!=kRecLen){
+		return h;
+	}
+	const std::uint16_t probe=1;
+	unsigned char le=0;
+	std::memcpy(&le,&probe,1);
+	const std::string fmt(rec+88,8);
+	const bool swap=(fmt=="LTL-IEEE"&&le!=1)||(fmt=="BIG-IEEE"&&le==1);
+	const std::uintmax_t n_rec=size/kRecLen;
+	std::int32_t rec_no=rd_daf<std::int32_t>(rec+76,swap);
+	for(std::uintmax_t n=0;rec_no>0&&n<n_rec;++n){
+		if(static_cast<std::uintmax_t>(rec_no)>n_rec){
+			break;
+		}
+		ifs.seekg(static_cast<std::streamoff>(rec_no-1)*kRecLen);
+		ifs.read(rec,kRecLen);
+		if(ifs.gcount()!=kRecLen){
+			break;
+		}
+		h=fnv(h,rec,kRecLen);
+		const double next=rd_daf<double>(rec,swap);
+		rec_no=next>0.0&&next<=static_cast<double>(n_rec)
+				   ?static_cast<std::int32_t>(next)
+				   :0;
+	}
+	return h;
+}
+
+double et2jd(double et){ return 2451545.0+et/SEC_DAY; }
+
+void merge_win(BodyMeta&bm){
+	auto&win=bm.win;
+	std::sort(win.begin(),win.end());
+	std::size_t n=0;
+	for(std::size_t i=0;i<win.size();++i){
+		if(n>0&&win[i].first<=win[n-1].second){
+			win[n-1].second=std::max(win[n-1].second,win[i].second);
+		}else{
+			win[n++]=win[i];
+		}
+	}
+	win.resize(n);
+}
+
+void scan_daf(SpkMeta&meta){
+	SpkFile spk(meta.path);
+	std::map<int,BodyMeta> by_id;
+	for(const SpkSeg&seg : spk.segs()){
+		BodyMeta&bm=by_id[seg.target];
+		bm.body=seg.target;
+		++bm.n_seg;
+		bm.win.emplace_back(et2jd(seg.et_beg),et2jd(seg.et_end));
+	}
+	for(auto&kv : by_id){
+		merge_win(kv.second);
+		meta.bodies.push_back(kv.second);
+	}
+}
+
+std::map<int,int> daf_segs(const std::string&path){
+	SpiceInt h=0;
+	dafopr_c(path.c_str(),&h);
+	chk_spice("dafopr_c failed");
+	std::map<int,int> n_seg;
+	dafbfs_c(h);
+	SpiceBoolean found=SPICEFALSE;
+	daffna_c(&found);
+	while(found&&!failed_c()){
+		SpiceDouble sum[5];
+		SpiceDouble dc[2];
+		SpiceInt ic[6];
+		dafgs_c(sum);
+		dafus_c(sum,2,6,dc,ic);
+		++n_seg[ic[0]];
+		daffna_c(&found);
+	}
+	if(failed_c()){
+		try{
+			chk_spice("DAF summary scan failed");
+		}catch(...){
+			dafcls_c(h);
+			throw;
+		}
+	}
+	dafcls_c(h);
+	chk_spice("dafcls_c failed");
+	return n_seg;
+}
+
+void scan_spice(SpkMeta&meta){
+	cfg_spice();
+	const std::map<int,int> n_seg=daf_segs(meta.path);
+	SPICEINT_CELL(ids,10000);
+	scard_c(0,&ids);
+	spkobj_c(meta.path.c_str(),&ids);
+	chk_spice("spkobj_c failed");
+	for(SpiceInt i=0;i<card_c(&ids);++i){
+		BodyMeta bm;
+		bm.body=SPICE_CELL_ELEM_I(&ids,i);
+		SPICEDOUBLE_CELL(cover,400000);
+		scard_c(0,&cover);
+		spkcov_c(meta.path.c_str(),bm.body,&cover);
+		chk_spice("spkcov_c failed");
+		const SpiceInt nint=wncard_c(&cover);
+		for(SpiceInt k=0;k<nint;++k){
+			SpiceDouble b=0.0;
+			SpiceDouble e=0.0;
+			wnfetd_c(&cover,k,&b,&e);
+			bm.win.emplace_back(et2jd(b),et2jd(e));
+		}
+		if(!bm.win.empty()){
+			auto it=n_seg.find(bm.body);
+			bm.n_seg=it==n_seg.end()?0:it->second;
+			meta.bodies.push_back(bm);
+		}
+	}
+}
+
+bool read_meta(SpkMeta&meta){
+	std::ifstream ifs(meta_path(meta.path));
+	if(!ifs){
+		return false;
+	}
+	std::string line;
+	bool key_ok[4]={};
+	std::vector<BodyMeta> bodies;
+	while(std::getline(ifs,line)){
+		auto pos=line.find('=');
+		if(pos==std::string::npos){
+			continue;
+		}
+		const std::string key=line.substr(0,pos);
+		std::istringstream iss(line.substr(pos+1));
+		if(key=="lmeta"){
+			int ver=0;
+			key_ok[0]=(iss>>ver)&&ver==SpkMeta::VERSION;
+		}else if(key=="size"){
+			std::uintmax_t v=0;
+			key_ok[1]=(iss>>v)&&v==meta.size;
+		}else if(key=="mtime"){
+			long long v=0;
+			key_ok[2]=(iss>>v)&&v==meta.mtime;
+		}else if(key=="hash"){
+			std::uint64_t v=0;
+			key_ok[3]=(iss>>std::hex>>v)&&v==meta.hash;
+		}else if(key=="body"){
+			BodyMeta bm;
+			iss>>bm.body>>bm.n_seg;
+			double lo=0.0;
+			double hi=0.0;
+			while(iss>>lo>>hi){
+				bm.win.emplace_back(lo,hi);
+			}
+			if(bm.win.empty()){
+				return false;
+			}
+			bodies.push_back(bm);
+		}
+	}
+	if(!std::all_of(key_ok,key_ok+4,[](bool b){ return b; })||
+	   bodies.empty()){
+		return false;
+	}
+	meta.bodies=bodies;
+	return true;
+}
+
+void write_meta(const SpkMeta&meta){
+	static std::atomic<unsigned> seq{0};
+#ifdef _WIN32
+	const unsigned long pid=static_cast<unsigned long>(GetCurrentProcessId());
+#else
+	const unsigned long pid=static_cast<unsigned long>(getpid());
+#endif
+	const std::string out=meta_path(meta.path);
+	const std::string tmp=out+".tmp."+std::to_string(pid)+"."+
+						  std::to_string(seq.fetch_add(1));
+	{
+		std::ofstream ofs(tmp,std::ios::trunc);
+		if(!ofs){
+			return;
+		}
+		ofs<<"lmeta="<<SpkMeta::VERSION<<"\n";
+		ofs<<"path="<<meta.path<<"\n";
+		ofs<<"size="<<meta.size<<"\n";
+		ofs<<"mtime="<<meta.mtime<<"\n";
+		ofs<<"hash="<<std::hex<<meta.hash<<std::dec<<"\n";
+		ofs<<std::setprecision(17);
+		for(const BodyMeta&bm : meta.bodies){
+			ofs<<"body="<<bm.body<<" "<<bm.n_seg;
+			for(const auto&w : bm.win){
+				ofs<<" "<<w.first<<" "<<w.second;
+			}
+			ofs<<"\n";
+		}
+		if(!ofs){
+			ofs.close();
+			std::error_code ec;
+			fs::remove(tmp,ec);
+			return;
+		}
+	}
+	std::error_code ec;
+	fs::rename(tmp,out,ec);
+	if(ec){
+		fs::remove(tmp,ec);
+	}
+}
+
+} // namespace
+
+const BodyMeta*SpkMeta::body(int id) const{
+	for(const BodyMeta&bm : bodies){
+		if(bm.body==id){
+			return &bm;
+		}
+	}
+	return nullptr;
+}
+
+bool SpkMeta::cover(const std::vector<int>&ids,double&jd_lo,
+					double&jd_hi) const{
+	const double inf=std::numeric_limits<double>::infinity();
+	double lo=ids.empty()?inf:-inf;
+	double hi=ids.empty()?-inf:inf;
+	if(ids.empty()){
+		for(const BodyMeta&bm : bodies){
+			lo=std::min(lo,bm.jd_lo());
+			hi=std::max(hi,bm.jd_hi());
+		}
+	}
+	for(int id : ids){
+		const BodyMeta*bm=body(id);
+		if(bm==nullptr){
+			return false;
+		}
+		lo=std::max(lo,bm->jd_lo());
+		hi=std::min(hi,bm->jd_hi());
+	}
+	if(!std::isfinite(lo)||!std::isfinite(hi)||lo>=hi){
+		return false;
+	}
+	jd_lo=lo;
+	jd_hi=hi;
+	return true;
+}
+
+std::string meta_path(const std::string&path){ return path+".lmeta"; }
+
+std::shared_ptr<const SpkMeta> spk_meta(const std::string&path){
+	static std::mutex mtx;
+	static std::map<std::string,std::shared_ptr<const SpkMeta>> memo;
+
+	auto meta=std::make_shared<SpkMeta>();
+	meta->path=path;
+	std::error_code ec;
+	meta->size=fs::file_size(path,ec);
+	if(ec){
+		throw std::runtime_error("ephemeris file not found: "+path);
+	}
+	meta->mtime=static_cast<long long>(
+		fs::last_write_time(path,ec).time_since_epoch().count());
+	meta->hash=daf_hash(path,meta->size);
+
+	std::lock_guard<std::mutex> lock(mtx);
+	auto it=memo.find(path);
+	if(it!=memo.end()&&it->second->size==meta->size&&
+	   it->second->mtime==meta->mtime&&it->second->hash==meta->hash){
+		return it->second;
+	}
+	meta->cached=read_meta(*meta);
+	if(!meta->cached){
+		try{
+			scan_daf(*meta);
+		}catch(const std::runtime_error&){
+			meta->bodies.clear();
+			scan_spice(*meta);
+		}
+		if(!meta->bodies.empty()){
+			write_meta(*meta);
+		}
+	}
+	memo[path]=meta;
+	return meta;
+}
@@ -0,0 +1,657 @@
+#include "lunar/spk_native.hpp"
+
+#include<algorithm>
+#include<cstdint>
+#include<cstring>
+#include<fstream>
+#include<map>
+#include<mutex>
+#include<set>
+#include<stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include<windows.h>
+#else
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#endif
+
+#include "lunar/cheb_simd.hpp"
+
+namespace{
+
+constexpr std::size_t kRecLen=1024;
+constexpr int kMaxChain=32;
+
+bool host_le(){
+	const std::uint16_t probe=1;
+	unsigned char b=0;
+	std::memcpy(&b,&probe,1);
+	return b==1;
+}
+
+int rd_i32(const unsigned char*p){
+	std::int32_t v=0;
+	std::memcpy(&v,p,sizeof(v));
+	return static_cast<int>(v);
+}
+
+double rd_f64(const unsigned char*p){
+	double v=0.0;
+	std::memcpy(&v,p,sizeof(v));
+	return v;
+}
+
+const double*rec_ptr(const SpkSeg&seg,double et){
+	int rec=static_cast<int>((et-seg.init)/seg.intlen);
+	if(rec>=seg.n_rec){
+		rec=seg.n_rec-1;
+	}
+	if(rec<0){
+		rec=0;
+	}
+	return seg.data+static_cast<std::size_t>(rec)*seg.rsize;
+}
+
+int seg_ncf(const SpkSeg&seg){ return (seg.rsize-2)/(seg.type==2?3:6); }
+
+} // namespace
+
+SpkFile::SpkFile(const std::string&path) : path_(path){
+	map_file();
+	try{
+		parse_daf();
+	}catch(...){
+		unmap_file();
+		throw;
+	}
+}
+
+SpkFile::~SpkFile(){ unmap_file(); }
+
+void SpkFile::map_file(){
+#ifdef _WIN32
+	HANDLE hf=CreateFileA(path_.c_str(),GENERIC_READ,FILE_SHARE_READ,nullptr,
+						  OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,nullptr);
+	if(hf==INVALID_HANDLE_VALUE){
+		throw std::runtime_error("failed to open SPK file: "+path_);
+	}
+	LARGE_INTEGER fsz;
+	if(!GetFileSizeEx(hf,&fsz)||fsz.QuadPart<=0){
+		CloseHandle(hf);
+		throw std::runtime_error("SPK file is not readable or empty: "+path_);
+	}
+	HANDLE hm=CreateFileMappingA(hf,nullptr,PAGE_READONLY,0,0,nullptr);
+	if(hm==nullptr){
+		CloseHandle(hf);
+		throw std::runtime_error("failed to map SPK file: "+path_);
+	}
+	void*view=MapViewOfFile(hm,FILE_MAP_READ,0,0,0);
+	if(view==nullptr){
+		CloseHandle(hm);
+		CloseHandle(hf);
+		throw std::runtime_error("failed to map SPK file: "+path_);
+	}
+	h_file_=hf;
+	h_map_=hm;
+	base_=static_cast<const unsigned char*>(view);
+	size_=static_cast<std::size_t>(fsz.QuadPart);
+#else
+	int fd=open(path_.c_str(),O_RDONLY);
+	if(fd<0){
+		throw std::runtime_error("failed to open SPK file: "+path_);
+	}
+	struct stat sb;
+	if(fstat(fd,&sb)!=0||sb.st_size<=0){
+		close(fd);
+		throw std::runtime_error("SPK file is not readable or empty: "+path_);
+	}
+	void*view=mmap(nullptr,static_cast<std::size_t>(sb.st_size),PROT_READ,
+				   MAP_SHARED,fd,0);
+	if(view==MAP_FAILED){
+		close(fd);
+		throw std::runtime_error("failed to map SPK file: "+path_);
+	}
+	fd_=fd;
+	base_=static_cast<const unsigned char*>(view);
+	size_=static_cast<std::size_t>(sb.st_size);
+#endif
+}
+
+void SpkFile::unmap_file(){
+#ifdef _WIN32
+	if(base_!=nullptr){
+		UnmapViewOfFile(base_);
+	}
+	if(h_map_!=nullptr){
+		CloseHandle(static_cast<HANDLE>(h_map_));
+	}
+	if(h_file_!=nullptr){
+		CloseHandle(static_cast<HANDLE>(h_file_));
+	}
+	h_map_=nullptr;
+	h_file_=nullptr;
+#else
+	if(base_!=nullptr){
+		munmap(const_cast<unsigned char*>(base_),size_);
+	}
+	if(fd_>=0){
+		close(fd_);
+	}
+	fd_=-1;
+#endif
+	base_=nullptr;
+	size_=0;
+}
+
+void SpkFile::parse_daf(){
+	if(size_<kRecLen){
+		throw std::runtime_error("SPK file too small: "+path_);
+	}
+	const std::string idw(reinterpret_cast<const char*>(base_),8);
+	if(idw!="DAF/SPK "&&idw!="NAIF/DAF"){
+		throw std::runtime_error("not a DAF/SPK file: "+path_);
+	}
+	const std::string fmt(reinterpret_cast<const char*>(base_+88),8);
+	if((fmt=="LTL-IEEE"&&!host_le())||(fmt=="BIG-IEEE"&&host_le())){
+		throw std::runtime_error("SPK byte order "+fmt+
+								 " does not match host: "+path_);
+	}
+	const int nd=rd_i32(base_+8);
+	const int ni=rd_i32(base_+12);
+	if(nd!=2||ni!=6){
+		throw std::runtime_error("unexpected DAF summary format in: "+path_);
+	}
+	const std::size_t ss=static_cast<std::size_t>(nd+(ni+1)/2);
+	int rec=rd_i32(base_+76);
+	int guard=0;
+	while(rec>0){
+		const std::size_t off=static_cast<std::size_t>(rec-1)*kRecLen;
+		if(off+kRecLen>size_||++guard>1000000){
+			throw std::runtime_error("corrupt DAF summary chain in: "+path_);
+		}
+		const unsigned char*sr=base_+off;
+		const int next=static_cast<int>(rd_f64(sr));
+		const int nsum=static_cast<int>(rd_f64(sr+16));
+		if(nsum<0||24+static_cast<std::size_t>(nsum)*ss*8>kRecLen){
+			throw std::runtime_error("corrupt DAF summary record in: "+path_);
+		}
+		if(off+2*kRecLen>size_){
+			throw std::runtime_error("corrupt DAF name record in: "+path_);
+		}
+		for(int i=0;i<nsum;++i){
+			const unsigned char*sp=sr+24+static_cast<std::size_t>(i)*ss*8;
+			SpkSeg seg;
+			seg.name.assign(
+				reinterpret_cast<const char*>(sr+kRecLen+i*ss*8),ss*8);
+			seg.et_beg=rd_f64(sp);
+			seg.et_end=rd_f64(sp+8);
+			seg.target=rd_i32(sp+16);
+			seg.center=rd_i32(sp+20);
+			seg.frame=rd_i32(sp+24);
+			seg.type=rd_i32(sp+28);
+			const int beg=rd_i32(sp+32);
+			const int end=rd_i32(sp+36);
+			if(beg<1||end<beg||static_cast<std::size_t>(end)*8>size_){
+				throw std::runtime_error("SPK segment out of file bounds: "+
+										 path_);
+			}
+			seg.data=reinterpret_cast<const double*>(
+				base_+static_cast<std::size_t>(beg-1)*8);
+			if(seg.type==2||seg.type==3){
+				const double*tail=seg.data+(end-beg+1)-4;
+				seg.init=tail[0];
+				seg.intlen=tail[1];
+				seg.rsize=static_cast<int>(tail[2]);
+				seg.n_rec=static_cast<int>(tail[3]);
+				const int per=seg.type==2?3:6;
+				if(seg.intlen<=0.0||seg.n_rec<=0||seg.rsize<2+per||
+				   (seg.rsize-2)%per!=0||
+				   static_cast<long long>(seg.rsize)*seg.n_rec+4!=
+					   static_cast<long long>(end-beg+1)){
+					throw std::runtime_error("corrupt Chebyshev segment in: "+
+											 path_);
+				}
+			}
+			segs_.push_back(seg);
+		}
+		rec=next;
+	}
+	if(segs_.empty()){
+		throw std::runtime_error("SPK file has no segments: "+path_);
+	}
+	for(std::size_t i=0;i<segs_.size();++i){
+		for(std::size_t j=i+1;j<segs_.size();++j){
+			if(segs_[j].target==segs_[i].target&&
+			   segs_[j].et_beg<=segs_[i].et_end&&
+			   segs_[j].et_end>=segs_[i].et_beg){
+				segs_[i].shadow=true;
+				break;
+			}
+		}
+	}
+}
+
+const SpkSeg*SpkFile::find_seg(int body,double et) const{
+	for(auto it=segs_.rbegin();it!=segs_.rend();++it){
+		if(it->target==body&&et>=it->et_beg&&et<=it->et_end){
+			return &*it;
+		}
+	}
+	return nullptr;
+}
+
+void SpkFile::seg_state(const SpkSeg&seg,double et,double st[6]){
+	if(seg.type!=2&&seg.type!=3){
+		throw std::runtime_error("unsupported SPK segment type "+
+								 std::to_string(seg.type));
+	}
+	if(seg.frame!=1){
+		throw std::runtime_error("SPK segment frame is not J2000");
+	}
+	cheb_rec(rec_ptr(seg,et),seg.type,seg_ncf(seg),et,st);
+}
+
+const SpkSeg*SpkFile::find_seg(int body,double et,const SpkSeg*hint) const{
+	if(hint!=nullptr&&hint->target==body&&!hint->shadow&&et>=hint->et_beg&&
+	   et<=hint->et_end){
+		return hint;
+	}
+	return find_seg(body,et);
+}
+
+int SpkFile::find_seg4(int body,const double et[4],const SpkSeg*seg[4],
+					   const SpkSeg*&hint) const{
+	int found=0;
+	for(int l=0;l<4;++l){
+		seg[l]=find_seg(body,et[l],hint);
+		if(seg[l]!=nullptr){
+			hint=seg[l];
+			++found;
+		}
+	}
+	if(found==0){
+		return 0;
+	}
+	if(found<4){
+		return -1;
+	}
+	for(int l=0;l<4;++l){
+		if((seg[l]->type!=2&&seg[l]->type!=3)||seg[l]->frame!=1||
+		   seg[l]->center!=seg[0]->center||seg[l]->type!=seg[0]->type||
+		   seg[l]->rsize!=seg[0]->rsize){
+			return -1;
+		}
+	}
+	return 1;
+}
+
+bool SpkFile::state4(int target,int observer,const double et[4],
+					 double st[][6],const SpkSeg**hint) const{
+	for(int l=0;l<4;++l){
+		for(int k=0;k<6;++k){
+			st[l][k]=0.0;
+		}
+	}
+	if(target==observer){
+		return true;
+	}
+
+	const SpkSeg*seg[4];
+	const double*rec[4];
+	double s[4][6];
+	int ctarg[kMaxChain];
+	double starg[kMaxChain][4][6];
+	int nct=0;
+	int cur=target;
+	while(nct<kMaxChain){
+		const int hit=find_seg4(cur,et,seg,hint[nct]);
+		if(hit<0){
+			return false;
+		}
+		if(hit==0){
+			break;
+		}
+		for(int l=0;l<4;++l){
+			rec[l]=rec_ptr(*seg[l],et[l]);
+		}
+		cheb_rec4(rec,seg[0]->type,seg_ncf(*seg[0]),et,s);
+		for(int l=0;l<4;++l){
+			for(int k=0;k<6;++k){
+				starg[nct][l][k]=nct==0?s[l][k]:starg[nct-1][l][k]+s[l][k];
+			}
+		}
+		ctarg[nct]=seg[0]->center;
+		cur=seg[0]->center;
+		++nct;
+		if(cur==observer){
+			break;
+		}
+	}
+
+	auto find_ct=[&](int body){
+		for(int i=0;i<nct;++i){
+			if(ctarg[i]==body){
+				return i;
+			}
+		}
+		return -1;
+	};
+
+	int pos=find_ct(observer);
+	if(pos>=0){
+		for(int l=0;l<4;++l){
+			for(int k=0;k<6;++k){
+				st[l][k]=starg[pos][l][k];
+			}
+		}
+		return true;
+	}
+
+	double sobs[4][6]={};
+	int cobs=observer;
+	for(int depth=0;depth<kMaxChain;++depth){
+		if(find_seg4(cobs,et,seg,hint[kMaxChain+depth])!=1){
+			return false;
+		}
+		for(int l=0;l<4;++l){
+			rec[l]=rec_ptr(*seg[l],et[l]);
+		}
+		cheb_rec4(rec,seg[0]->type,seg_ncf(*seg[0]),et,s);
+		for(int l=0;l<4;++l){
+			for(int k=0;k<6;++k){
+				sobs[l][k]+=s[l][k];
+			}
+		}
+		cobs=seg[0]->center;
+		if(cobs==target){
+			for(int l=0;l<4;++l){
+				for(int k=0;k<6;++k){
+					st[l][k]=-sobs[l][k];
+				}
+			}
+			return true;
+		}
+		pos=find_ct(cobs);
+		if(pos>=0){
+			for(int l=0;l<4;++l){
+				for(int k=0;k<6;++k){
+					st[l][k]=starg[pos][l][k]-sobs[l][k];
+				}
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void SpkFile::state_n(int target,int observer,const double*et,std::size_t n,
+					  double st[][6]) const{
+	const SpkSeg*hint[2*kMaxChain]={};
+	std::size_t i=0;
+	for(;i+4<=n;i+=4){
+		if(state4(target,observer,et+i,st+i,hint)){
+			continue;
+		}
+		for(std::size_t j=i;j<i+4;++j){
+			state(target,observer,et[j],st[j]);
+		}
+	}
+	for(;i<n;++i){
+		state(target,observer,et[i],st[i]);
+	}
+}
+
+void SpkFile::state(int target,int observer,double et,double st[6]) const{
+	for(int k=0;k<6;++k){
+		st[k]=0.0;
+	}
+	if(target==observer){
+		return;
+	}
+
+	int ctarg[kMaxChain];
+	double starg[kMaxChain][6];
+	int nct=0;
+	int cur=target;
+	while(nct<kMaxChain){
+		const SpkSeg*seg=find_seg(cur,et);
+		if(seg==nullptr){
+			break;
+		}
+		double s[6];
+		seg_state(*seg,et,s);
+		for(int k=0;k<6;++k){
+			starg[nct][k]=nct==0?s[k]:starg[nct-1][k]+s[k];
+		}
+		ctarg[nct]=seg->center;
+		cur=seg->center;
+		++nct;
+		if(cur==observer){
+			break;
+		}
+	}
+
+	auto find_ct=[&](int body){
+		for(int i=0;i<nct;++i){
+			if(ctarg[i]==body){
+				return i;
+			}
+		}
+		return -1;
+	};
+
+	int pos=find_ct(observer);
+	if(pos>=0){
+		for(int k=0;k<6;++k){
+			st[k]=starg[pos][k];
+		}
+		return;
+	}
+
+	double sobs[6]={0.0,0.0,0.0,0.0,0.0,0.0};
+	int cobs=observer;
+	for(int depth=0;depth<kMaxChain;++depth){
+		const SpkSeg*seg=find_seg(cobs,et);
+		if(seg==nullptr){
+			break;
+		}
+		double s[6];
+		seg_state(*seg,et,s);
+		for(int k=0;k<6;++k){
+			sobs[k]+=s[k];
+		}
+		cobs=seg->center;
+		if(cobs==target){
+			for(int k=0;k<6;++k){
+				st[k]=-sobs[k];
+			}
+			return;
+		}
+		pos=find_ct(cobs);
+		if(pos>=0){
+			for(int k=0;k<6;++k){
+				st[k]=starg[pos][k]-sobs[k];
+			}
+			return;
+		}
+	}
+	throw std::runtime_error("insufficient SPK data for target "+
+							 std::to_string(target)+" observer "+
+							 std::to_string(observer)+" in "+path_);
+}
+
+std::shared_ptr<const SpkFile> spk_open(const std::string&path){
+	static std::mutex mtx;
+	static std::map<std::string,std::weak_ptr<const SpkFile>> open_files;
+	std::lock_guard<std::mutex> lock(mtx);
+	auto it=open_files.find(path);
+	if(it!=open_files.end()){
+		if(auto sp=it->second.lock()){
+			return sp;
+		}
+	}
+	auto sp=std::make_shared<const SpkFile>(path);
+	open_files[path]=sp;
+	return sp;
+}
+
+SpkSub spk_extract(const SpkFile&src,const std::vector<int>&bodies,
+				   double et_lo,double et_hi,const std::string&out_path){
+	if(!(et_hi>et_lo)){
+		throw std::invalid_argument("extract window is empty");
+	}
+	std::set<int> need(bodies.begin(),bodies.end());
+	for(std::size_t n=0;n!=need.size();){
+		n=need.size();
+		for(const SpkSeg&seg : src.segs()){
+			if(need.count(seg.target)&&seg.et_end>=et_lo&&seg.et_beg<=et_hi){
+				need.insert(seg.center);
+			}
+		}
+	}
+
+	struct Cut{
+		const SpkSeg*seg;
+		int r0;
+		int nr;
+		double beg;
+		double end;
+	};
+	std::vector<Cut> cuts;
+	SpkSub sub;
+	sub.et_beg=et_hi;
+	sub.et_end=et_lo;
+	for(const SpkSeg&seg : src.segs()){
+		if(!need.count(seg.target)||seg.et_end<et_lo||seg.et_beg>et_hi){
+			continue;
+		}
+		if(seg.type!=2&&seg.type!=3){
+			throw std::runtime_error("cannot extract SPK segment type "+
+									 std::to_string(seg.type)+" from "+
+									 src.path());
+		}
+		const double*first=rec_ptr(seg,std::max(et_lo,seg.et_beg));
+		const double*last=rec_ptr(seg,std::min(et_hi,seg.et_end));
+		Cut cut;
+		cut.seg=&seg;
+		cut.r0=static_cast<int>((first-seg.data)/seg.rsize);
+		cut.nr=static_cast<int>((last-first)/seg.rsize)+1;
+		cut.beg=std::max(seg.et_beg,seg.init+cut.r0*seg.intlen);
+		cut.end=std::min(seg.et_end,seg.init+(cut.r0+cut.nr)*seg.intlen);
+		sub.et_beg=std::min(sub.et_beg,cut.beg);
+		sub.et_end=std::max(sub.et_end,cut.end);
+		cuts.push_back(cut);
+	}
+	if(cuts.empty()){
+		throw std::runtime_error("no SPK data for the requested window in: "+
+								 src.path());
+	}
+
+	constexpr std::size_t kWord=kRecLen/8;
+	constexpr std::size_t kPerRec=25;
+	const std::size_t n_sr=(cuts.size()+kPerRec-1)/kPerRec;
+	const int rec_data=static_cast<int>(2+2*n_sr);
+	std::vector<double> words;
+	std::vector<int> addr;
+	for(const Cut&cut : cuts){
+		const SpkSeg&seg=*cut.seg;
+		addr.push_back(static_cast<int>((rec_data-1)*kWord+words.size()+1));
+		const double*p=seg.data+static_cast<std::size_t>(cut.r0)*seg.rsize;
+		words.insert(words.end(),p,
+					 p+static_cast<std::size_t>(cut.nr)*seg.rsize);
+		words.push_back(seg.init+cut.r0*seg.intlen);
+		words.push_back(seg.intlen);
+		words.push_back(seg.rsize);
+		words.push_back(cut.nr);
+	}
+	const int free_addr=static_cast<int>((rec_data-1)*kWord+words.size()+1);
+	words.resize((words.size()+kWord-1)/kWord*kWord,0.0);
+
+	std::vector<unsigned char> file((rec_data-1)*kRecLen,0);
+	unsigned char*fr=file.data();
+	auto put_i32=[](unsigned char*p,int v){
+		const std::int32_t w=v;
+		std::memcpy(p,&w,sizeof(w));
+	};
+	auto put_f64=[](unsigned char*p,double v){ std::memcpy(p,&v,sizeof(v)); };
+	auto put_str=[](unsigned char*p,const std::string&s,std::size_t n){
+		std::memset(p,' ',n);
+		std::memcpy(p,s.data(),std::min(n,s.size()));
+	};
+	put_str(fr,"DAF/SPK ",8);
+	put_i32(fr+8,2);
+	put_i32(fr+12,6);
+	put_str(fr+16,"lunar download extract",60);
+	put_i32(fr+76,2);
+	put_i32(fr+80,static_cast<int>(2*n_sr));
+	put_i32(fr+84,free_addr);
+	put_str(fr+88,host_le()?"LTL-IEEE":"BIG-IEEE",8);
+	const char ftp[]="FTPSTR:\r:\n:\r\n:\r\0:\x81:\x10\xce:ENDFTP";
+	std::memcpy(fr+699,ftp,sizeof(ftp)-1);
+
+	for(std::size_t k=0;k<n_sr;++k){
+		unsigned char*sr=fr+(2*k+1)*kRecLen;
+		const std::size_t i0=k*kPerRec;
+		const std::size_t i1=std::min(cuts.size(),i0+kPerRec);
+		put_f64(sr,k+1<n_sr?static_cast<double>(2*k+4):0.0);
+		put_f64(sr+8,k>0?static_cast<double>(2*k):0.0);
+		put_f64(sr+16,static_cast<double>(i1-i0));
+		for(std::size_t i=i0;i<i1;++i){
+			const Cut&cut=cuts[i];
+			unsigned char*sp=sr+24+(i-i0)*40;
+			put_f64(sp,cut.beg);
+			put_f64(sp+8,cut.end);
+			put_i32(sp+16,cut.seg->target);
+			put_i32(sp+20,cut.seg->center);
+			put_i32(sp+24,cut.seg->frame);
+			put_i32(sp+28,cut.seg->type);
+			put_i32(sp+32,addr[i]);
+			const std::size_t len=static_cast<std::size_t>(cut.nr)*
+									  cut.seg->rsize+4;
+			put_i32(sp+36,static_cast<int>(addr[i]+len-1));
+			put_str(sr+kRecLen+(i-i0)*40,cut.seg->name,40);
+		}
+	}
+
+	std::ofstream ofs(out_path,std::ios::binary|std::ios::trunc);
+	if(!ofs){
+		throw std::runtime_error("failed to open output file: "+out_path);
+	}
+	ofs.write(reinterpret_cast<const char*>(file.data()),
+			  static_cast<std::streamsize>(file.size()));
+	ofs.write(reinterpret_cast<const char*>(words.data()),
+			  static_cast<std::streamsize>(words.size()*sizeof(double)));
+	if(!ofs){
+		throw std::runtime_error("failed to write SPK file: "+out_path);
+	}
+	ofs.close();
+
+	SpkFile chk(out_path);
+	for(int body : bodies){
+		for(double f : {0.25,0.5,0.75}){
+			const double et=sub.et_beg+f*(sub.et_end-sub.et_beg);
+			double a[6];
+			double b[6];
+			try{
+				src.state(body,0,et,a);
+			}catch(const std::runtime_error&){
+				continue;
+			}
+			chk.state(body,0,et,b);
+			if(std::memcmp(a,b,sizeof(a))!=0){
+				throw std::runtime_error("extracted SPK does not reproduce "
+										 "body "+std::to_string(body)+
+										 ": "+out_path);
+			}
+		}
+	}
+	sub.n_seg=cuts.size();
+	sub.bytes=file.size()+words.size()*sizeof(double);
+	return sub;
+}